@@ -38,8 +38,13 @@
  */
 #include "adevs_exception.h"
 #include "adevs_models.h"
+#include "adevs_shared_value.h"
+#include "adevs_state_saving.h"
 #include "adevs_simulator.h"
+#include "adevs_calendar_sched.h"
+#include "adevs_dary_sched.h"
 #include "adevs_digraph.h"
+#include "adevs_csr_digraph.h"
 #include "adevs_simpledigraph.h"
 #include "adevs_cellspace.h"
 #include "adevs_rand.h"
@@ -49,6 +54,9 @@
 #include "adevs_rk_45.h"
 #include "adevs_poly.h"
 #include "adevs_wrapper.h"
+#include "adevs_partitioner.h"
 #ifdef _OPENMP
 #include "adevs_par_simulator.h"
+#include "adevs_window_simulator.h"
+#include "adevs_opt_simulator.h"
 #endif
@@ -96,6 +96,49 @@ void AbstractSimulator<X,T>::notify_state_listeners(Atomic<X,T>* model, T t)
 	}
 }
 
+/**
+ * This is the interface that a Simulator uses to talk to the logical
+ * process that owns it in a parallel simulation. The conservative
+ * LogicalProcess and the optimistic OptLogicalProcess implement it.
+ */
+template <class X, class T = double> class AbstractLogicalProcess
+{
+	public:
+		/// Get the ID of the logical process
+		virtual int getID() const = 0;
+		/**
+		 * Called by the Simulator when an output goes to a model
+		 * that belongs to another logical process.
+		 */
+		virtual void notifyInput(Atomic<X,T>* model, X& value) = 0;
+		/**
+		 * Returns true if input to a network that belongs to another
+		 * logical process should be given to notifyNetworkInput, so that
+		 * the process which owns the network routes it. Otherwise the
+		 * Simulator routes it to the atomic models inside of the network.
+		 */
+		virtual bool routesNetworkInput() const { return false; }
+		/**
+		 * Called by the Simulator when an output goes to a network that
+		 * belongs to another logical process, if routesNetworkInput()
+		 * is true.
+		 */
+		virtual void notifyNetworkInput(Network<X,T>*, X&){}
+		/**
+		 * Called by the Simulator when the model transition function of
+		 * a network that does not belong to this logical process is
+		 * needed. Return true to evaluate it later, when every logical
+		 * process has stopped, or false to let the Simulator evaluate it.
+		 */
+		virtual bool deferModelTransition(Network<X,T>*) { return false; }
+		/// Called by the Simulator when a model is added at time t
+		virtual void notifyAdded(Devs<X,T>*, T){}
+		/// Called by the Simulator when a model is removed, before it is deleted
+		virtual void notifyRemoved(Devs<X,T>*){}
+		/// Destructor
+		virtual ~AbstractLogicalProcess(){}
+};
+
 } // end of namespace
 
 #endif
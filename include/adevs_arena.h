@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_arena_h_
+#define __adevs_arena_h_
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace adevs
+{
+
+/**
+ * <P>The Arena is a bump allocator for objects that live until the end
+ * of a simulation cycle. Allocating an object moves a pointer within a
+ * large block of memory, and the reset method destroys every object that
+ * was created since the last reset at once. The blocks are kept for
+ * reuse, and so an Arena that has warmed up does not touch the heap.</P>
+ * <P>The Simulator gives each atomic model access to an Arena in its
+ * output function (see Atomic::getOutputArena()) and resets it at the end
+ * of computeNextState().</P>
+ */
+class Arena
+{
+	public:
+		/// Create an arena that gets memory in blocks of at least block_size bytes
+		Arena(size_t block_size = 65536):
+			block_size(block_size),
+			current(0),
+			used(0)
+		{
+		}
+		/**
+		 * Get size bytes of uninitialized memory that is aligned for any
+		 * type. The memory is released by the next reset.
+		 */
+		void* allocate(size_t size)
+		{
+			size = (size+align-1) & ~(align-1);
+			while (current < blocks.size() && used+size > blocks[current].size)
+			{
+				current++;
+				used = 0;
+			}
+			if (current == blocks.size())
+			{
+				block blk;
+				blk.size = (size > block_size) ? size : block_size;
+				blk.mem = static_cast<char*>(malloc(blk.size));
+				if (blk.mem == NULL) throw std::bad_alloc();
+				blocks.push_back(blk);
+				used = 0;
+			}
+			void* result = blocks[current].mem+used;
+			used += size;
+			return result;
+		}
+		/// Create a default constructed object that is destroyed by the next reset
+		template <class T> T* create()
+		{
+			T* obj = new(allocate(sizeof(T))) T();
+			remember(obj);
+			return obj;
+		}
+		/// Create an object with a single argument constructor (e.g., a copy)
+		template <class T, class A1> T* create(const A1& a1)
+		{
+			T* obj = new(allocate(sizeof(T))) T(a1);
+			remember(obj);
+			return obj;
+		}
+		/// Create an object with a two argument constructor
+		template <class T, class A1, class A2> T* create(const A1& a1, const A2& a2)
+		{
+			T* obj = new(allocate(sizeof(T))) T(a1,a2);
+			remember(obj);
+			return obj;
+		}
+		/**
+		 * Destroy the objects created since the last reset, in the
+		 * reverse order of their creation, and make all of the memory
+		 * available again.
+		 */
+		void reset()
+		{
+			while (!objs.empty())
+			{
+				objs.back().destroy(objs.back().obj);
+				objs.pop_back();
+			}
+			current = 0;
+			used = 0;
+		}
+		/// Returns true if nothing has been allocated since the last reset
+		bool empty() const { return current == 0 && used == 0; }
+		/// Destroys the remaining objects and frees the memory
+		~Arena()
+		{
+			reset();
+			for (unsigned i = 0; i < blocks.size(); i++)
+				free(blocks[i].mem);
+		}
+	private:
+		// Alignment of every allocation
+		static const size_t align = 16;
+		struct block
+		{
+			char* mem;
+			size_t size;
+		};
+		// An object that must be destroyed by the next reset
+		struct destructor
+		{
+			void (*destroy)(void*);
+			void* obj;
+		};
+		size_t block_size;
+		std::vector<block> blocks;
+		// The block in use and the number of bytes used in it
+		unsigned current;
+		size_t used;
+		std::vector<destructor> objs;
+		template <class T> static void destroy(void* obj)
+		{
+			static_cast<T*>(obj)->~T();
+		}
+		template <class T> void remember(T* obj)
+		{
+			destructor d;
+			d.destroy = destroy<T>;
+			d.obj = obj;
+			objs.push_back(d);
+		}
+		// No copying
+		Arena(const Arena&);
+		void operator=(const Arena&);
+};
+
+} // end of namespace
+
+#endif
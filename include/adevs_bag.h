@@ -31,6 +31,13 @@
 #ifndef _adevs_bag_h
 #define _adevs_bag_h
 #include <cstdlib>
+#include <new>
+#if __cplusplus >= 201103L
+#include <utility>
+#define ADEVS_BAG_MOVE(x) std::move(x)
+#else
+#define ADEVS_BAG_MOVE(x) (x)
+#endif
 
 namespace adevs
 {
@@ -41,6 +48,11 @@ namespace adevs
  * does not satisfy the STL complexity requirements. Neither does it implement
  * the full set of required methods, but those methods that are implemented
  * conform to the standard (except for the time complexity requirement).
+ * Most bags used by the simulator hold only one or two elements, and so
+ * the first two elements are stored inside of the Bag itself. More
+ * elements are stored in uninitialized memory on the heap that doubles
+ * in size as needed. Elements are moved instead of copied if the compiler
+ * supports C++11.
  */
 template <class T> class Bag
 {
@@ -73,43 +85,84 @@ template <class T> class Bag
 				T* b;
 		};
 		typedef iterator const_iterator;
-		/// Create an empty bag with an initial capacity
-		Bag(unsigned int cap = 8):
-		cap_(cap),size_(0),b(new T[cap]){}
-		/// Copy constructor uses the = operator of T
+		/// Create an empty bag with room for at least cap elements
+		Bag(unsigned int cap = 0):
+		cap_(inline_cap),size_(0),b(inline_data())
+		{
+			reserve(cap);
+		}
+		/// Copy constructor uses the copy constructor of T
 		Bag(const Bag<T>& src):
-		cap_(src.cap_),
-		size_(src.size_)
+		cap_(inline_cap),size_(0),b(inline_data())
 		{
-			b = new T[src.cap_];
-			for (unsigned int i = 0; i < size_; i++) 
-				b[i] = src.b[i];
+			reserve(src.size_);
+			for (; size_ < src.size_; size_++)
+				new(b+size_) T(src.b[size_]);
 		}
-		/// Assignment operator uses the = operator of T
+		/// Assignment operator uses the copy constructor of T
 		const Bag<T>& operator=(const Bag<T>& src)
 		{
-			cap_ = src.cap_;
-			size_ = src.size_;
-			delete [] b;
-			b = new T[src.cap_];
-			for (unsigned int i = 0; i < size_; i++) 
-				b[i] = src.b[i];
+			if (this == &src) return *this;
+			clear();
+			reserve(src.size_);
+			for (; size_ < src.size_; size_++)
+				new(b+size_) T(src.b[size_]);
+			return *this;
+		}
+#if __cplusplus >= 201103L
+		/// Move constructor takes the elements of src, leaving it empty
+		Bag(Bag<T>&& src):
+		cap_(inline_cap),size_(0),b(inline_data())
+		{
+			take(src);
+		}
+		/// Move assignment takes the elements of src, leaving it empty
+		Bag<T>& operator=(Bag<T>&& src)
+		{
+			if (this == &src) return *this;
+			clear();
+			release();
+			take(src);
 			return *this;
 		}
+		/// Move t into the bag
+		void insert(T&& t)
+		{
+			if (cap_ == size_) enlarge(2*cap_);
+			new(b+size_) T(std::move(t));
+			size_++;
+		}
+		/// Construct an element in the bag from the arguments
+		template <class... Args> void emplace(Args&&... args)
+		{
+			if (cap_ == size_) enlarge(2*cap_);
+			new(b+size_) T(std::forward<Args>(args)...);
+			size_++;
+		}
+#endif
 		/// Swaps contents of this bag with the contents of the supplied bag. Returns this bag.
 		Bag<T>& swap(Bag<T>& src)
 		{
-			unsigned tmp_cap_, tmp_size_;
-			T* tmp_b;
-			tmp_cap_ = src.cap_;
-			tmp_size_ = src.size_;
-			tmp_b = src.b;
-			src.cap_ = cap_;
-			src.size_ = size_;
-			src.b = b;
-			cap_ = tmp_cap_;
-			size_ = tmp_size_;
-			b = tmp_b;
+			if (this == &src) return *this;
+			// Exchange the heap storage if both bags have it
+			if (b != inline_data() && src.b != src.inline_data())
+			{
+				unsigned tmp_cap_ = src.cap_, tmp_size_ = src.size_;
+				T* tmp_b = src.b;
+				src.cap_ = cap_;
+				src.size_ = size_;
+				src.b = b;
+				cap_ = tmp_cap_;
+				size_ = tmp_size_;
+				b = tmp_b;
+			}
+			// Otherwise exchange the elements
+			else
+			{
+				Bag<T> tmp(ADEVS_BAG_MOVE(src));
+				src = ADEVS_BAG_MOVE(*this);
+				*this = ADEVS_BAG_MOVE(tmp);
+			}
 			return *this;
 		}
 		/// Count the instances of a stored in the bag
@@ -138,10 +191,16 @@ template <class T> class Bag
 		void erase(iterator p)
 		{
 			size_--;
-			b[p.i] = b[size_];
+			if (p.i != size_)
+				b[p.i] = ADEVS_BAG_MOVE(b[size_]);
+			b[size_].~T();
 		}
 		/// Remove all of the elements from the bag
-		void clear() { size_ = 0; }
+		void clear()
+		{
+			while (size_ > 0)
+				b[--size_].~T();
+		}
 		/// Find the first instance of k, or end() if no instance is found. Uses == for comparing T.
 		iterator find(const T& k) const
 		{
@@ -153,23 +212,74 @@ template <class T> class Bag
 		void insert(const T& t)
 		{
 			if (cap_ == size_) enlarge(2*cap_);
-			b[size_] = t;
+			new(b+size_) T(t);
 			size_++;
 		}
-		~Bag() { delete [] b; }
-	private:	
+		/// Make room for at least cap elements
+		void reserve(unsigned cap)
+		{
+			if (cap > cap_) enlarge(cap);
+		}
+		~Bag()
+		{
+			clear();
+			release();
+		}
+	private:
+		// Number of elements stored inside of the bag
+		static const unsigned inline_cap = 2;
 		unsigned cap_, size_;
 		T* b;
-		/// Adds the specified capacity to the bag.
-		void enlarge(unsigned adjustment)
-		{
-			cap_ = cap_ + adjustment;
-			T* rb = new T[cap_];
-			for (unsigned i = 0; i < size_; i++) 
-				rb[i] = b[i];
-			delete [] b;
+		// Storage for the first elements
+		union
+		{
+			char bytes[inline_cap*sizeof(T)];
+			void* align_ptr;
+			long align_long;
+			double align_double;
+			long double align_long_double;
+		} store;
+		T* inline_data() { return reinterpret_cast<T*>(store.bytes); }
+		/// Move the elements to storage with the new capacity.
+		void enlarge(unsigned new_cap)
+		{
+			T* rb = static_cast<T*>(::operator new(new_cap*sizeof(T)));
+			for (unsigned i = 0; i < size_; i++)
+			{
+				new(rb+i) T(ADEVS_BAG_MOVE(b[i]));
+				b[i].~T();
+			}
+			release();
+			cap_ = new_cap;
 			b = rb;
 		}
+		/// Free the heap storage, if any, and go back to the inline storage
+		void release()
+		{
+			if (b != inline_data())
+				::operator delete(b);
+			b = inline_data();
+			cap_ = inline_cap;
+		}
+		/// Move the elements of src into this empty bag, leaving src empty
+		void take(Bag<T>& src)
+		{
+			if (src.b != src.inline_data())
+			{
+				b = src.b;
+				cap_ = src.cap_;
+				size_ = src.size_;
+				src.b = src.inline_data();
+				src.cap_ = inline_cap;
+				src.size_ = 0;
+			}
+			else
+			{
+				for (; size_ < src.size_; size_++)
+					new(b+size_) T(ADEVS_BAG_MOVE(src.b[size_]));
+				src.clear();
+			}
+		}
 	};
 
 } // end of namespace
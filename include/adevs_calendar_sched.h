@@ -0,0 +1,375 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_calendar_schedule_h_
+#define __adevs_calendar_schedule_h_
+#include "adevs_time.h"
+#include "adevs_models.h"
+#include "adevs_sched.h"
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+namespace adevs
+{
+
+/**
+ * <p>This is a calendar queue for scheduling Atomic models. It may be used in
+ * place of the binary heap by supplying it as the scheduler template argument
+ * of the Simulator; e.g., Simulator<X,double,CalendarSchedule<X,double> >.
+ * Models are kept in an array of buckets that each cover an interval
+ * of time, and so the cost of enqueuing, dequeuing, and rescheduling a
+ * model is, on average, constant rather than logarithmic in the number
+ * of models. The bucket count and width are recomputed as the
+ * schedule grows and shrinks.</p>
+ * <p>Like the Schedule, this class uses the q_index attribute of the Atomic
+ * model to find the model in the queue. The q_index value for a model
+ * must be zero when the model is placed into the calendar for the first
+ * time, and a model can be put into only one schedule. Because the bucket
+ * is computed from the time of the event, the time type T must be
+ * convertible to a double.</p>
+ */
+template <class X, class T = double> class CalendarSchedule
+{
+	public:
+		/// The calendar accepts the same visitors as the Schedule
+		typedef typename Schedule<X,T>::ImminentVisitor ImminentVisitor;
+		/// Creates a scheduler with the default or specified initial capacity.
+		CalendarSchedule(unsigned int capacity = 100);
+		/// Get the model at the front of the queue.
+		Atomic<X,T>* getMinimum() const { return elem[min_elem].item; }
+		/// Get the time of the next event.
+		T minPriority() const { return elem[min_elem].priority; }
+		/// Visit the imminent models.
+		void visitImminent(ImminentVisitor* visitor) const;
+		/// Append the imminent models to the bag.
+		void getImminent(Bag<Atomic<X,T>*>& imm) const;
+		/// Remove the model at the front of the queue.
+		void removeMinimum();
+		/// Add, remove, or move a model as required by its priority.
+		void schedule(Atomic<X,T>* model, T priority);
+		/// Schedule many models at once. Insertion is already constant time.
+		void scheduleAll(const std::vector<Atomic<X,T>*>& models,
+			const std::vector<T>& priority)
+		{
+			for (unsigned int i = 0; i < models.size(); i++)
+				schedule(models[i],priority[i]);
+		}
+		/// Returns true if the queue is empty, and false otherwise.
+		bool empty() const { return size == 0; }
+		/// Get the number of elements in the calendar.
+		unsigned int getSize() const { return size; }
+		/// Destructor.
+		~CalendarSchedule();
+	private:
+		// Element in the calendar. Element zero is a sentinel with
+		// infinite priority that terminates the bucket lists.
+		struct cal_element
+		{
+			Atomic<X,T>* item;
+			T priority;
+			unsigned int next, prev, bucket;
+			cal_element():
+				item(NULL),priority(adevs_inf<T>()),
+				next(0),prev(0),bucket(0){}
+		};
+		// Smallest number of buckets in the calendar
+		static const unsigned int min_buckets = 16;
+		// Number of events sampled to compute the bucket width
+		static const unsigned int width_sample = 1024;
+		unsigned int capacity, size, free_list, min_elem, nbuckets;
+		cal_element* elem;
+		// Index of the first element in each bucket, or zero if empty
+		unsigned int* bucket;
+		// Interval of time covered by each bucket
+		double width;
+		static double to_double(T t) { return static_cast<double>(t); }
+		/// Get the calendar day (i.e., unwrapped bucket) for a priority
+		double day_of(T priority) const { return floor(to_double(priority)/width); }
+		/// Get the bucket that contains a priority
+		unsigned int bucket_of(T priority) const
+		{
+			// The number of buckets is always a power of two
+			double day = day_of(priority);
+			if (day < 1E18) return (unsigned int)((unsigned long long)day & (nbuckets-1));
+			return (unsigned int)fmod(day,(double)nbuckets);
+		}
+		/// Put an element into its bucket and update the minimum
+		void link(unsigned int i);
+		/// Take an element out of its bucket and update the minimum
+		void unlink(unsigned int i);
+		/// Remove an element from the calendar
+		void remove(unsigned int i);
+		/// Find the minimum assuming no element has a priority less than start
+		void find_minimum(T start);
+		/// Double the number of elements that can be stored
+		void enlarge();
+		/// Change the number of buckets and recompute their width
+		void resize(unsigned int new_nbuckets);
+};
+
+template <class X, class T>
+CalendarSchedule<X,T>::CalendarSchedule(unsigned int capacity):
+	capacity(std::max(capacity,2U)),size(0),free_list(0),min_elem(0),
+	nbuckets(min_buckets),elem(new cal_element[this->capacity]),
+	bucket(new unsigned int[min_buckets]),width(1.0)
+{
+	// Element zero is never used, the rest go into the free list
+	for (unsigned int i = this->capacity-1; i > 0; i--)
+	{
+		elem[i].next = free_list;
+		free_list = i;
+	}
+	for (unsigned int i = 0; i < nbuckets; i++)
+		bucket[i] = 0;
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::visitImminent(ImminentVisitor* visitor) const
+{
+	// The imminent models share a bucket and are at the front of it
+	T tN = minPriority();
+	for (unsigned int i = min_elem; i != 0 && !(tN < elem[i].priority); i = elem[i].next)
+		visitor->visit(elem[i].item);
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::getImminent(Bag<Atomic<X,T>*>& imm) const
+{
+	T tN = minPriority();
+	for (unsigned int i = min_elem; i != 0 && !(tN < elem[i].priority); i = elem[i].next)
+		imm.insert(elem[i].item);
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::removeMinimum()
+{
+	// Don't do anything if the calendar is empty
+	if (size == 0) return;
+	remove(min_elem);
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::schedule(Atomic<X,T>* model, T priority)
+{
+	// If the model is in the schedule
+	if (model->q_index != 0)
+	{
+		unsigned int i = model->q_index;
+		// Remove the model if the next event time is infinite
+		if (priority >= adevs_inf<T>()) remove(i);
+		// Move it to the correct bucket if the priority changed
+		else if (priority < elem[i].priority || elem[i].priority < priority)
+		{
+			unlink(i);
+			elem[i].priority = priority;
+			link(i);
+		}
+	}
+	// If it is not in the schedule and the next event time is
+	// not at infinity, then add it to the schedule
+	else if (priority < adevs_inf<T>())
+	{
+		if (free_list == 0) enlarge();
+		unsigned int i = free_list;
+		free_list = elem[i].next;
+		elem[i].item = model;
+		elem[i].priority = priority;
+		model->q_index = i;
+		size++;
+		link(i);
+		if (size > 2*nbuckets) resize(2*nbuckets);
+	}
+	// Otherwise, the model is not enqueued and has no next event
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::remove(unsigned int i)
+{
+	unlink(i);
+	// Set index to 0 to show that this model is not in the schedule
+	elem[i].item->q_index = 0;
+	elem[i].item = NULL;
+	elem[i].priority = adevs_inf<T>();
+	elem[i].next = free_list;
+	free_list = i;
+	size--;
+	if (nbuckets > min_buckets && size < nbuckets/2) resize(nbuckets/2);
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::link(unsigned int i)
+{
+	unsigned int b = bucket_of(elem[i].priority);
+	unsigned int prev = 0, next = bucket[b];
+	// Models are sorted by priority and a new model goes in front of
+	// any models with the same priority. This makes clustered events
+	// cheap to insert and keeps the minimum at the head of its bucket.
+	while (next != 0 && elem[next].priority < elem[i].priority)
+	{
+		prev = next;
+		next = elem[next].next;
+	}
+	elem[i].bucket = b;
+	elem[i].prev = prev;
+	elem[i].next = next;
+	if (next != 0) elem[next].prev = i;
+	if (prev != 0) elem[prev].next = i;
+	else bucket[b] = i;
+	if (!(elem[min_elem].priority < elem[i].priority)) min_elem = i;
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::unlink(unsigned int i)
+{
+	unsigned int prev = elem[i].prev, next = elem[i].next;
+	if (prev != 0) elem[prev].next = next;
+	else bucket[elem[i].bucket] = next;
+	if (next != 0) elem[next].prev = prev;
+	if (i != min_elem) return;
+	// The next model in the bucket is the new minimum if it is imminent 
+	if (next != 0 && !(elem[i].priority < elem[next].priority))
+		min_elem = next;
+	// Otherwise search the calendar
+	else
+	{
+		min_elem = 0;
+		find_minimum(elem[i].priority);
+	}
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::find_minimum(T start)
+{
+	// Look through one year of the calendar beginning at the day
+	// that contains start. Days are compared rather than times so that
+	// the search agrees exactly with the bucket assignment. 
+	double day = day_of(start);
+	unsigned int b = bucket_of(start);
+	for (unsigned int k = 0; k < nbuckets; k++)
+	{
+		unsigned int i = bucket[b];
+		if (i != 0 && day_of(elem[i].priority) <= day)
+		{
+			min_elem = i;
+			return;
+		}
+		day += 1.0;
+		if (++b == nbuckets) b = 0;
+	}
+	// Nothing this year, so look directly for the smallest item 
+	for (b = 0; b < nbuckets; b++)
+	{
+		unsigned int i = bucket[b];
+		if (i != 0 && elem[i].priority < elem[min_elem].priority)
+			min_elem = i;
+	}
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::enlarge()
+{
+	cal_element* relem = new cal_element[capacity*2];
+	for (unsigned int i = 0; i < capacity; i++)
+		relem[i] = elem[i];
+	for (unsigned int i = capacity*2-1; i >= capacity; i--)
+	{
+		relem[i].next = free_list;
+		free_list = i;
+	}
+	capacity *= 2;
+	delete [] elem;
+	elem = relem;
+}
+
+template <class X, class T>
+void CalendarSchedule<X,T>::resize(unsigned int new_nbuckets)
+{
+	// Gather the models that are in the calendar
+	std::vector<unsigned int> items;
+	items.reserve(size);
+	for (unsigned int b = 0; b < nbuckets; b++)
+	{
+		for (unsigned int i = bucket[b]; i != 0; i = elem[i].next)
+			items.push_back(i);
+	}
+	// Estimate the average separation of events at the front of the
+	// queue and make each bucket a few times wider than that.
+	std::vector<double> sample;
+	sample.reserve(items.size());
+	for (unsigned int k = 0; k < items.size(); k++)
+		sample.push_back(to_double(elem[items[k]].priority));
+	if (sample.size() > width_sample)
+	{
+		std::nth_element(sample.begin(),sample.begin()+width_sample,sample.end());
+		sample.resize(width_sample);
+	}
+	std::sort(sample.begin(),sample.end());
+	if (sample.size() > 1)
+	{
+		double avg = (sample.back()-sample.front())/(double)(sample.size()-1);
+		// Discard separations that are much larger than the average
+		double trimmed_sum = 0.0;
+		unsigned int trimmed_count = 0;
+		for (unsigned int k = 1; k < sample.size(); k++)
+		{
+			double sep = sample[k]-sample[k-1];
+			if (sep <= 2.0*avg)
+			{
+				trimmed_sum += sep;
+				trimmed_count++;
+			}
+		}
+		if (trimmed_sum > 0.0) avg = trimmed_sum/(double)trimmed_count;
+		// Keep the old width if every sampled event is simultaneous
+		if (avg > 0.0) width = 3.0*avg;
+	}
+	// Rebuild the buckets
+	delete [] bucket;
+	nbuckets = new_nbuckets;
+	bucket = new unsigned int[nbuckets];
+	for (unsigned int b = 0; b < nbuckets; b++)
+		bucket[b] = 0;
+	min_elem = 0;
+	for (unsigned int k = 0; k < items.size(); k++)
+		link(items[k]);
+}
+
+template <class X, class T>
+CalendarSchedule<X,T>::~CalendarSchedule()
+{
+	delete [] elem;
+	delete [] bucket;
+}
+
+} // end of namespace
+
+#endif
@@ -107,6 +107,9 @@ template <class X, class T = double> class CellSpace: public Network<CellEvent<X
 		long int getDepth() const { return d; }
 		/// Get the model's set of components
 		void getComponents(Set<Cell*>& c);
+		/// Visit the model's components without copying them
+		void visitComponents(
+			typename Network<CellEvent<X>,T>::ComponentVisitor* visitor);
 		/// Route events within the Cellspace
 		void route(const CellEvent<X>& event, Cell* model, 
 		Bag<Event<CellEvent<X>,T> >& r);
@@ -163,6 +166,23 @@ CellSpace<X,T>::~CellSpace()
 	delete [] space;
 }
 
+template <class X, class T>
+void CellSpace<X,T>::visitComponents(
+	typename Network<CellEvent<X>,T>::ComponentVisitor* visitor)
+{
+	for (long int x = 0; x < w; x++)
+	{
+		for (long int y = 0; y < h; y++)
+		{
+			for (long int z = 0; z < d; z++)
+			{
+				if (space[x][y][z] != NULL)
+					visitor->visit(space[x][y][z]);
+			}
+		}
+	}
+}
+
 // Implementation of the getComponents() method
 template <class X, class T>
 void CellSpace<X,T>::getComponents(Set<Cell*>& c)
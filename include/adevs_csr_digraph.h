@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_csr_digraph_h_
+#define __adevs_csr_digraph_h_
+#include "adevs.h"
+#include <vector>
+#include <cstdlib>
+
+namespace adevs
+{
+
+/*
+ * The PortValue is declared here because this file may be read by way
+ * of adevs.h before the rest of adevs_digraph.h.
+ */
+template <class VALUE, class PORT> class PortValue;
+
+/**
+ * The CsrDigraph is a Digraph for large networks whose components use
+ * integer ports. Each component is given a dense integer ID when it is
+ * added, and the couplings are stored in compressed sparse row form:
+ * the targets of every (component,port) pair sit together in one array.
+ * The route method finds the component's ID with a hash table and the
+ * row of its port by indexing, and so it does not search a tree as the
+ * Digraph does. Its components must use PortValue<VALUE,int> objects
+ * as their input/output type, and the ports must not be negative.
+ * The arrays are rebuilt by the first call to route after a coupling is
+ * added. Like the Digraph, its routes are static and the couple method
+ * tells the Simulator to recompile them, and so the couplings may be
+ * changed at any time.
+ */
+template <class VALUE, class T = double> class CsrDigraph: 
+public Network<PortValue<VALUE,int>,T>
+{
+	public:
+		/// An input or output to a component model
+		typedef PortValue<VALUE,int> IO_Type;
+		/// A component of the CsrDigraph model
+		typedef Devs<IO_Type,T> Component;
+
+		/// Construct a network with no components.
+		CsrDigraph();
+		/// Add a model to the network.
+		void add(Component* model);
+		/**
+		 * Couple the source model to the destination model. Throws an
+		 * adevs::exception if either port is negative.
+		 */
+		void couple(Component* src, int srcPort, Component* dst, int dstPort);
+		/// Puts the network's components into to c
+		void getComponents(Set<Component*>& c);
+		/// Visit the network's components without copying them
+		void visitComponents(typename Network<IO_Type,T>::ComponentVisitor* visitor);
+		/// Route an event based on the coupling information.
+		void route(const IO_Type& x, Component* model, 
+		Bag<Event<IO_Type,T> >& r);
+		/// The targets depend only on the model and port.
+		bool routesAreStatic() const { return true; }
+		/// Visit the source and target of every coupling
+		bool visitCouplings(typename Network<IO_Type,T>::CouplingVisitor* visitor);
+		/// Destructor.  Destroys all of the component models.
+		~CsrDigraph();
+
+	private:
+		// A coupling
+		struct edge
+		{
+			int src, src_port, dst, dst_port;
+		};
+		// A target of a coupling
+		struct target
+		{
+			Component* model;
+			int port;
+		};
+		// Component model set
+		Set<Component*> models;
+		// Models indexed by their ID. The network itself is zero.
+		std::vector<Component*> ids;
+		// Open addressing hash table from models to their IDs
+		std::vector<Component*> hash_key;
+		std::vector<int> hash_id;
+		// The couplings in the order they were made
+		std::vector<edge> edges;
+		// Set when the compressed arrays do not match the couplings
+		bool dirty;
+		// Row of port zero of each model and the number of its ports
+		std::vector<unsigned> first_row, num_ports;
+		// Start of the targets of each row in targets
+		std::vector<unsigned> row_start;
+		std::vector<target> targets;
+		// Slot of the model in the hash table
+		unsigned slot(const Component* model) const;
+		// Get the ID of a model, adding it to the table if it is not there
+		int get_id(Component* model);
+		// Build the compressed arrays
+		void build();
+};
+
+template <class VALUE, class T>
+CsrDigraph<VALUE,T>::CsrDigraph():
+	Network<IO_Type,T>(),
+	hash_key(16,(Component*)NULL),
+	hash_id(16,-1),
+	dirty(false)
+{
+	get_id(this);
+}
+
+template <class VALUE, class T>
+unsigned CsrDigraph<VALUE,T>::slot(const Component* model) const
+{
+	unsigned mask = hash_key.size()-1;
+	// Fibonacci hashing of the address with the low bits, which
+	// are the same for all objects, shifted out
+	size_t h = ((size_t)model >> 4)*2654435761UL;
+	unsigned k = (unsigned)(h ^ (h >> 16)) & mask;
+	while (hash_key[k] != NULL && hash_key[k] != model)
+		k = (k+1) & mask;
+	return k;
+}
+
+template <class VALUE, class T>
+int CsrDigraph<VALUE,T>::get_id(Component* model)
+{
+	unsigned k = slot(model);
+	if (hash_key[k] == model) return hash_id[k];
+	// Keep the table at most half full
+	if (2*(ids.size()+1) > hash_key.size())
+	{
+		hash_key.assign(2*hash_key.size(),(Component*)NULL);
+		hash_id.assign(hash_key.size(),-1);
+		for (unsigned i = 0; i < ids.size(); i++)
+		{
+			unsigned j = slot(ids[i]);
+			hash_key[j] = ids[i];
+			hash_id[j] = i;
+		}
+		k = slot(model);
+	}
+	hash_key[k] = model;
+	hash_id[k] = ids.size();
+	ids.push_back(model);
+	return hash_id[k];
+}
+
+template <class VALUE, class T>
+void CsrDigraph<VALUE,T>::add(Component* model)
+{
+	assert(model != this);
+	models.insert(model);
+	model->setParent(this);
+	get_id(model);
+}
+
+template <class VALUE, class T>
+void CsrDigraph<VALUE,T>::couple(Component* src, int srcPort, 
+Component* dst, int dstPort)
+{
+	if (srcPort < 0 || dstPort < 0)
+	{
+		exception err("CsrDigraph ports must not be negative",this);
+		throw err;
+	}
+	if (src != this) add(src);
+	if (dst != this) add(dst);
+	edge e;
+	e.src = get_id(src);
+	e.src_port = srcPort;
+	e.dst = get_id(dst);
+	e.dst_port = dstPort;
+	edges.push_back(e);
+	dirty = true;
+	this->couplingsChanged();
+}
+
+template <class VALUE, class T>
+void CsrDigraph<VALUE,T>::build()
+{
+	unsigned i, n = ids.size();
+	// Find the number of ports of each model and give each port a row
+	num_ports.assign(n,0);
+	for (i = 0; i < edges.size(); i++)
+	{
+		unsigned p = edges[i].src_port+1;
+		if (num_ports[edges[i].src] < p)
+			num_ports[edges[i].src] = p;
+	}
+	first_row.resize(n);
+	unsigned rows = 0;
+	for (i = 0; i < n; i++)
+	{
+		first_row[i] = rows;
+		rows += num_ports[i];
+	}
+	// Count the targets in each row and then place them, keeping the
+	// order in which the couplings were made
+	row_start.assign(rows+1,0);
+	for (i = 0; i < edges.size(); i++)
+		row_start[first_row[edges[i].src]+edges[i].src_port+1]++;
+	for (i = 0; i < rows; i++)
+		row_start[i+1] += row_start[i];
+	targets.resize(edges.size());
+	std::vector<unsigned> next(row_start.begin(),row_start.end()-1);
+	for (i = 0; i < edges.size(); i++)
+	{
+		unsigned k = next[first_row[edges[i].src]+edges[i].src_port]++;
+		targets[k].model = ids[edges[i].dst];
+		targets[k].port = edges[i].dst_port;
+	}
+	dirty = false;
+}
+
+template <class VALUE, class T>
+void CsrDigraph<VALUE,T>::getComponents(Set<Component*>& c)
+{
+	c = models;
+}
+
+template <class VALUE, class T>
+void CsrDigraph<VALUE,T>::visitComponents(
+	typename Network<IO_Type,T>::ComponentVisitor* visitor)
+{
+	typename Set<Component*>::iterator iter = models.begin();
+	for (; iter != models.end(); iter++)
+		visitor->visit(*iter);
+}
+
+template <class VALUE, class T>
+bool CsrDigraph<VALUE,T>::visitCouplings(
+	typename Network<IO_Type,T>::CouplingVisitor* visitor)
+{
+	for (unsigned i = 0; i < edges.size(); i++)
+		visitor->visit(ids[edges[i].src],ids[edges[i].dst]);
+	return true;
+}
+
+template <class VALUE, class T>
+void CsrDigraph<VALUE,T>::
+route(const IO_Type& x, Component* model, 
+Bag<Event<IO_Type,T> >& r)
+{
+	if (dirty) build();
+	// Find the row for the model and port
+	unsigned k = slot(model);
+	if (hash_key[k] != model || x.port < 0) return;
+	int id = hash_id[k];
+	if ((unsigned)x.port >= num_ports[id]) return;
+	unsigned row = first_row[id]+x.port;
+	// Add the targets to the event bag
+	Event<IO_Type,T> event;
+	event.value.value = x.value;
+	for (unsigned i = row_start[row]; i < row_start[row+1]; i++)
+	{
+		event.model = targets[i].model;
+		event.value.port = targets[i].port;
+		r.insert(event);
+	}
+}
+
+template <class VALUE, class T>
+CsrDigraph<VALUE,T>::~CsrDigraph()
+{ 
+	typename Set<Component*>::iterator i;
+	for (i = models.begin(); i != models.end(); i++)
+	{
+		delete *i;
+	}
+}
+
+} // end of namespace 
+
+#endif
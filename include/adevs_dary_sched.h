@@ -0,0 +1,357 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_dary_schedule_h_
+#define __adevs_dary_schedule_h_
+#include "adevs_time.h"
+#include "adevs_models.h"
+#include "adevs_sched.h"
+#include <vector>
+#include <cstdlib>
+
+namespace adevs
+{
+
+/**
+ * <p>This is a D-ary heap (D = 4 by default) for scheduling Atomic models
+ * that may be used in place of the binary heap by supplying it as the
+ * scheduler template argument of the Simulator; e.g.,
+ * Simulator<X,double,DaryHeapSchedule<X,double> >.</p>
+ * <p>The priorities are kept in an array of their own with the children of
+ * each node packed together and aligned to a cache line, so that choosing the
+ * smallest child reads a single line of memory and a heap of n models
+ * is only log_D(n) levels deep. The models are not touched while the heap
+ * is reordered. The positions of the models that were moved are
+ * remembered and their q_index attributes are updated after the
+ * reordering is finished.</p>
+ * <p>As with the Schedule, the q_index value for a model must be zero when it
+ * is put into the heap for the first time and a model can be put into only
+ * one schedule. D must be at least two.</p>
+ */
+template <class X, class T = double, unsigned int D = 4> class DaryHeapSchedule
+{
+	public:
+		/// The heap accepts the same visitors as the Schedule
+		typedef typename Schedule<X,T>::ImminentVisitor ImminentVisitor;
+		/// Creates a scheduler with the default or specified initial capacity.
+		DaryHeapSchedule(unsigned int capacity = 100);
+		/// Get the model at the front of the queue.
+		Atomic<X,T>* getMinimum() const
+		{
+			return (size == 0) ? NULL : item[0];
+		}
+		/// Get the time of the next event.
+		T minPriority() const
+		{
+			return (size == 0) ? adevs_inf<T>() : prio[0];
+		}
+		/// Visit the imminent models.
+		void visitImminent(ImminentVisitor* visitor) const;
+		/// Append the imminent models to the bag.
+		void getImminent(Bag<Atomic<X,T>*>& imm) const;
+		/// Remove the model at the front of the queue.
+		void removeMinimum() { if (size > 0) remove(0); }
+		/// Add, remove, or move a model as required by its priority.
+		void schedule(Atomic<X,T>* model, T priority);
+		/// Schedule many models at once, building the heap in linear time.
+		void scheduleAll(const std::vector<Atomic<X,T>*>& models,
+			const std::vector<T>& priority);
+		/// Returns true if the queue is empty, and false otherwise.
+		bool empty() const { return size == 0; }
+		/// Get the number of elements in the heap.
+		unsigned int getSize() const { return size; }
+		/// Destructor.
+		~DaryHeapSchedule();
+	private:
+		// Does not compile if D < 2. A unary heap is a list, and its
+		// paths would overflow the moved array.
+		typedef char arity_must_be_at_least_two[(D >= 2) ? 1 : -1];
+		unsigned int capacity, size;
+		// Storage for the priorities, and a pointer to the root that
+		// puts every group of siblings onto a cache line boundary
+		T *prio_mem, *prio;
+		// The model at each position in the heap
+		Atomic<X,T>** item;
+		// Positions whose models have moved and need a new q_index. A path
+		// through the heap is at most 64 levels long.
+		unsigned int moved[64];
+		unsigned int num_moved;
+		// Stack used to walk the imminent models
+		mutable std::vector<unsigned int> imm_stack;
+		// Buffer used to visit the imminent models
+		mutable Bag<Atomic<X,T>*> imm_buf;
+		/// Allocate the priority array with the siblings aligned
+		void allocate(unsigned int capacity);
+		/// Double the schedule capacity
+		void enlarge();
+		/// Remove the model at position i from the heap
+		void remove(unsigned int i);
+		/// Put the model with the priority into its place, starting at position i
+		void sift_up(unsigned int i, Atomic<X,T>* model, T priority);
+		void sift_down(unsigned int i, Atomic<X,T>* model, T priority);
+		/// Update the q_index of models that were moved
+		void write_back()
+		{
+			for (unsigned int k = 0; k < num_moved; k++)
+				item[moved[k]]->q_index = moved[k]+1;
+			num_moved = 0;
+		}
+};
+
+template <class X, class T, unsigned int D>
+DaryHeapSchedule<X,T,D>::DaryHeapSchedule(unsigned int capacity):
+	capacity(0),size(0),prio_mem(NULL),prio(NULL),item(NULL),num_moved(0)
+{
+	allocate((capacity < D) ? D : capacity);
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::allocate(unsigned int new_capacity)
+{
+	// The children of position i are at D*i+1,...,D*i+D and so the
+	// first group of siblings begins at 1. Offset the root so that
+	// position 1 lands on a 64 byte boundary.
+	const unsigned int pad = 64/sizeof(T)+1;
+	T* new_prio_mem = new T[new_capacity+pad];
+	unsigned int offset = 0;
+	if (64 % sizeof(T) == 0)
+	{
+		while ((((size_t)(new_prio_mem+offset+1)) & 63) != 0 && offset < pad-1)
+			offset++;
+	}
+	T* new_prio = new_prio_mem+offset;
+	Atomic<X,T>** new_item = new Atomic<X,T>*[new_capacity];
+	for (unsigned int i = 0; i < size; i++)
+	{
+		new_prio[i] = prio[i];
+		new_item[i] = item[i];
+	}
+	delete [] prio_mem;
+	delete [] item;
+	prio_mem = new_prio_mem;
+	prio = new_prio;
+	item = new_item;
+	capacity = new_capacity;
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::enlarge()
+{
+	allocate(2*capacity);
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::getImminent(Bag<Atomic<X,T>*>& imm) const
+{
+	if (size == 0) return;
+	// The imminent models form a subtree at the top of the heap
+	T tN = prio[0];
+	imm_stack.push_back(0);
+	while (!imm_stack.empty())
+	{
+		unsigned int i = imm_stack.back();
+		imm_stack.pop_back();
+		imm.insert(item[i]);
+		unsigned int last = D*i+D;
+		if (last >= size) last = size-1;
+		for (unsigned int c = D*i+1; c <= last; c++)
+		{
+			if (!(tN < prio[c])) imm_stack.push_back(c);
+		}
+	}
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::visitImminent(ImminentVisitor* visitor) const
+{
+	getImminent(imm_buf);
+	typename Bag<Atomic<X,T>*>::iterator iter = imm_buf.begin();
+	for (; iter != imm_buf.end(); iter++)
+		visitor->visit(*iter);
+	imm_buf.clear();
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::schedule(Atomic<X,T>* m, T priority)
+{
+	// If the model is in the schedule. Its q_index is its position plus one.
+	if (m->q_index != 0)
+	{
+		unsigned int i = m->q_index-1;
+		// Remove the model if the next event time is infinite
+		if (priority >= adevs_inf<T>()) remove(i);
+		// Decrease the time to next event
+		else if (priority < prio[i]) sift_up(i,m,priority);
+		// Increase the time to next event
+		else if (prio[i] < priority) sift_down(i,m,priority);
+		// Don't do anything if the priority is unchanged
+	}
+	// If it is not in the schedule and the next event time is
+	// not at infinity, then add it to the schedule
+	else if (priority < adevs_inf<T>())
+	{
+		if (size == capacity) enlarge();
+		sift_up(size++,m,priority);
+	}
+	// Otherwise, the model is not enqueued and has no next event
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::scheduleAll(const std::vector<Atomic<X,T>*>& models,
+	const std::vector<T>& priority)
+{
+	unsigned int i, old_size = size;
+	// Models that were already in the heap are rescheduled at the end
+	std::vector<unsigned int> old;
+	if (size+models.size() > capacity)
+		allocate(size+models.size());
+	// Put the other models at the end of the heap
+	for (i = 0; i < models.size(); i++)
+	{
+		Atomic<X,T>* m = models[i];
+		if (m->q_index != 0 && m->q_index <= old_size)
+			old.push_back(i);
+		// A model listed more than once is already at the end
+		else if (m->q_index != 0)
+		{
+			unsigned int k = m->q_index-1;
+			if (priority[i] < adevs_inf<T>())
+				prio[k] = priority[i];
+			else
+			{
+				size--;
+				prio[k] = prio[size];
+				item[k] = item[size];
+				item[k]->q_index = k+1;
+				m->q_index = 0;
+			}
+		}
+		else if (priority[i] < adevs_inf<T>())
+		{
+			if (size == capacity) enlarge();
+			prio[size] = priority[i];
+			item[size] = m;
+			m->q_index = ++size;
+		}
+	}
+	// If there are more new models than old, rebuild the whole heap
+	// from the bottom up. Otherwise insert the new models one by one.
+	if (size-old_size > old_size)
+	{
+		for (i = (size+D-2)/D; i > 0; i--)
+			sift_down(i-1,item[i-1],prio[i-1]);
+	}
+	else
+	{
+		for (i = old_size; i < size; i++)
+			sift_up(i,item[i],prio[i]);
+	}
+	for (i = 0; i < old.size(); i++)
+		schedule(models[old[i]],priority[old[i]]);
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::remove(unsigned int i)
+{
+	// Set index to 0 to show that this model is not in the schedule
+	item[i]->q_index = 0;
+	// Fill the hole with the last element in the heap
+	size--;
+	if (i == size) return;
+	Atomic<X,T>* last = item[size];
+	T p = prio[size];
+	if (i > 0 && p < prio[(i-1)/D]) sift_up(i,last,p);
+	else sift_down(i,last,p);
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::sift_up(unsigned int i, Atomic<X,T>* m, T priority)
+{
+	// Stop at the first parent that does not have a larger priority.
+	// This avoids moving past the many models that are scheduled
+	// for the same time when events are clustered.
+	while (i > 0)
+	{
+		unsigned int parent = (i-1)/D;
+		if (!(priority < prio[parent])) break;
+		prio[i] = prio[parent];
+		item[i] = item[parent];
+		moved[num_moved++] = i;
+		i = parent;
+	}
+	prio[i] = priority;
+	item[i] = m;
+	m->q_index = i+1;
+	write_back();
+}
+
+template <class X, class T, unsigned int D>
+void DaryHeapSchedule<X,T,D>::sift_down(unsigned int i, Atomic<X,T>* m, T priority)
+{
+	while (true)
+	{
+		unsigned int first = D*i+1;
+		if (first >= size) break;
+		// Find the smallest child. The loop over a complete group of
+		// siblings has a fixed trip count so that it can be unrolled
+		// and vectorized by the compiler.
+		unsigned int child = first;
+		if (first+D <= size)
+		{
+			for (unsigned int c = first+1; c < first+D; c++)
+				child = (prio[c] < prio[child]) ? c : child;
+		}
+		else
+		{
+			for (unsigned int c = first+1; c < size; c++)
+				child = (prio[c] < prio[child]) ? c : child;
+		}
+		if (!(prio[child] < priority)) break;
+		prio[i] = prio[child];
+		item[i] = item[child];
+		moved[num_moved++] = i;
+		i = child;
+	}
+	prio[i] = priority;
+	item[i] = m;
+	m->q_index = i+1;
+	write_back();
+}
+
+template <class X, class T, unsigned int D>
+DaryHeapSchedule<X,T,D>::~DaryHeapSchedule()
+{
+	delete [] prio_mem;
+	delete [] item;
+}
+
+} // end of namespace
+
+#endif
@@ -81,9 +81,22 @@ template <class VALUE, class PORT=int> class PortValue
 		VALUE value;
 };
 
+/**
+ * The route key of a PortValue is its port.
+ */
+template <class VALUE, class PORT> struct route_key<PortValue<VALUE,PORT> >
+{
+	typedef PORT type;
+	static type get(const PortValue<VALUE,PORT>& x) { return x.port; }
+	static void set(PortValue<VALUE,PORT>& x, const type& port) { x.port = port; }
+};
+
 /**
  * The digraph model is used to build block-diagrams from network and atomic components.
  * Its components must have PortValue objects as their input/output type.
+ * The routes of a Digraph are static (see Network::routesAreStatic()), and
+ * the couple method tells the Simulator to recompile them, and so the
+ * couplings may be changed at any time.
  */
 template <class VALUE, class PORT=int, class T = double> class Digraph: 
 public Network<PortValue<VALUE,PORT>,T>
@@ -106,9 +119,15 @@ public Network<PortValue<VALUE,PORT>,T>
 		Component* dst, PORT dstPort);
 		/// Puts the network's components into to c
 		void getComponents(Set<Component*>& c);
+		/// Visit the network's components without copying them
+		void visitComponents(typename Network<IO_Type,T>::ComponentVisitor* visitor);
 		/// Route an event based on the coupling information.
 		void route(const IO_Type& x, Component* model, 
 		Bag<Event<IO_Type,T> >& r);
+		/// The targets depend only on the model and port.
+		bool routesAreStatic() const { return true; }
+		/// Visit the source and target of every coupling
+		bool visitCouplings(typename Network<IO_Type,T>::CouplingVisitor* visitor);
 		/// Destructor.  Destroys all of the component models.
 		~Digraph();
 
@@ -165,6 +184,7 @@ Component* dst, PORT dstPort)
 	node src_node(src,srcPort);
 	node dst_node(dst,dstPort);
 	graph[src_node].insert(dst_node);
+	this->couplingsChanged();
 }
 
 template <class VALUE, class PORT, class T>
@@ -173,6 +193,29 @@ void Digraph<VALUE,PORT,T>::getComponents(Set<Component*>& c)
 	c = models;
 }
 
+template <class VALUE, class PORT, class T>
+void Digraph<VALUE,PORT,T>::visitComponents(
+	typename Network<IO_Type,T>::ComponentVisitor* visitor)
+{
+	typename Set<Component*>::iterator iter = models.begin();
+	for (; iter != models.end(); iter++)
+		visitor->visit(*iter);
+}
+
+template <class VALUE, class PORT, class T>
+bool Digraph<VALUE,PORT,T>::visitCouplings(
+	typename Network<IO_Type,T>::CouplingVisitor* visitor)
+{
+	typename std::map<node,Bag<node> >::iterator iter;
+	for (iter = graph.begin(); iter != graph.end(); iter++)
+	{
+		typename Bag<node>::iterator dst = (*iter).second.begin();
+		for (; dst != (*iter).second.end(); dst++)
+			visitor->visit((*iter).first.model,(*dst).model);
+	}
+	return true;
+}
+
 template <class VALUE, class PORT, class T>
 void Digraph<VALUE,PORT,T>::
 route(const IO_Type& x, Component* model, 
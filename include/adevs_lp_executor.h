@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_lp_executor_h_
+#define __adevs_lp_executor_h_
+#include "adevs_lp.h"
+#include "adevs_shared_value.h"
+#include <omp.h>
+#include <deque>
+#include <vector>
+
+namespace adevs
+{
+
+/**
+ * <P>The LpExecutor runs any number of logical processes on a fixed pool of
+ * OpenMP threads. Each logical process is a task that a thread runs for a
+ * few steps at a time. Every thread has a queue of tasks. A task that
+ * must wait for input from another process goes to the back of the queue
+ * so that the thread can run the others, and a thread with an empty queue
+ * steals a task from the back of another thread's queue. A task leaves
+ * the pool when its process reaches the end of the run.</P>
+ * <P>A logical process is run by one thread at a time, but it may move
+ * between threads. The queues are locked, and so everything that a
+ * process did on one thread is seen by the next thread that runs it.</P>
+ */
+template <class LP, class T> class LpExecutor
+{
+	public:
+		/**
+		 * Create an executor for the lp_count processes in the
+		 * array that uses the given number of threads.
+		 */
+		LpExecutor(LP** lp, int lp_count, int threads);
+		/// Run all of the processes until they reach t_stop
+		void run(T t_stop);
+		/// Get the number of tasks that the threads have stolen
+		unsigned long int getSteals() const { return steals; }
+		/// Get the number of threads
+		int getThreads() const { return threads; }
+		/// Destructor
+		~LpExecutor();
+	private:
+		// Steps that a task takes before it goes to the back of the queue
+		static const int slice = 16;
+		LP** lp;
+		const int lp_count, threads;
+		struct task_queue
+		{
+			omp_lock_t lock;
+			std::deque<int> q;
+		};
+		std::vector<task_queue*> queue;
+		volatile long done;
+		unsigned long int steals;
+		int pop(int thread);
+		int steal(int thread, unsigned& seed);
+		void push(int thread, int id);
+};
+
+template <class LP, class T>
+LpExecutor<LP,T>::LpExecutor(LP** lp, int lp_count, int threads):
+	lp(lp),lp_count(lp_count),threads(threads),done(0),steals(0)
+{
+	for (int i = 0; i < threads; i++)
+	{
+		queue.push_back(new task_queue);
+		omp_init_lock(&(queue.back()->lock));
+	}
+}
+
+template <class LP, class T>
+LpExecutor<LP,T>::~LpExecutor()
+{
+	for (int i = 0; i < threads; i++)
+	{
+		omp_destroy_lock(&(queue[i]->lock));
+		delete queue[i];
+	}
+}
+
+template <class LP, class T>
+int LpExecutor<LP,T>::pop(int thread)
+{
+	int id = -1;
+	omp_set_lock(&(queue[thread]->lock));
+	if (!queue[thread]->q.empty())
+	{
+		id = queue[thread]->q.front();
+		queue[thread]->q.pop_front();
+	}
+	omp_unset_lock(&(queue[thread]->lock));
+	return id;
+}
+
+template <class LP, class T>
+int LpExecutor<LP,T>::steal(int thread, unsigned& seed)
+{
+	// Start with a random victim and try all of the others
+	seed = seed*1103515245+12345;
+	int first = ((seed>>16)&0x7fff)%threads;
+	for (int k = 0; k < threads; k++)
+	{
+		int victim = (first+k)%threads;
+		if (victim == thread) continue;
+		int id = -1;
+		omp_set_lock(&(queue[victim]->lock));
+		if (!queue[victim]->q.empty())
+		{
+			id = queue[victim]->q.back();
+			queue[victim]->q.pop_back();
+		}
+		omp_unset_lock(&(queue[victim]->lock));
+		if (id >= 0) return id;
+	}
+	return -1;
+}
+
+template <class LP, class T>
+void LpExecutor<LP,T>::push(int thread, int id)
+{
+	omp_set_lock(&(queue[thread]->lock));
+	queue[thread]->q.push_back(id);
+	omp_unset_lock(&(queue[thread]->lock));
+}
+
+template <class LP, class T>
+void LpExecutor<LP,T>::run(T t_stop)
+{
+	done = 0;
+	for (int i = 0; i < lp_count; i++)
+	{
+		lp[i]->beginRun();
+		queue[i%threads]->q.push_back(i);
+	}
+	#pragma omp parallel num_threads(threads)
+	{
+		int thread = omp_get_thread_num();
+		unsigned seed = thread+1, idle = 0;
+		unsigned long int stolen = 0;
+		while (msgq_load(&done) < lp_count)
+		{
+			int id = pop(thread);
+			if (id < 0 && (id = steal(thread,seed)) >= 0) stolen++;
+			if (id < 0)
+			{
+				lp_yield();
+				continue;
+			}
+			typename LP::step_t result = LP::STEP_PROGRESS;
+			bool progress = false;
+			for (int k = 0; k < slice && result == LP::STEP_PROGRESS; k++)
+			{
+				result = lp[id]->step(t_stop);
+				progress = progress || (result != LP::STEP_BLOCKED);
+			}
+			if (result == LP::STEP_DONE)
+				shared_value_incr(&done);
+			else
+				push(thread,id);
+			// Give up the processor if none of our tasks can do anything
+			if (progress) idle = 0;
+			else if (++idle > (unsigned)(lp_count/threads)+16)
+			{
+				idle = 0;
+				lp_yield();
+			}
+		}
+		#pragma omp atomic
+		steals += stolen;
+	}
+}
+
+} // end of namespace
+
+#endif
@@ -48,6 +48,15 @@ class LpGraph
 	public:
 		/// Create a graph without any edges
 		LpGraph():nodes(0){}
+		/// Create a graph with nodes 0 to lp_count-1 and no edges
+		LpGraph(int lp_count):nodes(lp_count)
+		{
+			for (int i = 0; i < lp_count; i++)
+			{
+				E[i];
+				I[i];
+			}
+		}
 		/// Create an edge from node A to node B
 		void addEdge(int A, int B)
 		{
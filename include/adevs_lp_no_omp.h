@@ -29,6 +29,7 @@
  * Bugs, comments, and questions can be sent to nutaro@gmail.com
  */
 #include "adevs_time.h"
+#include "adevs_sched.h"
 
 namespace adevs
 {
@@ -36,7 +37,7 @@ namespace adevs
 /*
  * This is an empty class definition for compilers that do not support OpenMP.
  */
-template <typename X, class T = double> struct LogicalProcess
+template <typename X, class T = double, class S = Schedule<X,T> > struct LogicalProcess
 {
 	void addModel(Devs<X,T>*){}
 	Time<T> getNextEventTime() { return Time<T>::Inf(); } 
@@ -33,25 +33,60 @@
 #include "adevs_msg_manager.h"
 #include "adevs_abstract_simulator.h"
 #include "object_pool.h"
+#include "adevs_sched.h"
 #include "adevs_simulator.h"
+#include "adevs_model_transitions.h"
+#include "adevs_lp_trace.h"
 #include <omp.h>
 #include <iostream>
 #include <vector>
 #include <list>
 #include <map>
+#include <set>
 #include <queue>
 #include <limits>
 #include <cassert>
+#if __cplusplus >= 201103L
+#include <thread>
+#elif !defined(_WIN32)
+#include <sched.h>
+#endif
 
 namespace adevs
 {
 
+/// Let another thread have the processor
+inline void lp_yield()
+{
+#if __cplusplus >= 201103L
+	std::this_thread::yield();
+#elif !defined(_WIN32)
+	sched_yield();
+#endif
+}
+
 /**
  * A logical process is assigned to every atomic model and it simulates
- * that model conservatively. 
+ * that model conservatively. Null messages are sent on demand: a logical
+ * process that can not advance asks the influencers that hold back its
+ * earliest input time for a new one, and an influencer sends its earliest
+ * output time only to those that have asked for it. Each null message
+ * carries the latest earliest output time, no matter how many times it
+ * grew since the request, and is not sent if an output message already
+ * carried that time to the receiver. A logical process that is waiting
+ * lets the other threads run.
+ * Output is not computed ahead of the time at which a run stops, and so
+ * when every process has stopped at the same time, models can be moved
+ * from one process to another and the protocol started again.
+ * The structure of a network that belongs to the process, because it
+ * was given to addModel, changes when its model transition function
+ * says so. The process routes the input that other processes send to
+ * such a network. Changes to any other network are put off until every
+ * process has stopped (see takeModelTransitions).
  */
-template <class X, class T = double> class LogicalProcess:
-	public EventListener<X,T>
+template <class X, class T = double, class S = Schedule<X,T> > class LogicalProcess:
+	public EventListener<X,T>,
+	public AbstractLogicalProcess<X,T>
 {
 	public:
 		/**
@@ -59,53 +94,167 @@ template <class X, class T = double> class LogicalProcess:
 		 * assigned to it.
 		 */
 		LogicalProcess(int ID, const std::vector<int>& I,
-			const std::vector<int>& E, LogicalProcess<X,T>** all_lps, 
-			AbstractSimulator<X,T>* sim, MessageManager<X>* msg_manager);
+			const std::vector<int>& E, LogicalProcess<X,T,S>** all_lps, 
+			int lp_count, AbstractSimulator<X,T>* sim,
+			MessageManager<X>* msg_manager);
 		/**
 		 * Assign a model to this logical process. The model must have a
-		 * positive lookahead.
+		 * positive lookahead. The currentLookahead of its atomic components
+		 * may let the process look further ahead than this.
 		 */
-		void addModel(Devs<X,T>* model);
+		void addModel(Devs<X,T>* model, T t = adevs_zero<T>());
 		/**
 		 * Send a message to the logical process. This will put the 
 		 * message into the back of the input queue.
 		 */
 		void sendMessage(Message<X,T>& msg) { input_q.insert(msg); }
+		/**
+		 * Ask for a null message. This is called by the logical process
+		 * lp_id when this one holds back its earliest input time.
+		 */
+		void askForEIT(int lp_id) { msgq_store(&(requested[lp_id]),1); }
+		/**
+		 * Count the state changes and outputs of the models with a
+		 * listener, such as a Partitioner, or stop counting if the
+		 * listener is NULL. The listener is called by the thread that
+		 * runs this process, and so it is not called for the same model
+		 * by two threads at once.
+		 */
+		void setProfiler(EventListener<X,T>* listener) { profiler = listener; }
+		/**
+		 * Tell a tracer about the activities of this process, or stop
+		 * if the tracer is NULL. This may be called only between runs.
+		 * The process calls the tracer only if it has one.
+		 */
+		void setTracer(LpTracer<T>* tracer) { this->tracer = tracer; }
+		/**
+		 * Take away the models that were given to another process with
+		 * setProc and the input that is waiting for them. This and the
+		 * methods below may be used only when every process has returned
+		 * from run with the same stopping time, and restart must be
+		 * called before the processes are run again.
+		 */
+		void moveModelsOut(std::vector<Atomic<X,T>*>& models,
+			std::vector<Message<X,T> >& msgs);
+		/// Add a model that was taken from another process
+		void moveModelIn(Atomic<X,T>* model);
+		/// Add input for a model that was taken from another process
+		void moveMessageIn(const Message<X,T>& msg) { xq.push(msg); }
+		/**
+		 * Start the protocol again at the stopping time t with new
+		 * lists of influencers and influencees.
+		 */
+		void restart(T t, const std::vector<int>& I, const std::vector<int>& E);
+		/**
+		 * Give the model transitions that were put off to tr. This
+		 * returns true if the structure of a network that belongs to
+		 * this process has changed since the last call.
+		 */
+		bool takeModelTransitions(ModelTransitions<X,T>& tr);
+		/**
+		 * Take the models in the set, which holds every model inside of
+		 * them too, away from this process and discard their input. The
+		 * models were removed by a model transition that was put off.
+		 */
+		void removeModels(const Set<Devs<X,T>*>& gone);
 		/**
 		 * Get the smallest of the local time of next event. 
 		 */
 		Time<T> getNextEventTime() { return sim.nextEventTime(); } 
 		// Get the process ID
 		int getID() const { return ID; }
+		/// Get the statistics for the input queue
+		const MessageQStats& getQueueStats() const { return input_q.getStats(); }
+		/// Get the counts of the work done and messages sent by this process
+		const LpStats& getStats() const { return stats; }
 		/**
 		 * Destructor leaves the models intact.
 		 */
 		~LogicalProcess();
 		/// Run the main simulation loop
 		void run(T t_stop);
+		/// The result of a step
+		typedef enum { STEP_PROGRESS, STEP_BLOCKED, STEP_DONE } step_t;
+		/**
+		 * Prepare to run the main simulation loop one step at a time.
+		 * This lets a thread take turns running many logical processes.
+		 */
+		void beginRun()
+		{
+			try_again = true;
+			blocked = false;
+			if (tracer != NULL) tracer->begin(ID,LP_RUN,tL.t);
+		}
+		/**
+		 * Take a step of the main simulation loop. This returns
+		 * STEP_BLOCKED if the process must wait for input from another
+		 * process and STEP_DONE when it has reached t_stop.
+		 */
+		step_t step(T t_stop);
 		void outputEvent(Event<X,T> x, T t)
 		{
 			if (looking_ahead) return;
+			if (profiler != NULL) profiler->outputEvent(x,t);
 			psim->notify_output_listeners(x.model,x.value,t);
 		}
 		void stateChange(Atomic<X,T>* model, T t)
 		{
 			if (looking_ahead) return;
+			stats.events++;
+			if (static_models == 0) updateLookahead(model,t);
+			if (profiler != NULL) profiler->stateChange(model,t);
 			psim->notify_state_listeners(model,t);
 		}
 		void notifyInput(Atomic<X,T>* model, X& value);
+		bool routesNetworkInput() const { return true; }
+		void notifyNetworkInput(Network<X,T>* model, X& value);
+		bool deferModelTransition(Network<X,T>* model)
+		{
+			deferred.push_back(model);
+			return true;
+		}
+		void notifyAdded(Devs<X,T>* model, T t);
+		void notifyRemoved(Devs<X,T>* model);
 	private:
 		// ID of this LP
 		const int ID;
 		// List of influencees and influencers
-		const std::vector<int> E, I;
+		std::vector<int> E, I;
+		// The models given to addModel and moveModelIn
+		std::vector<Devs<X,T>*> roots;
+		// Networks whose model transitions were put off
+		std::vector<Network<X,T>*> deferred;
+		// Models added and removed by the structure change
+		// that is underway, and whether there has been one
+		Set<Atomic<X,T>*> added_models, removed_models;
+		Set<Devs<X,T>*> removed_set;
+		bool structure_changed;
+		EventListener<X,T>* profiler;
+		LpTracer<T>* tracer;
+		// Is the process waiting for its EIT to grow?
+		bool blocked;
 		// All of the LPs
-		LogicalProcess<X,T>** all_lps;
+		LogicalProcess<X,T,S>** all_lps;
 		// Lookahead for this LP
 		T lookahead;
+		// For each atomic model, the soonest that input arriving after its
+		// last event can cause an output, and these times in order. These
+		// are used only if no model is without a state dependent lookahead.
+		unsigned int static_models;
+		typedef std::multiset<T> bound_set;
+		bound_set bounds;
+		std::map<Atomic<X,T>*,typename bound_set::iterator> model_bound;
 		bool looking_ahead;
 		// Earliest input times 
 		std::map<int,Time<T> > eit_map;
+		// The largest time sent to each logical process, which processes
+		// have asked us for a null message, and which we have asked
+		std::vector<Time<T> > promised;
+		volatile int* requested;
+		std::vector<bool> waiting;
+		LpStats stats;
+		// Did the last step advance the earliest input time?
+		bool try_again;
 		// Input messages to the LP
 		MessageQ<X,T> input_q;
 		// Priority queue of messages to process
@@ -118,68 +267,342 @@ template <class X, class T = double> class LogicalProcess:
 		// For managing inter-lp messages
 		MessageManager<X>* msg_manager;
 		// Simulator for computing state transitions and outputs
-		Simulator<X,T> sim;
-		void advanceOutput();
+		Simulator<X,T,S> sim;
+		void advanceOutput(T t_stop);
 		void sendEOT(Time<T> tNext);
+		void updateLookahead(Atomic<X,T>* model, T t);
+		// The soonest that input at eit or later can cause an output
+		Time<T> outputBound() const;
+		// Send the EOT to the processes that asked for it, or to all
+		// of them if force is true
+		void sendNulls(bool force);
+		// Ask for the EITs that hold back this process
+		void requestEIT();
 		// Returns true if it reaches t_stop
 		void advanceState(T t_stop);
 		void processInputMessages();
-		void addToSimulator(Devs<X,T>* model);
+		void addToSimulator(Devs<X,T>* model, T t);
+		// Assign a model that the simulator has added to this process
+		void adopt(Devs<X,T>* model);
+		// Put a removed model and its components into removed_set
+		void drop(Devs<X,T>* model);
+		// Keep track of the lookahead of an atomic model or stop
+		void track(Atomic<X,T>* model, T t);
+		void untrack(Atomic<X,T>* model);
+		// Finish the structure change that the simulator made at t
+		void endStructureChange(T t);
+		// Discard the input for the models in the set
+		void purge(const Set<Devs<X,T>*>& gone);
+		// The smallest lookahead of the models given to this process
+		void findLookahead();
+		// Visits the components of a network to add, adopt, or drop them
+		typedef enum { ADD, ADOPT, DROP } visit_t;
+		class add_visitor:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				add_visitor(LogicalProcess<X,T,S>* lp, visit_t what, T t):
+					lp(lp),what(what),t(t){}
+				void visit(Devs<X,T>* model)
+				{
+					if (what == ADD) lp->addToSimulator(model,t);
+					else if (what == ADOPT) lp->adopt(model);
+					else lp->drop(model);
+				}
+			private:
+				LogicalProcess<X,T,S>* lp;
+				visit_t what;
+				T t;
+		};
 		Time<T> tNextEvent(Time<T> t);
 		void cleanup_xb();
 };
 
-template <typename X, class T>
-LogicalProcess<X,T>::LogicalProcess(int ID, const std::vector<int>& I, 
-	const std::vector<int>& E, LogicalProcess<X,T>** all_lps,
-	AbstractSimulator<X,T>* psim, MessageManager<X>* msg_manager):
-	ID(ID),E(E),I(I),all_lps(all_lps),psim(psim),
-	msg_manager(msg_manager),sim(this)
+template <typename X, class T, class S>
+LogicalProcess<X,T,S>::LogicalProcess(int ID, const std::vector<int>& I, 
+	const std::vector<int>& E, LogicalProcess<X,T,S>** all_lps,
+	int lp_count, AbstractSimulator<X,T>* psim, MessageManager<X>* msg_manager):
+	ID(ID),E(E),I(I),profiler(NULL),tracer(NULL),all_lps(all_lps),
+	promised(lp_count,Time<T>(0,0)),
+	requested(new int[lp_count]),waiting(lp_count,false),
+	input_q(lp_count),psim(psim),msg_manager(msg_manager),sim(this)
 {
 	tL = tOut = tNow = eot = eit = Time<T>(0,0);
 	all_lps[ID] = this;
 	lookahead = adevs_inf<T>();
 	looking_ahead = false;
+	blocked = false;
+	structure_changed = false;
+	static_models = 0;
+	for (int i = 0; i < lp_count; i++)
+		requested[i] = 0;
 	for (typename std::vector<int>::const_iterator iter = I.begin();
 			iter != I.end(); iter++)
 		if (*iter != ID) eit_map[*iter] = Time<T>(0,0);
 	sim.addEventListener(this);
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::addModel(Devs<X,T>* model)
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::addModel(Devs<X,T>* model, T t)
 {
 	lookahead = std::min(model->lookahead(),lookahead);
 	assert(lookahead > adevs_zero<T>());
+	roots.push_back(model);
 	// Add it to the simulator and set the processor
 	// assignments for the sub-models
-	addToSimulator(model);
+	addToSimulator(model,t);
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::addToSimulator(Devs<X,T>* model)
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::track(Atomic<X,T>* model, T t)
 {
-	// Assign the model to this LP
+	if (model->currentLookahead() > adevs_zero<T>())
+		updateLookahead(model,t);
+	else static_models++;
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::untrack(Atomic<X,T>* model)
+{
+	typename std::map<Atomic<X,T>*,typename bound_set::iterator>::iterator
+		iter = model_bound.find(model);
+	if (iter != model_bound.end())
+	{
+		bounds.erase((*iter).second);
+		model_bound.erase(iter);
+	}
+	else static_models--;
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::findLookahead()
+{
+	lookahead = adevs_inf<T>();
+	for (unsigned i = 0; i < roots.size(); i++)
+		lookahead = std::min(roots[i]->lookahead(),lookahead);
+	assert(roots.empty() || lookahead > adevs_zero<T>());
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::notifyAdded(Devs<X,T>* model, T)
+{
+	adopt(model);
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::adopt(Devs<X,T>* model)
+{
+	// A model that is added by a network belonging to
+	// this process belongs to it too
 	model->setProc(ID);
 	Atomic<X,T>* a = model->typeIsAtomic();
-	if (a != NULL)
+	if (a != NULL) added_models.insert(a);
+	else
 	{
-		sim.addModel(a);
+		add_visitor visitor(this,ADOPT,adevs_zero<T>());
+		model->typeIsNetwork()->visitComponents(&visitor);
 	}
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::notifyRemoved(Devs<X,T>* model)
+{
+	drop(model);
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::drop(Devs<X,T>* model)
+{
+	// The simulator lists the components of a removed network too,
+	// and so a model may be dropped more than once
+	if (!removed_set.insert(model).second) return;
+	Atomic<X,T>* a = model->typeIsAtomic();
+	if (a != NULL) removed_models.insert(a);
 	else
 	{
-		Set<Devs<X,T>*> components;
-		model->typeIsNetwork()->getComponents(components);
-		typename Set<Devs<X,T>*>::iterator iter = components.begin();
-		for (; iter != components.end(); iter++)
+		add_visitor visitor(this,DROP,adevs_zero<T>());
+		model->typeIsNetwork()->visitComponents(&visitor);
+	}
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::endStructureChange(T t)
+{
+	// The removed models have been deleted, and so only
+	// their addresses are used here
+	typename Set<Atomic<X,T>*>::iterator iter;
+	for (iter = added_models.begin(); iter != added_models.end(); iter++)
+		track(*iter,t);
+	for (iter = removed_models.begin(); iter != removed_models.end(); iter++)
+		untrack(*iter);
+	purge(removed_set);
+	added_models.clear();
+	removed_models.clear();
+	removed_set.clear();
+	findLookahead();
+	structure_changed = true;
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::purge(const Set<Devs<X,T>*>& gone)
+{
+	std::vector<Message<X,T> > keep;
+	while (!xq.empty())
+	{
+		Message<X,T> msg(xq.top());
+		xq.pop();
+		if (gone.find(msg.target) == gone.end())
+			keep.push_back(msg);
+		else msg_manager->destroy(msg.value);
+	}
+	for (unsigned i = 0; i < keep.size(); i++)
+		xq.push(keep[i]);
+}
+
+template <typename X, class T, class S>
+bool LogicalProcess<X,T,S>::takeModelTransitions(ModelTransitions<X,T>& tr)
+{
+	for (unsigned i = 0; i < deferred.size(); i++)
+		tr.needed(deferred[i]);
+	deferred.clear();
+	bool changed = structure_changed;
+	structure_changed = false;
+	return changed;
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::removeModels(const Set<Devs<X,T>*>& gone)
+{
+	while (!input_q.empty())
+	{
+		Message<X,T> msg(input_q.remove());
+		if (msg.type == Message<X,T>::OUTPUT)
+			xq.push(msg);
+	}
+	for (unsigned i = 0; i < roots.size(); )
+	{
+		if (gone.find(roots[i]) == gone.end())
+		{
+			i++;
+			continue;
+		}
+		std::vector<Atomic<X,T>*> models;
+		Atomic<X,T>* a = roots[i]->typeIsAtomic();
+		if (a != NULL) models.push_back(a);
+		else
+		{
+			Set<Devs<X,T>*> inside;
+			ModelTransitions<X,T>::getAllChildren(roots[i]->typeIsNetwork(),inside);
+			typename Set<Devs<X,T>*>::iterator iter;
+			for (iter = inside.begin(); iter != inside.end(); iter++)
+				if ((*iter)->typeIsAtomic() != NULL)
+					models.push_back((*iter)->typeIsAtomic());
+		}
+		for (unsigned k = 0; k < models.size(); k++)
+		{
+			sim.moveModelOut(models[k]);
+			untrack(models[k]);
+		}
+		roots[i] = roots.back();
+		roots.pop_back();
+	}
+	purge(gone);
+	findLookahead();
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::moveModelsOut(std::vector<Atomic<X,T>*>& models,
+	std::vector<Message<X,T> >& msgs)
+{
+	// Input that arrived after the last step is kept with the rest
+	while (!input_q.empty())
+	{
+		Message<X,T> msg(input_q.remove());
+		if (msg.type == Message<X,T>::OUTPUT)
+			xq.push(msg);
+	}
+	// Only atomic models that were assigned on their own can move
+	lookahead = adevs_inf<T>();
+	for (unsigned i = 0; i < roots.size(); )
+	{
+		Atomic<X,T>* a = roots[i]->typeIsAtomic();
+		if (a == NULL || a->getProc() == ID)
 		{
-			addToSimulator(*iter);
+			lookahead = std::min(roots[i]->lookahead(),lookahead);
+			i++;
+			continue;
 		}
+		sim.moveModelOut(a);
+		untrack(a);
+		models.push_back(a);
+		roots[i] = roots.back();
+		roots.pop_back();
+	}
+	// Take the input for the models that left
+	std::vector<Message<X,T> > keep;
+	while (!xq.empty())
+	{
+		if (xq.top().target->getProc() == ID) keep.push_back(xq.top());
+		else msgs.push_back(xq.top());
+		xq.pop();
+	}
+	for (unsigned i = 0; i < keep.size(); i++)
+		xq.push(keep[i]);
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::moveModelIn(Atomic<X,T>* model)
+{
+	assert(model->getProc() == ID);
+	lookahead = std::min(model->lookahead(),lookahead);
+	assert(lookahead > adevs_zero<T>());
+	roots.push_back(model);
+	sim.moveModelIn(model);
+	track(model,model->tL);
+	stats.arrivals++;
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::restart(T t, const std::vector<int>& I,
+	const std::vector<int>& E)
+{
+	// Every process has computed its events up to t and no output
+	// after t, and so they all start again from t
+	this->I = I;
+	this->E = E;
+	eit_map.clear();
+	for (typename std::vector<int>::const_iterator iter = I.begin();
+			iter != I.end(); iter++)
+		if (*iter != ID) eit_map[*iter] = Time<T>(t,0);
+	eit = eot = Time<T>(t,0);
+	for (unsigned i = 0; i < promised.size(); i++)
+	{
+		promised[i] = Time<T>(t,0);
+		requested[i] = 0;
+		waiting[i] = false;
 	}
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::notifyInput(Atomic<X,T>* model, X& value)
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::addToSimulator(Devs<X,T>* model, T t)
+{
+	// Assign the model to this LP
+	model->setProc(ID);
+	Atomic<X,T>* a = model->typeIsAtomic();
+	if (a != NULL)
+	{
+		sim.addModel(a,t);
+		track(a,t);
+	}
+	else
+	{
+		add_visitor visitor(this,ADD,t);
+		model->typeIsNetwork()->visitComponents(&visitor);
+	}
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::notifyInput(Atomic<X,T>* model, X& value)
 {
 	// Don't send messages that have already been sent
 	if (tNow <= tOut) return;
@@ -187,14 +610,33 @@ void LogicalProcess<X,T>::notifyInput(Atomic<X,T>* model, X& value)
 	// Send the event to the proper LP
 	Message<X,T> msg(msg_manager->clone(value));
 	msg.t = tNow;
-	msg.src = this;
+	msg.src = ID;
+	msg.target = model;
+	msg.type = Message<X,T>::OUTPUT;
+	all_lps[model->getProc()]->sendMessage(msg);
+	// The message carries its time as an EIT for the receiver
+	if (promised[model->getProc()] < tNow) promised[model->getProc()] = tNow;
+	stats.outputs++;
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::notifyNetworkInput(Network<X,T>* model, X& value)
+{
+	// The process that owns the network routes its input
+	if (tNow <= tOut) return;
+	assert(model->getProc() != ID);
+	Message<X,T> msg(msg_manager->clone(value));
+	msg.t = tNow;
+	msg.src = ID;
 	msg.target = model;
 	msg.type = Message<X,T>::OUTPUT;
 	all_lps[model->getProc()]->sendMessage(msg);
+	if (promised[model->getProc()] < tNow) promised[model->getProc()] = tNow;
+	stats.outputs++;
 }
 
-template <typename X, class T>
-Time<T> LogicalProcess<X,T>::tNextEvent(Time<T> tlast)
+template <typename X, class T, class S>
+Time<T> LogicalProcess<X,T,S>::tNextEvent(Time<T> tlast)
 {
 	if (tlast.t < sim.nextEventTime())
 	{
@@ -205,8 +647,8 @@ Time<T> LogicalProcess<X,T>::tNextEvent(Time<T> tlast)
 	return tlast;
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::advanceState(T t_stop)
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::advanceState(T t_stop)
 {
 	// Make sure we stop at t_stop
 	Time<T> tStop(eit);
@@ -243,88 +685,150 @@ void LogicalProcess<X,T>::advanceState(T t_stop)
 		assert(tNow.t < adevs_inf<T>());
 		sim.computeNextState(xb,tNow.t);
 		cleanup_xb();
+		if (!removed_set.empty() || !added_models.empty())
+			endStructureChange(tNow.t);
 		// Remember the time of our last event
 		tL = tNow; 
 	}
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::advanceOutput()
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::advanceOutput(T t_stop)
 {
 	// This is the time for the new output and state
 	tNow = tNextEvent(tL);
 	// Project the output as far into the future 
-	// as possible
+	// as possible, but not past the stopping time
 	if (eit.t < adevs_inf<T>() && lookahead < adevs_inf<T>())
 	{
 		looking_ahead = true;
+		stats.lookaheads++;
+		if (tracer != NULL) tracer->begin(ID,LP_LOOKAHEAD,tL.t);
 		sim.beginLookahead();
 		// Try to advance the output trajectory
-		while (tNow.t < adevs_inf<T>() && tNow < eit + lookahead)
+		Time<T> tBound(outputBound());
+		while (tNow.t < adevs_inf<T>() && tNow < tBound && tNow.t <= t_stop)
 		{
-			bool ok = true;
-			try
-			{
-				assert(tNow.t == sim.nextEventTime());
-				/**
-				 * This computes the next output and might
-				 * compute the next state.
-				 */ 
-				sim.lookNextEvent();
-			}
-			catch (lookahead_impossible_exception)
-			{
-				/**
-				 * Failed to compute the next state.
-				 */
-				ok = false;
-			}
+			assert(tNow.t == sim.nextEventTime());
+			/**
+			 * This computes the next output and might
+			 * compute the next state. It returns false if
+			 * it failed to compute the next state.
+			 */ 
+			bool ok = sim.tryLookNextEvent();
 			if (tOut <= tNow) tOut = tNow;
 			// If we can and there is nothing more useful to do,
 			// move on to the next autonomous event
 			if (ok) tNow = tNextEvent(tNow);
-			else break;
+			else
+			{
+				stats.lookahead_failures++;
+				break;
+			}
 		}
 		sim.endLookahead();
 		assert(tNextEvent(tL).t == sim.nextEventTime());
 		looking_ahead = false;
+		if (tracer != NULL) tracer->end(ID,LP_LOOKAHEAD,tL.t,stats);
 	} 
 	sendEOT(tNow);
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::sendEOT(Time<T> tNext)
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::sendEOT(Time<T> tNext)
 {
 	// Send a new value for the earliest output time
-	Time<T> newEot(eit+lookahead);
+	Time<T> newEot(outputBound());
 	if (tNext < newEot) newEot = tNext;
 	if (newEot == eit) newEot.c++;
 	// If this new EOT value is greater than our previous EOT
-	// value then sent it to the downstream LPs
+	// value then send it to the downstream LPs that are waiting for it
 	if (eot < newEot)
 	{
 		eot = newEot;
-		Message<X,T> msg;
-		msg.target = NULL;
-		msg.src = this;
-		msg.type = Message<X,T>::EIT;
-		msg.t = eot; 
-		for (std::vector<int>::const_iterator iter = E.begin();
-			iter != E.end(); iter++)
-			if (*iter != ID) all_lps[(*iter)]->sendMessage(msg);
+		sendNulls(false);
+	}
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::updateLookahead(Atomic<X,T>* model, T t)
+{
+	T bound = t+model->currentLookahead();
+	assert(bound > t);
+	typename std::map<Atomic<X,T>*,typename bound_set::iterator>::iterator
+		iter = model_bound.find(model);
+	if (iter == model_bound.end())
+		model_bound[model] = bounds.insert(bound);
+	else if (*((*iter).second) != bound)
+	{
+		bounds.erase((*iter).second);
+		(*iter).second = bounds.insert(bound);
+	}
+}
+
+template <typename X, class T, class S>
+Time<T> LogicalProcess<X,T,S>::outputBound() const
+{
+	Time<T> bound(eit+lookahead);
+	if (static_models == 0 && !bounds.empty() && bound < *(bounds.begin()))
+		bound = Time<T>(*(bounds.begin()),0);
+	return bound;
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::sendNulls(bool force)
+{
+	Message<X,T> msg;
+	msg.target = NULL;
+	msg.src = ID;
+	msg.type = Message<X,T>::EIT;
+	msg.t = eot; 
+	for (std::vector<int>::const_iterator iter = E.begin();
+		iter != E.end(); iter++)
+	{
+		if (*iter == ID || !(promised[*iter] < eot) ||
+			!(force || msgq_load(&(requested[*iter])) != 0))
+			continue;
+		// Clear the request first so that a request made after
+		// the null message arrives is not lost
+		msgq_store(&(requested[*iter]),0);
+		all_lps[(*iter)]->sendMessage(msg);
+		promised[*iter] = eot;
+		stats.nulls++;
 	}
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::processInputMessages()
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::requestEIT()
+{
+	typename std::map<int,Time<T> >::iterator iter;
+	for (iter = eit_map.begin(); iter != eit_map.end(); iter++)
+	{
+		if (waiting[(*iter).first] || eit < (*iter).second)
+			continue;
+		all_lps[(*iter).first]->askForEIT(ID);
+		waiting[(*iter).first] = true;
+		stats.requests++;
+	}
+}
+
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::processInputMessages()
 {
 	while (!input_q.empty())
 	{
 		Message<X,T> msg(input_q.remove());
-		eit_map[msg.src->getID()] = msg.t;
+		eit_map[msg.src] = msg.t;
+		waiting[msg.src] = false;
 		if (msg.type == Message<X,T>::OUTPUT)
+		{
 			xq.push(msg);
+			stats.inputs++;
+		}
 	}
+	if (xq.size() > stats.max_pending) stats.max_pending = xq.size();
+	// Answer the requests that we can
+	sendNulls(false);
 	eit = Time<T>::Inf();
     typename std::map<int,Time<T> >::iterator iter;
 	for (iter = eit_map.begin();
@@ -332,32 +836,67 @@ void LogicalProcess<X,T>::processInputMessages()
 		eit = std::min((*iter).second,eit);
 }
 
-template <typename X, class T>
-void LogicalProcess<X,T>::run(T t_stop)
+template <typename X, class T, class S>
+void LogicalProcess<X,T,S>::run(T t_stop)
+{
+	unsigned idle = 0;
+	step_t result;
+	beginRun();
+	while ((result = step(t_stop)) != STEP_DONE)
+	{
+		// Spin for a while before giving up the processor
+		if (result == STEP_PROGRESS) idle = 0;
+		else if (idle++ >= 16) lp_yield();
+	}
+}
+
+template <typename X, class T, class S>
+typename LogicalProcess<X,T,S>::step_t LogicalProcess<X,T,S>::step(T t_stop)
 {
-	bool try_again = true;
 	// Run until advanceState reaches the stopping time
-	while (
+	if (!(
 		eit.t <= t_stop ||
 		eot.t <= t_stop ||
 		tNextEvent(tL).t <= t_stop ||
 		(!xq.empty() && xq.top().t.t <= t_stop)
-	)
+	))
 	{
-
-		if (try_again)
+		// Our EOT is past t_stop, and no process that is still running
+		// will hear from us again unless we send it now
+		sendNulls(true);
+		if (tracer != NULL)
 		{
-			advanceState(t_stop);
-			advanceOutput();
+			if (blocked) tracer->end(ID,LP_BLOCKED,tL.t,stats);
+			tracer->end(ID,LP_RUN,tL.t,stats);
 		}
-		Time<T> eit_now(eit);
-		processInputMessages();
-		try_again = eit_now < eit; 
+		blocked = false;
+		return STEP_DONE;
+	}
+	if (try_again)
+	{
+		if (tracer != NULL) tracer->begin(ID,LP_EVENTS,tL.t);
+		advanceState(t_stop);
+		if (tracer != NULL) tracer->end(ID,LP_EVENTS,tL.t,stats);
+		advanceOutput(t_stop);
+	}
+	Time<T> eit_now(eit);
+	processInputMessages();
+	try_again = eit_now < eit; 
+	if (try_again)
+	{
+		if (blocked && tracer != NULL) tracer->end(ID,LP_BLOCKED,tL.t,stats);
+		blocked = false;
+		return STEP_PROGRESS;
 	}
+	requestEIT();
+	stats.idle++;
+	if (!blocked && tracer != NULL) tracer->begin(ID,LP_BLOCKED,tL.t);
+	blocked = true;
+	return STEP_BLOCKED;
 }
 
-template <class X, class T>
-void LogicalProcess<X,T>::cleanup_xb()
+template <class X, class T, class S>
+void LogicalProcess<X,T,S>::cleanup_xb()
 {
 	typename Bag<Event<X,T> >::iterator iter = xb.begin();
 	for (; iter != xb.end(); iter++)
@@ -365,8 +904,8 @@ void LogicalProcess<X,T>::cleanup_xb()
 	xb.clear();
 }
 
-template <class X, class T>
-LogicalProcess<X,T>::~LogicalProcess()
+template <class X, class T, class S>
+LogicalProcess<X,T,S>::~LogicalProcess()
 {
 	while (!xq.empty())
 	{
@@ -376,6 +915,7 @@ LogicalProcess<X,T>::~LogicalProcess()
 		xb.insert(input_event);
 	}
 	cleanup_xb();
+	delete [] requested;
 }
 
 } // end of namespace 
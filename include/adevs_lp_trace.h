@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_lp_trace_h_
+#define __adevs_lp_trace_h_
+#include "adevs_time.h"
+#include <omp.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+namespace adevs
+{
+
+/**
+ * Counts of the work done and the messages sent by a logical process.
+ * Null messages are those that carry only a new earliest input time for
+ * the receiver.
+ */
+struct LpStats
+{
+	/// Messages that carry output to another logical process
+	unsigned long int outputs;
+	/// Null messages
+	unsigned long int nulls;
+	/// Requests for a null message made to another logical process
+	unsigned long int requests;
+	/// Times that the logical process found that it could do nothing
+	unsigned long int idle;
+	/// State changes computed by the logical process
+	unsigned long int events;
+	/// Models given to the logical process by the load balancer
+	unsigned long int arrivals;
+	/// Messages with output from another logical process that were received
+	unsigned long int inputs;
+	/// Lookahead calculations that were started
+	unsigned long int lookaheads;
+	/// Lookahead calculations stopped by a model that could not save its state
+	unsigned long int lookahead_failures;
+	/// Largest number of inputs that waited for their time to come
+	unsigned long int max_pending;
+	LpStats():outputs(0),nulls(0),requests(0),idle(0),events(0),arrivals(0),
+		inputs(0),lookaheads(0),lookahead_failures(0),max_pending(0){}
+	/// Get the number of null messages per output message
+	double nullsPerOutput() const
+	{
+		return (outputs == 0) ? (double)nulls : (double)nulls/(double)outputs;
+	}
+};
+
+/// The activities of a logical process that are seen by an LpTracer
+typedef enum
+{
+	/// From the start of a run until the process reaches its end
+	LP_RUN,
+	/// Computing state changes up to the earliest input time
+	LP_EVENTS,
+	/// Computing output beyond the earliest input time
+	LP_LOOKAHEAD,
+	/// Waiting for another process to raise the earliest input time
+	LP_BLOCKED
+} LpActivity;
+
+/**
+ * <P>An LpTracer watches the logical processes of a ParSimulator (see
+ * ParSimulator::setTracer). Each process tells the tracer when it begins
+ * and ends an activity. The time t is the time of the last event that
+ * the process computed. The activities of a process nest: every other
+ * activity is inside of an LP_RUN, and an LP_BLOCKED does not overlap
+ * the others.</P>
+ * <P>The methods are called by the thread that runs the process, and
+ * so calls for different processes are made at the same time by
+ * different threads. Calls for the same process are never made at once.
+ * A process without a tracer does not make these calls, and so the
+ * tracer costs nothing when it is not used.</P>
+ */
+template <class T = double> class LpTracer
+{
+	public:
+		LpTracer(){}
+		/// Called before the lp_count processes run for the first time
+		virtual void start(int){}
+		/// The process lp_id begins an activity
+		virtual void begin(int lp_id, LpActivity what, T t) = 0;
+		/// The process lp_id ends an activity with the given counts
+		virtual void end(int lp_id, LpActivity what, T t,
+			const LpStats& stats) = 0;
+		virtual ~LpTracer(){}
+};
+
+/**
+ * <P>The ChromeTracer records the activities of each logical process
+ * and writes them as a timeline in the JSON trace event format. This is
+ * read by the chrome://tracing page of the Chrome browser and by the
+ * Perfetto user interface (ui.perfetto.dev). Each process is a track
+ * and its activities are the spans on it. The counts in LpStats are
+ * plotted at the end of each LP_EVENTS and LP_RUN span.</P>
+ * <P>Time on the timeline is the wall clock time since the tracer was
+ * created. The simulation time and the thread that ran the process
+ * are given as arguments to each span.</P>
+ */
+template <class T = double> class ChromeTracer:
+	public LpTracer<T>
+{
+	public:
+		/// Create a tracer with nothing recorded
+		ChromeTracer():LpTracer<T>(),t0(omp_get_wtime()){}
+		void start(int lp_count)
+		{
+			if (lp.size() < (unsigned)lp_count) lp.resize(lp_count);
+		}
+		void begin(int lp_id, LpActivity what, T)
+		{
+			lp[lp_id].opened[what] = omp_get_wtime();
+		}
+		void end(int lp_id, LpActivity what, T t, const LpStats& stats)
+		{
+			span s;
+			s.what = what;
+			s.ts = lp[lp_id].opened[what];
+			s.dur = omp_get_wtime()-s.ts;
+			s.t = t;
+			s.thread = omp_get_thread_num();
+			s.stats = stats;
+			lp[lp_id].spans.push_back(s);
+			lp[lp_id].total[what] += s.dur;
+		}
+		/**
+		 * Get the wall clock time in seconds that the process spent
+		 * in an activity. For LP_BLOCKED this is the time that it
+		 * spent waiting for its earliest input time to grow.
+		 */
+		double getTime(int lp_id, LpActivity what) const
+		{
+			return lp[lp_id].total[what];
+		}
+		/// Get the number of times that the process did an activity
+		unsigned long int getCount(int lp_id, LpActivity what) const
+		{
+			unsigned long int n = 0;
+			for (unsigned i = 0; i < lp[lp_id].spans.size(); i++)
+				if (lp[lp_id].spans[i].what == what) n++;
+			return n;
+		}
+		/// Write the timeline as a JSON object
+		void write(std::ostream& out) const;
+		/// Forget what has been recorded
+		void clear()
+		{
+			for (unsigned i = 0; i < lp.size(); i++)
+				lp[i] = record();
+			t0 = omp_get_wtime();
+		}
+	private:
+		struct span
+		{
+			LpActivity what;
+			double ts, dur;
+			T t;
+			int thread;
+			LpStats stats;
+		};
+		struct record
+		{
+			record()
+			{
+				for (int i = 0; i < 4; i++) opened[i] = total[i] = 0.0;
+			}
+			double opened[4], total[4];
+			std::vector<span> spans;
+		};
+		double t0;
+		std::vector<record> lp;
+		// Microseconds since the tracer was created
+		double micros(double t) const { return (t-t0)*1E6; }
+		static const char* name(LpActivity what)
+		{
+			static const char* names[] = { "run", "events", "lookahead", "blocked" };
+			return names[what];
+		}
+};
+
+template <class T>
+void ChromeTracer<T>::write(std::ostream& out) const
+{
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+	bool first = true;
+	for (unsigned i = 0; i < lp.size(); i++)
+	{
+		if (!first) out << ",";
+		first = false;
+		out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"LP " << i << "\"}}";
+		for (unsigned k = 0; k < lp[i].spans.size(); k++)
+		{
+			const span& s = lp[i].spans[k];
+			out << ",\n{\"name\":\"" << name(s.what) << "\",\"ph\":\"X\",\"pid\":0,"
+				<< "\"tid\":" << i << ",\"ts\":" << micros(s.ts)
+				<< ",\"dur\":" << s.dur*1E6 << ",\"args\":{\"t\":";
+			// JSON has no infinity
+			if (s.t < adevs_inf<T>()) out << std::setprecision(9) << s.t;
+			else out << "\"inf\"";
+			out << std::setprecision(3) << ",\"thread\":" << s.thread << "}}";
+			if (s.what != LP_EVENTS && s.what != LP_RUN) continue;
+			out << ",\n{\"name\":\"LP " << i << "\",\"ph\":\"C\",\"pid\":0,"
+				<< "\"tid\":" << i << ",\"ts\":" << micros(s.ts+s.dur)
+				<< ",\"args\":{\"events\":" << s.stats.events
+				<< ",\"outputs\":" << s.stats.outputs
+				<< ",\"inputs\":" << s.stats.inputs
+				<< ",\"nulls\":" << s.stats.nulls
+				<< ",\"lookahead_failures\":" << s.stats.lookahead_failures
+				<< ",\"max_pending\":" << s.stats.max_pending << "}}";
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	out.flags(flags);
+	out.precision(precision);
+}
+
+} // end of namespace
+
+#endif
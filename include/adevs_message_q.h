@@ -32,34 +32,36 @@
 #define __adevs_message_q_h_
 #include "adevs_models.h"
 #include "adevs_time.h"
-#include <omp.h>
-#include <list>
+#include <cstddef>
 #include <cassert>
 
 namespace adevs
 {
 
-template <typename X, class T> class LogicalProcess;
-
 template <typename X, class T = double> struct Message
 {
-	typedef enum { OUTPUT, EIT } msg_type_t;
+	// ANTI messages cancel an OUTPUT with the same src and seq
+	typedef enum { OUTPUT, EIT, ANTI } msg_type_t;
 	Time<T> t;
-	LogicalProcess<X,T> *src;
+	// ID of the logical process that sent the message
+	int src;
 	Devs<X,T>* target;
 	X value;
 	msg_type_t type;
+	// Number that the sender gave to the message
+	unsigned long int seq;
 	// Default constructor
-	Message():value(){}
+	Message():value(),seq(0){}
 	// Create a message with a particular value
-	Message(const X& value):value(value){}
+	Message(const X& value):value(value),seq(0){}
 	// Copy constructor
 	Message(const Message& other):
 		t(other.t),
 		src(other.src),
 		target(other.target),
 		value(other.value),
-		type(other.type)
+		type(other.type),
+		seq(other.seq)
 	{
 	}
 	// Assignment operator
@@ -70,6 +72,7 @@ template <typename X, class T = double> struct Message
 		target = other.target;
 		value = other.value;
 		type = other.type;
+		seq = other.seq;
 		return *this;
 	}
 	// Sort by time stamp, smallest time stamp first in the STL priority_queue
@@ -80,49 +83,196 @@ template <typename X, class T = double> struct Message
 	~Message(){}
 };
 
+/*
+ * Load and store the counters and links that are shared by the sender
+ * and receiver of a channel. A load that sees a stored value also sees
+ * every write that the storing thread made before the store.
+ */
+#if defined(__GNUC__)
+template <typename V> inline V msgq_load(V volatile* p)
+{
+	return __atomic_load_n(p,__ATOMIC_ACQUIRE);
+}
+template <typename V> inline void msgq_store(V volatile* p, V v)
+{
+	__atomic_store_n(p,v,__ATOMIC_RELEASE);
+}
+#else
+template <typename V> inline V msgq_load(V volatile* p)
+{
+	V v = *p;
+	#pragma omp flush
+	return v;
+}
+template <typename V> inline void msgq_store(V volatile* p, V v)
+{
+	#pragma omp flush
+	*p = v;
+}
+#endif
+
+/**
+ * Statistics that the receiver of a MessageQ keeps about its traffic.
+ */
+struct MessageQStats
+{
+	/// Number of messages removed from the queue
+	unsigned long int received;
+	/// Number of times that the receiver found messages waiting
+	unsigned long int batches;
+	/// The most messages that were waiting when the receiver looked
+	unsigned long int max_depth;
+	MessageQStats():received(0),batches(0),max_depth(0){}
+};
+
+/**
+ * This is the input queue of a logical process. Every sender has its own
+ * single producer, single consumer channel into the queue, and so neither
+ * insert nor remove takes a lock. A channel is a list of blocks that each
+ * hold a fixed number of messages. A block is allocated only when the one
+ * at the tail is full, and it is freed when the receiver has emptied it.
+ * Messages from one sender are removed in the order that they were
+ * inserted. The receiver counts the messages waiting in all of the
+ * channels at once and then removes them without looking at the shared
+ * counters again.
+ */
 template <class X, class T = double> class MessageQ
 {
 	public:
-		MessageQ()
-		{
-			omp_init_lock(&lock);
-			qshare_empty = true;
-			qsafe = &q1;
-			qshare = &q2;
-		}
-		void insert(const Message<X,T>& msg)
+		/// Create a queue for messages with src in [0,senders)
+		MessageQ(int senders);
+		/// This must only be called by the thread of the sender msg.src
+		void insert(const Message<X,T>& msg);
+		/// This must only be called by the receiver
+		bool empty();
+		/// This must only be called by the receiver when empty() is false
+		Message<X,T> remove();
+		/// Get the statistics for this queue
+		const MessageQStats& getStats() const { return stats; }
+		/// Messages that were not removed are discarded
+		~MessageQ();
+	private:
+		static const unsigned block_size = 128;
+		struct block
 		{
-			omp_set_lock(&lock);
-			qshare->push_back(msg);
-			qshare_empty = false;
-			omp_unset_lock(&lock);
-		}
-		bool empty() const { return qsafe->empty() && qshare_empty; }
-		Message<X,T> remove()
+			block():next(NULL){}
+			Message<X,T> slot[block_size];
+			block* volatile next;
+		};
+		struct channel
 		{
-			if (qsafe->empty())
-			{
-				std::list<Message<X,T> > *tmp = qshare;
-				omp_set_lock(&lock);
-				qshare = qsafe;
-				qshare_empty = true;
-				omp_unset_lock(&lock);
-				qsafe = tmp;
-			}
-			Message<X,T> msg(qsafe->front());
-			qsafe->pop_front();
-			return msg;
-		}
-		~MessageQ()
+			channel():first(NULL),tail(NULL),tail_pos(block_size),sent(0),
+				ready(0),head(NULL),head_pos(0),taken(0),waiting(0){}
+			// The first block, which is created by the sender
+			block* volatile first;
+			// The sender's side
+			block* tail;
+			unsigned tail_pos;
+			unsigned long int sent;
+			// Number of messages that the receiver may take
+			volatile unsigned long int ready;
+			// Keep the two sides in different cache lines
+			char pad[64];
+			// The receiver's side
+			block* head;
+			unsigned head_pos;
+			unsigned long int taken, waiting;
+		};
+		const int senders;
+		channel** chan;
+		// Sum of the waiting counts and the channel to take from next
+		unsigned long int waiting;
+		int next;
+		MessageQStats stats;
+};
+
+template <class X, class T>
+MessageQ<X,T>::MessageQ(int senders):
+	senders(senders),
+	waiting(0),
+	next(0)
+{
+	chan = new channel*[senders];
+	for (int i = 0; i < senders; i++)
+		chan[i] = new channel();
+}
+
+template <class X, class T>
+void MessageQ<X,T>::insert(const Message<X,T>& msg)
+{
+	assert(msg.src >= 0 && msg.src < senders);
+	channel* c = chan[msg.src];
+	if (c->tail_pos == block_size)
+	{
+		block* b = new block();
+		if (c->tail == NULL) msgq_store(&(c->first),b);
+		else msgq_store(&(c->tail->next),b);
+		c->tail = b;
+		c->tail_pos = 0;
+	}
+	c->tail->slot[c->tail_pos++] = msg;
+	msgq_store(&(c->ready),++(c->sent));
+}
+
+template <class X, class T>
+bool MessageQ<X,T>::empty()
+{
+	if (waiting > 0) return false;
+	for (int i = 0; i < senders; i++)
+	{
+		channel* c = chan[i];
+		c->waiting = msgq_load(&(c->ready))-c->taken;
+		waiting += c->waiting;
+	}
+	if (waiting == 0) return true;
+	stats.batches++;
+	if (waiting > stats.max_depth) stats.max_depth = waiting;
+	return false;
+}
+
+template <class X, class T>
+Message<X,T> MessageQ<X,T>::remove()
+{
+	assert(waiting > 0);
+	while (chan[next]->waiting == 0)
+		next = (next+1)%senders;
+	channel* c = chan[next];
+	if (c->head == NULL)
+		c->head = msgq_load(&(c->first));
+	else if (c->head_pos == block_size)
+	{
+		// The sender has moved on to the next block
+		block* b = msgq_load(&(c->head->next));
+		delete c->head;
+		c->head = b;
+		c->head_pos = 0;
+	}
+	Message<X,T> msg(c->head->slot[c->head_pos]);
+	// Release the queue's copy of the value
+	c->head->slot[c->head_pos++] = Message<X,T>();
+	c->taken++;
+	c->waiting--;
+	waiting--;
+	stats.received++;
+	return msg;
+}
+
+template <class X, class T>
+MessageQ<X,T>::~MessageQ()
+{
+	for (int i = 0; i < senders; i++)
+	{
+		block* b = (chan[i]->head != NULL) ? chan[i]->head : chan[i]->first;
+		while (b != NULL)
 		{
-			omp_destroy_lock(&lock);
+			block* tmp = b->next;
+			delete b;
+			b = tmp;
 		}
-	private:
-		omp_lock_t lock;
-		std::list<Message<X,T> > q1, q2;
-		std::list<Message<X,T> > *qsafe, *qshare;
-		volatile bool qshare_empty;
-};
+		delete chan[i];
+	}
+	delete [] chan;
+}
 
 } // end of namespace
 
@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_model_transitions_h_
+#define __adevs_model_transitions_h_
+#include "adevs_models.h"
+#include "adevs_abstract_simulator.h"
+#include "adevs_bag.h"
+#include "adevs_set.h"
+#include <cassert>
+#include <set>
+#include <utility>
+
+namespace adevs
+{
+
+/**
+ * This class evaluates the model transition functions of networks, and of
+ * their parents when these ask for it, and finds the models that were
+ * added and removed. It is used by the simulators to change the structure
+ * of a model. If it works for a logical process, then the process may put
+ * off the model transitions of networks that do not belong to it.
+ */
+template <class X, class T = double> class ModelTransitions
+{
+	public:
+		ModelTransitions(AbstractLogicalProcess<X,T>* lp = NULL):lp(lp){}
+		/// Evaluate the model transition function of the network
+		void needed(Network<X,T>* model)
+		{
+			if (lp != NULL && model->getProc() != lp->getID() &&
+				lp->deferModelTransition(model))
+				return;
+			eval_set.insert(std::make_pair(-depth(model),model));
+		}
+		/// Are there model transitions to evaluate?
+		bool empty() const { return eval_set.empty(); }
+		/**
+		 * Evaluate the model transitions, from the bottom of the model up,
+		 * and put the models that were added and removed into the bags.
+		 * A model that moved from one network to another is in neither.
+		 */
+		void evaluate(Bag<Devs<X,T>*>& added, Bag<Devs<X,T>*>& removed);
+		/**
+		 * Delete the removed models from the top down and empty the bag.
+		 * The models must have been taken out of the simulator first.
+		 */
+		void deleteModels(Bag<Devs<X,T>*>& removed);
+		/// The number of networks that contain the model
+		static long int depth(const Devs<X,T>* model)
+		{
+			long int d = 0;
+			for (const Network<X,T>* m = model->getParent(); m != NULL;
+				m = m->getParent()) d++;
+			return d;
+		}
+		/// Put all of the models inside of a network into s
+		static void getAllChildren(Network<X,T>* model, Set<Devs<X,T>*>& s)
+		{
+			descendant_collector visitor(s);
+			model->visitComponents(&visitor);
+		}
+	private:
+		AbstractLogicalProcess<X,T>* lp;
+		// Sets for computing structure changes.
+		Set<Devs<X,T>*> next;
+		Set<Devs<X,T>*> prev;
+		/**
+		 * Model transition functions are evaluated from the bottom up and
+		 * removed models are deleted from the top down. The depth of a model
+		 * is found once when it is put into one of these sets and is kept
+		 * with it. Models at the same depth are sorted by address.
+		 */
+		std::set<std::pair<long int,Network<X,T>*> > eval_set;
+		std::set<std::pair<long int,Devs<X,T>*> > sorted_removed;
+		/// Puts all of the models inside of a network into a set
+		class descendant_collector:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				descendant_collector(Set<Devs<X,T>*>& s):s(s){}
+				void visit(Devs<X,T>* model)
+				{
+					s.insert(model);
+					if (model->typeIsNetwork() != NULL)
+						model->typeIsNetwork()->visitComponents(this);
+				}
+			private:
+				Set<Devs<X,T>*>& s;
+		};
+};
+
+template <class X, class T>
+void ModelTransitions<X,T>::evaluate(Bag<Devs<X,T>*>& added,
+	Bag<Devs<X,T>*>& removed)
+{
+	while (!eval_set.empty())
+	{
+		Network<X,T>* network_model = eval_set.begin()->second;
+		eval_set.erase(eval_set.begin());
+		bool reports = network_model->reportsStructureChanges();
+		if (reports)
+		{
+			network_model->added_log.clear();
+			network_model->removed_log.clear();
+		}
+		else if (next.empty())
+			getAllChildren(network_model,prev);
+		else
+		{
+			// Models that were added by a network below this one
+			// are not put into prev, or else they would be missed
+			Set<Devs<X,T>*> before;
+			getAllChildren(network_model,before);
+			typename Set<Devs<X,T>*>::iterator iter;
+			for (iter = before.begin(); iter != before.end(); iter++)
+			{
+				if (next.find(*iter) == next.end() ||
+					prev.find(*iter) != prev.end())
+					prev.insert(*iter);
+			}
+		}
+		if (network_model->model_transition() &&
+				network_model->getParent() != NULL)
+		{
+			needed(network_model->getParent());
+		}
+		if (reports)
+		{
+			// Take the changes that the network reported
+			typename Bag<Devs<X,T>*>::iterator iter;
+			for (iter = network_model->added_log.begin();
+				iter != network_model->added_log.end(); iter++)
+				added.insert(*iter);
+			for (iter = network_model->removed_log.begin();
+				iter != network_model->removed_log.end(); iter++)
+				removed.insert(*iter);
+			network_model->added_log.clear();
+			network_model->removed_log.clear();
+		}
+		else getAllChildren(network_model,next);
+	}
+	// Find the set of models that were added.
+	set_assign_diff(added,next,prev);
+	// Find the set of models that were removed
+	set_assign_diff(removed,prev,next);
+	next.clear();
+	prev.clear();
+	// A model that was reported as removed by one network and as
+	// added by another has moved and stays where it is in the schedule.
+	if (!added.empty() && !removed.empty())
+	{
+		typename Bag<Devs<X,T>*>::iterator iter;
+		for (iter = added.begin(); iter != added.end(); iter++)
+			next.insert(*iter);
+		for (iter = removed.begin(); iter != removed.end(); iter++)
+			prev.insert(*iter);
+		added.clear();
+		removed.clear();
+		set_assign_diff(added,next,prev);
+		set_assign_diff(removed,prev,next);
+		next.clear();
+		prev.clear();
+	}
+}
+
+template <class X, class T>
+void ModelTransitions<X,T>::deleteModels(Bag<Devs<X,T>*>& removed)
+{
+	for (typename Bag<Devs<X,T>*>::iterator iter = removed.begin(); 
+		iter != removed.end(); iter++)
+	{
+		// Add to a sorted remove set for deletion
+		sorted_removed.insert(std::make_pair(depth(*iter),*iter)); 
+	}
+	// Done with the unsorted remove set
+	removed.clear();
+	// Delete the sorted removed models
+	while (!sorted_removed.empty())
+	{
+		// Get the model to erase
+		Devs<X,T>* model_to_remove = sorted_removed.begin()->second;
+		// Remove the model
+		sorted_removed.erase(sorted_removed.begin());
+		/**
+		 * Skip models that were inside of a network that has
+		 * already been deleted. This will avoid double delete problems.
+		 */
+		if (prev.find(model_to_remove) != prev.end())
+			continue;
+		if (model_to_remove->typeIsNetwork() != NULL)
+			getAllChildren(model_to_remove->typeIsNetwork(),prev);
+		// Delete the model and its children
+		delete model_to_remove;
+	}
+	// Removed sets should be empty now
+	prev.clear();
+	assert(sorted_removed.empty());
+}
+
+} // end of namespace
+
+#endif
@@ -34,6 +34,8 @@
 #include "adevs_bag.h"
 #include "adevs_set.h"
 #include "adevs_exception.h"
+#include "adevs_arena.h"
+#include "adevs_shared_value.h"
 #include <cstdlib>
 
 namespace adevs
@@ -46,7 +48,9 @@ namespace adevs
 template <class X, class T> class Network;
 template <class X, class T> class Atomic;
 template <class X, class T> class Schedule;
-template <class X, class T> class Simulator;
+template <class X, class T> class CalendarSchedule;
+template <class X, class T, unsigned int D> class DaryHeapSchedule;
+template <class X, class T, class S> class Simulator;
 
 /*
  * Constant indicating no processor assignment for the model. This is used by the
@@ -103,7 +107,7 @@ template <class X, class T = double> class Devs
 		 * of potentially expensive structure changes. 
 		 * If the return value is true, then the parent's model_transition()
 		 * will also be evaluated. For network models, the model_transition() function is
-		 * preceded and anteceded by a call to getComponents(). The difference
+		 * preceded and anteceded by a call to visitComponents(). The difference
 		 * of these two sets is used to determine if any models were added or removed
 		 * as part of the model transition.
 		 */
@@ -197,6 +201,10 @@ template <class X, class T = double> class Atomic: public Devs<X,T>
 			tL_cp = adevs_sentinel<T>();
 			x = y = NULL;
 			q_index = 0; // The Schedule requires this to be zero
+			route_index = 0; // The Simulator requires this to be zero
+			arena = NULL;
+			gc_needed = true;
+			no_lookahead = false;
 		}
 		/// Internal transition function.
 		virtual void delta_int() = 0;
@@ -235,20 +243,47 @@ template <class X, class T = double> class Atomic: public Devs<X,T>
 		 * itself to its current state when the restore() method is called
 		 * at the end of the lookahead calculation. If this method is not
 		 * supported then it must throw a method_not_supported_exception,
-		 * which is the default.
+		 * which is the default. A model that does not support it should
+		 * also override supportsLookahead to return false. The StateSaver
+		 * and IncrementalStateSaver implement this method and endLookahead
+		 * for a model whose state is trivially copyable.
 		 */
 		virtual void beginLookahead()
 		{
 			method_not_supported_exception ns("beginLookahead",this);
 			throw ns;
 		}
+		/**
+		 * Returns false if the model can not save and restore its state
+		 * for a lookahead calculation, in which case the simulator stops
+		 * the calculation without calling beginLookahead. The default
+		 * returns true and the simulator learns otherwise the first time
+		 * that beginLookahead throws a method_not_supported_exception,
+		 * after which it does not call beginLookahead again.
+		 */
+		virtual bool supportsLookahead() { return true; }
 		/**
 		 * This method is called when a lookahead calculation is finished.
 		 * The model must restore its state to that which it was in when
-		 * beginLookahead was called. The default implementation is to
-		 * do nothing.
+		 * beginLookahead was called. It is not called if beginLookahead
+		 * was not called or threw an exception. The default implementation
+		 * is to do nothing.
 		 */
 		virtual void endLookahead(){}
+		/**
+		 * This method is used by the ParSimulator to find a lookahead that
+		 * depends on the model's state. It is called after each change of
+		 * state and must return a positive value L such that no input that
+		 * arrives at or after the time t of this change will cause an output
+		 * before t+L, given the model's current state and its internal
+		 * events. For example, a server that is busy until time tc and
+		 * takes at least m units of time to serve a job can return tc+m-t.
+		 * The default returns zero, which means that the model has no
+		 * state dependent lookahead. A model must return zero always or
+		 * never. The state dependent lookahead is used by a thread only if
+		 * all of its models provide one.
+		 */
+		virtual T currentLookahead() { return adevs_zero<T>(); }
 		/// Destructor.
 		virtual ~Atomic(){}
 		/// Returns a pointer to this model.
@@ -261,20 +296,64 @@ template <class X, class T = double> class Atomic: public Devs<X,T>
 		 * removed in later versions of the code.
 		 */
 		T getLastEventTime() const { return tL; }
+		/**
+		 * Get an Arena for creating output values. This may be called only
+		 * from the output_func method. Objects created in the arena are
+		 * destroyed by the simulator at the end of the simulation cycle,
+		 * after the output has been delivered and any gc_output methods
+		 * have been called. Output sent to another processor by the
+		 * ParSimulator must be copied by the MessageManager's clone method.
+		 */
+		Arena& getOutputArena() { return *arena; }
+		/**
+		 * Models whose output needs no garbage collection, such as output
+		 * created in the output arena, can call this with false to stop
+		 * the simulator from calling gc_output. The default is true.
+		 */
+		void setGcOutput(bool flag) { gc_needed = flag; }
 
 	private:
 
-		friend class Simulator<X,T>;
+		template <class X2, class T2, class S2> friend class Simulator;
+		template <class X2, class T2, class S2> friend class LogicalProcess;
 		friend class Schedule<X,T>;
+		friend class CalendarSchedule<X,T>;
+		template <class X2, class T2, unsigned int D2> friend class DaryHeapSchedule;
 
 		// Time of last event
 		T tL;
 		// Index in the priority queue
 		unsigned int q_index;
+		// Index of the precompiled routes in the simulator
+		unsigned int route_index;
+		// Arena for the output function
+		Arena* arena;
+		// Call gc_output?
+		bool gc_needed;
 		// Input and output event bags
 		Bag<X> *x, *y;
 		// When did the model start checkpointing?
 		T tL_cp;
+		// Set when beginLookahead has thrown a method_not_supported_exception
+		bool no_lookahead;
+};
+
+/**
+ * The route_key picks out the part of a value that, together with the
+ * model producing it, decides where a network with static routes (see
+ * Network::routesAreStatic()) sends the value. By default there is no key,
+ * and so a network with static routes must send every value produced by a
+ * model to the same targets without changing the value. The key of a
+ * PortValue is its port (see adevs_digraph.h).
+ */
+template <class X> struct route_key
+{
+	/// Type of the key
+	typedef char type;
+	/// Get the key of a value
+	static type get(const X&) { return 0; }
+	/// Replace the key of a value
+	static void set(X&, const type&) {}
 };
 
 /**
@@ -288,6 +367,20 @@ template <class X, class T = double> class Network: public Devs<X,T>
 		Devs<X,T>()
 		{
 		}
+		/// Interface for visiting the components of the network
+		class ComponentVisitor
+		{
+			public:
+				virtual void visit(Devs<X,T>* model) = 0;
+				virtual ~ComponentVisitor(){}
+		};
+		/// Interface for visiting the couplings of the network
+		class CouplingVisitor
+		{
+			public:
+				virtual void visit(Devs<X,T>* src, Devs<X,T>* dst) = 0;
+				virtual ~CouplingVisitor(){}
+		};
 		/**
 		 * This method should fill the
 		 * set c with all the Network's components, excluding the 
@@ -295,6 +388,23 @@ template <class X, class T = double> class Network: public Devs<X,T>
 		 * @param c An empty set to the filled with the Network's components.
 		 */
 		virtual void getComponents(Set<Devs<X,T>*>& c) = 0;
+		/**
+		 * Call the visitor's visit method for each of the Network's
+		 * components, excluding the Network model itself. The simulators
+		 * use this instead of getComponents. The default implementation
+		 * calls getComponents and visits the members of that set. Derived
+		 * classes should override it if they can visit their components
+		 * without building a new set. The visitor must not change the
+		 * set of components.
+		 */
+		virtual void visitComponents(ComponentVisitor* visitor)
+		{
+			Set<Devs<X,T>*> c;
+			getComponents(c);
+			typename Set<Devs<X,T>*>::iterator iter = c.begin();
+			for (; iter != c.end(); iter++)
+				visitor->visit(*iter);
+		}
 		/**
 		 * This method is called by the Simulator to route an output value
 		 * produced by a model. This method should fill the bag r
@@ -307,6 +417,41 @@ template <class X, class T = double> class Network: public Devs<X,T>
 		 * @param r A bag to be filled with (target,value) pairs
 		 */
 		virtual void route(const X& value, Devs<X,T>* model, Bag<Event<X,T> >& r) = 0;
+		/**
+		 * Return true if the targets picked by the route method depend only
+		 * on the model, the route_key of the value, and the couplings, and
+		 * if the route method changes nothing but the key of the value it
+		 * delivers. The Simulator then works out the complete path from
+		 * an atomic model and key to the atomic targets once, and reuses it
+		 * until a model transition occurs or couplingsChanged() is called.
+		 * A network that returns true must call couplingsChanged() whenever
+		 * its couplings change, which they may do at any time. The default
+		 * is false.
+		 */
+		virtual bool routesAreStatic() const { return false; }
+		/**
+		 * Call the visitor's visit method for each pair of models such
+		 * that route may send output from the first to the second. Either
+		 * may be the network itself, which is the source of input to the
+		 * network and the target of output from it. Return false,
+		 * without visiting anything, if the couplings can not be listed;
+		 * every component is then assumed to be coupled to every other.
+		 * The parallel simulators use this to assign models to processors
+		 * and to find the processors that send messages to each other.
+		 * The default returns false.
+		 */
+		virtual bool visitCouplings(CouplingVisitor*) { return false; }
+		/**
+		 * Return true if the model_transition() method of this network
+		 * reports every component that it adds or removes by calling
+		 * addedComponent() and removedComponent(). The Simulator then
+		 * uses these reports instead of comparing the sets of
+		 * components from before and after the model transition, and so
+		 * the cost of a structure change depends on the number of models
+		 * that are added and removed rather than on the size of the
+		 * network. The default is false.
+		 */
+		virtual bool reportsStructureChanges() const { return false; }
 		/**
 		 * Destructor.  This destructor does not delete any component models.
 		 * Any necessary cleanup should be done by the derived class.
@@ -316,8 +461,40 @@ template <class X, class T = double> class Network: public Devs<X,T>
 		}
 		/// Returns a pointer to this model.
 		Network<X,T>* typeIsNetwork() { return this; }
+		/**
+		 * Get a number that changes each time any network calls
+		 * couplingsChanged(). The Simulator compares it to the value
+		 * it saw last to know when its precompiled routes are out of date.
+		 */
+		static long getCouplingGeneration() { return coupling_gen; }
+	protected:
+		/**
+		 * Call this when the couplings of a network with static routes
+		 * change. This may be done from any thread.
+		 */
+		static void couplingsChanged() { shared_value_incr(&coupling_gen); }
+		/**
+		 * Call this in model_transition() when a component is added.
+		 * If the model is a network, then its components are added too.
+		 */
+		void addedComponent(Devs<X,T>* model) { added_log.insert(model); }
+		/**
+		 * Call this in model_transition() when a component is removed.
+		 * The Simulator will delete the model and its components as it 
+		 * does for any model that is removed.
+		 */
+		void removedComponent(Devs<X,T>* model) { removed_log.insert(model); }
+	private:
+		template <class X2, class T2> friend class ModelTransitions;
+		// Changes reported in the last model transition
+		Bag<Devs<X,T>*> added_log, removed_log;
+		// Incremented by couplingsChanged()
+		static volatile long coupling_gen;
 };
 
+template <class X, class T>
+volatile long Network<X,T>::coupling_gen = 0;
+
 } // end of namespace
 
 #endif
@@ -59,6 +59,8 @@ template <typename X> class MessageManager
 /**
  * This is the default MessageManager that is used by the 
  * parallel simulator if an alternative is not provided.
+ * Values held by a shared_value need nothing more than
+ * this because copying them only updates their reference count.
  */
 template <typename X> class NullMessageManager:
 	public MessageManager<X>
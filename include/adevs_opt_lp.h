@@ -0,0 +1,424 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_opt_lp_h_
+#define __adevs_opt_lp_h_
+#include "adevs_time.h"
+#include "adevs_message_q.h"
+#include "adevs_msg_manager.h"
+#include "adevs_abstract_simulator.h"
+#include "adevs_exception.h"
+#include "adevs_sched.h"
+#include "adevs_simulator.h"
+#include <omp.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace adevs
+{
+
+/**
+ * This logical process simulates its models optimistically with the
+ * Time Warp algorithm. Events are executed as soon as they are known,
+ * without waiting to learn if other processes will send input that
+ * precedes them. The state of every model is saved at a checkpoint
+ * with its beginLookahead method. If a message arrives in the past of
+ * the process, then the models are restored to the checkpoint with their
+ * endLookahead methods, anti-messages cancel the outputs that were sent
+ * at or after the time of the late message, and the events since the
+ * checkpoint are executed again as needed. Outputs that were not cancelled
+ * are not sent twice. When the global virtual time advances, the events
+ * that precede it are executed once more with the event listeners
+ * attached and their final state becomes the new checkpoint. The inputs
+ * and the records of outputs that precede the checkpoint are discarded
+ * at this time. The events that follow the global virtual time are
+ * executed again as the process advances from the new checkpoint, as
+ * after a rollback, and so their outputs are not sent twice either.
+ * A model saves only one state, and so there is only one checkpoint.
+ * The OptSimulator coordinates these steps.
+ */
+template <class X, class T = double, class S = Schedule<X,T> > class OptLogicalProcess:
+	public EventListener<X,T>,
+	public AbstractLogicalProcess<X,T>
+{
+	public:
+		/**
+		 * Constructor builds a logical process without any models
+		 * assigned to it.
+		 */
+		OptLogicalProcess(int ID, OptLogicalProcess<X,T,S>** all_lps,
+			int lp_count, AbstractSimulator<X,T>* psim,
+			MessageManager<X>* msg_manager);
+		/// Assign a model to this logical process.
+		void addModel(Devs<X,T>* model);
+		/// Put a message into the back of the input queue.
+		void sendMessage(Message<X,T>& msg) { input_q.insert(msg); }
+		/// Get the process ID
+		int getID() const { return ID; }
+		/// Get the statistics for the input queue
+		const MessageQStats& getQueueStats() const { return input_q.getStats(); }
+		/// Send an output to the process that owns the model
+		void notifyInput(Atomic<X,T>* model, X& value);
+		/// Only committed outputs are reported to the listeners
+		void outputEvent(Event<X,T> x, T t)
+		{
+			if (reporting) psim->notify_output_listeners(x.model,x.value,t);
+		}
+		/// Only committed state changes are reported to the listeners
+		void stateChange(Atomic<X,T>* model, T t)
+		{
+			if (reporting) psim->notify_state_listeners(model,t);
+		}
+		/// Take the first checkpoint. This is done at the start of execUntil.
+		void beginRun();
+		/// Execute at most n events whose time stamps are not beyond t_stop.
+		void advance(T t_stop, int n);
+		/**
+		 * Take the messages from the input queue, rolling back if they
+		 * are late, and return the time of the next event to execute. 
+		 */
+		Time<T> processInputMessages();
+		/**
+		 * Commit the events that precede the global virtual time and
+		 * make the committed state the new checkpoint. The process
+		 * continues from there.
+		 */
+		void commit(Time<T> gvt);
+		/// Restore the committed state. This is done at the end of execUntil.
+		void endRun();
+		/// Get the time of the next event to execute
+		Time<T> getNextEventTime();
+		/// Returns true if a model was unable to save its state
+		bool failed() const { return lookahead_failed; }
+		/// Get the number of rollbacks done by this process
+		unsigned long int getRollbacks() const { return rollbacks; }
+		/// Destructor leaves the models intact.
+		~OptLogicalProcess();
+	private:
+		// Record of an output sent to another process
+		struct sent_t
+		{
+			Time<T> t;
+			int dest;
+			unsigned long int seq;
+		};
+		// ID of this LP
+		const int ID;
+		// All of the LPs
+		OptLogicalProcess<X,T,S>** all_lps;
+		// Abstract simulator for notifying listeners
+		AbstractSimulator<X,T>* psim;
+		// For managing inter-lp messages
+		MessageManager<X>* msg_manager;
+		// Simulator for computing state transitions and outputs
+		Simulator<X,T,S> sim;
+		// Input messages to the LP
+		MessageQ<X,T> input_q;
+		// Inputs received since the checkpoint, sorted by time, sender,
+		// and sequence number. Those before next_in have been executed.
+		std::vector<Message<X,T> > in_list;
+		unsigned next_in;
+		// Outputs sent since the checkpoint in the order they were sent
+		std::vector<sent_t> out_list;
+		Bag<Event<X,T> > xb;
+		// Time of the checkpoint, the first and last events after it,
+		// and the current event. Outputs are sent only at or after tSend.
+		Time<T> tC, tFirst, tL, tNow, tSend;
+		// Number for the next message and the rollback count
+		unsigned long int seq, rollbacks;
+		bool reporting, lookahead_failed;
+		void execNextEvent();
+		void rollback(Time<T> t);
+		void cancel(Time<T> t);
+		Time<T> tNextEvent(Time<T> t);
+		void addToSimulator(Devs<X,T>* model);
+		// Adds the components of a network to the simulator
+		class add_visitor:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				add_visitor(OptLogicalProcess<X,T,S>* lp):lp(lp){}
+				void visit(Devs<X,T>* model) { lp->addToSimulator(model); }
+			private:
+				OptLogicalProcess<X,T,S>* lp;
+		};
+		// Order of the messages in the in_list
+		static bool before(const Message<X,T>& a, const Message<X,T>& b)
+		{
+			if (a.t != b.t) return a.t < b.t;
+			if (a.src != b.src) return a.src < b.src;
+			return a.seq < b.seq;
+		}
+};
+
+template <class X, class T, class S>
+OptLogicalProcess<X,T,S>::OptLogicalProcess(int ID,
+	OptLogicalProcess<X,T,S>** all_lps, int lp_count,
+	AbstractSimulator<X,T>* psim, MessageManager<X>* msg_manager):
+	ID(ID),all_lps(all_lps),psim(psim),msg_manager(msg_manager),sim(this),
+	input_q(lp_count),
+	next_in(0),seq(0),rollbacks(0),reporting(false),lookahead_failed(false)
+{
+	tC = tFirst = tL = tNow = tSend = Time<T>(0,0);
+	all_lps[ID] = this;
+	sim.addEventListener(this);
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::addModel(Devs<X,T>* model)
+{
+	addToSimulator(model);
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::addToSimulator(Devs<X,T>* model)
+{
+	model->setProc(ID);
+	Atomic<X,T>* a = model->typeIsAtomic();
+	if (a != NULL)
+	{
+		sim.addModel(a);
+	}
+	else
+	{
+		add_visitor visitor(this);
+		model->typeIsNetwork()->visitComponents(&visitor);
+	}
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::notifyInput(Atomic<X,T>* model, X& value)
+{
+	// Don't send messages that have already been sent
+	if (tNow < tSend) return;
+	assert(model->getProc() != ID);
+	Message<X,T> msg(msg_manager->clone(value));
+	msg.t = tNow;
+	msg.src = ID;
+	msg.target = model;
+	msg.type = Message<X,T>::OUTPUT;
+	msg.seq = seq++;
+	// Remember it in case it must be cancelled
+	sent_t sent;
+	sent.t = tNow;
+	sent.dest = model->getProc();
+	sent.seq = msg.seq;
+	out_list.push_back(sent);
+	all_lps[sent.dest]->sendMessage(msg);
+}
+
+template <class X, class T, class S>
+Time<T> OptLogicalProcess<X,T,S>::tNextEvent(Time<T> tlast)
+{
+	if (tlast.t < sim.nextEventTime())
+	{
+		tlast.t = sim.nextEventTime();
+		tlast.c = 0;
+	}
+	else tlast.c++;
+	return tlast;
+}
+
+template <class X, class T, class S>
+Time<T> OptLogicalProcess<X,T,S>::getNextEventTime()
+{
+	Time<T> tN(tNextEvent(tL));
+	if (next_in < in_list.size() && in_list[next_in].t < tN)
+		tN = in_list[next_in].t;
+	return tN;
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::execNextEvent()
+{
+	Time<T> tSelf(tNextEvent(tL));
+	tNow = getNextEventTime();
+	assert(tNow.t < adevs_inf<T>());
+	// Send output if this is an internal or confluent event
+	if (tNow == tSelf) sim.computeNextOutput();
+	// Inject the input at this time
+	while (next_in < in_list.size() && in_list[next_in].t <= tNow)
+	{
+		Event<X,T> input_event(in_list[next_in].target,in_list[next_in].value);
+		xb.insert(input_event);
+		next_in++;
+	}
+	if (!sim.tryComputeNextState(xb,tNow.t))
+		lookahead_failed = true;
+	xb.clear();
+	if (tL == tC) tFirst = tNow;
+	tL = tNow;
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::beginRun()
+{
+	tC = tL;
+	sim.beginLookahead();
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::advance(T t_stop, int n)
+{
+	for (int i = 0; i < n && !lookahead_failed; i++)
+	{
+		Time<T> tN(getNextEventTime());
+		if (tN.t == adevs_inf<T>() || tN.t > t_stop) return;
+		execNextEvent();
+	}
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::rollback(Time<T> t)
+{
+	// The global virtual time keeps us from going back past the checkpoint
+	assert(tC < t);
+	rollbacks++;
+	sim.endLookahead();
+	sim.beginLookahead();
+	tL = tC;
+	next_in = 0;
+	cancel(t);
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::cancel(Time<T> t)
+{
+	// Cancel the outputs sent at or after t
+	while (!out_list.empty() && t <= out_list.back().t)
+	{
+		Message<X,T> msg;
+		msg.t = out_list.back().t;
+		msg.src = ID;
+		msg.target = NULL;
+		msg.type = Message<X,T>::ANTI;
+		msg.seq = out_list.back().seq;
+		all_lps[out_list.back().dest]->sendMessage(msg);
+		out_list.pop_back();
+	}
+	// The outputs sent before t are still good
+	tSend = t;
+}
+
+template <class X, class T, class S>
+Time<T> OptLogicalProcess<X,T,S>::processInputMessages()
+{
+	while (!input_q.empty())
+	{
+		Message<X,T> msg(input_q.remove());
+		if (msg.type == Message<X,T>::OUTPUT)
+		{
+			if (msg.t <= tL) rollback(msg.t);
+			// Outputs that were sent by events we have undone, but which
+			// are not yet executed again, did not see this input
+			else if (msg.t < tSend) cancel(msg.t);
+			in_list.insert(std::upper_bound(in_list.begin()+next_in,
+				in_list.end(),msg,before),msg);
+		}
+		else if (msg.type == Message<X,T>::ANTI)
+		{
+			// The message that is cancelled arrived before the anti-message
+			typename std::vector<Message<X,T> >::iterator iter =
+				std::lower_bound(in_list.begin(),in_list.end(),msg,before);
+			assert(iter != in_list.end());
+			assert((*iter).src == msg.src && (*iter).seq == msg.seq);
+			if ((unsigned)(iter-in_list.begin()) < next_in)
+				rollback(msg.t);
+			else if (msg.t < tSend) cancel(msg.t);
+			msg_manager->destroy((*iter).value);
+			in_list.erase(iter);
+		}
+	}
+	return getNextEventTime();
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::commit(Time<T> gvt)
+{
+	// Is there anything to commit?
+	if (tL == tC || !(tFirst < gvt))
+		return;
+	// Everything up to tEnd has been sent already
+	Time<T> tEnd(tL);
+	if (tSend < Time<T>(tEnd.t,tEnd.c+1))
+		tSend = Time<T>(tEnd.t,tEnd.c+1);
+	// Go back to the checkpoint and execute the events
+	// that precede gvt with the listeners attached
+	sim.endLookahead();
+	tL = tC;
+	next_in = 0;
+	reporting = true;
+	while (getNextEventTime() < gvt)
+	{
+		assert(getNextEventTime() <= tEnd);
+		execNextEvent();
+	}
+	reporting = false;
+	assert(tL <= tEnd);
+	// Discard the inputs that were used
+	for (unsigned i = 0; i < next_in; i++)
+		msg_manager->destroy(in_list[i].value);
+	in_list.erase(in_list.begin(),in_list.begin()+next_in);
+	next_in = 0;
+	// and the outputs that can no longer be cancelled
+	unsigned k = 0;
+	while (k < out_list.size() && out_list[k].t < gvt) k++;
+	out_list.erase(out_list.begin(),out_list.begin()+k);
+	// Take a new checkpoint. The events up to tEnd are executed
+	// again by advance without sending their outputs.
+	tC = tL;
+	sim.beginLookahead();
+}
+
+template <class X, class T, class S>
+void OptLogicalProcess<X,T,S>::endRun()
+{
+	sim.endLookahead();
+	tL = tC;
+	next_in = 0;
+}
+
+template <class X, class T, class S>
+OptLogicalProcess<X,T,S>::~OptLogicalProcess()
+{
+	for (unsigned i = 0; i < in_list.size(); i++)
+		msg_manager->destroy(in_list[i].value);
+	while (!input_q.empty())
+	{
+		Message<X,T> msg(input_q.remove());
+		if (msg.type == Message<X,T>::OUTPUT)
+			msg_manager->destroy(msg.value);
+	}
+}
+
+} // end of namespace 
+
+#endif
@@ -0,0 +1,268 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_opt_simulator_h_
+#define __adevs_opt_simulator_h_
+#include "adevs_abstract_simulator.h"
+#include "adevs_msg_manager.h"
+#include "adevs_opt_lp.h"
+#include "adevs_lp_graph.h"
+#include "adevs_partitioner.h"
+#include "adevs_exception.h"
+#include <omp.h>
+#include <cstdio>
+
+namespace adevs
+{
+
+/**
+ * This is an optimistic parallel simulator that uses the Time Warp
+ * algorithm. Models are assigned to threads (processors) as for the
+ * ParSimulator, but no lookahead is needed. Instead, every atomic model
+ * must implement the beginLookahead and endLookahead methods to save and
+ * restore its state, which the StateSaver and IncrementalStateSaver can do
+ * for it; the state saving models in test/optsim are other examples.
+ * The threads execute their events speculatively, a batch at a time, and
+ * then stop to exchange messages, roll back where needed, compute the
+ * global virtual time (GVT), and commit the events that precede it. Event
+ * listeners see only committed events. The models must be deterministic,
+ * because events are executed again after a rollback and to commit them,
+ * and must not share data across threads. This simulator does not support
+ * dynamic structure models. The template argument S selects the event
+ * schedule used by each thread, as for the Simulator.
+ */
+template <class X, class T = double, class S = Schedule<X,T> > class OptSimulator:
+	public AbstractSimulator<X,T>
+{
+	public:
+		/**
+		 * Create a simulator for the provided model that uses one
+		 * thread for each of the available processors. Models without
+		 * a processor are assigned by a Partitioner. The message
+		 * manager is used as in the ParSimulator.
+		 */
+		OptSimulator(Devs<X,T>* model, MessageManager<X>* msg_manager = NULL);
+		/**
+		 * Create a simulator with one thread for each node in the graph.
+		 * Messages may go to any process, so only the number of nodes
+		 * in the graph is used.
+		 */
+		OptSimulator(Devs<X,T>* model, LpGraph& g,
+			MessageManager<X>* msg_manager = NULL);
+		/// Get the model's next event time
+		T nextEventTime();
+		/**
+		 * Execute the simulator until the next event time is greater
+		 * than the specified value. This will throw an adevs::exception
+		 * if a model could not save its state.
+		 */
+		void execUntil(T stop_time);
+		/**
+		 * Set the number of events that each thread executes before
+		 * the next GVT computation. The default is 64.
+		 */
+		void setBatchSize(int events) { batch = events; }
+		/// Get the number of rollbacks done by all of the threads
+		unsigned long int getRollbacks() const;
+		/// Get the statistics for the input queue of a thread
+		const MessageQStats& getQueueStats(int lp_id) const
+		{
+			return lp[lp_id]->getQueueStats();
+		}
+		/**
+		 * Deletes the simulator, but leaves the model intact. The model must
+		 * exist when the simulator is deleted, so delete the model only after
+		 * the simulator is deleted.
+		 */
+		~OptSimulator();
+	private:
+		OptLogicalProcess<X,T,S>** lp;
+		int lp_count, batch;
+		MessageManager<X>* msg_manager;
+		// Local virtual times and failures used to compute the GVT
+		Time<T>* lvt;
+		bool* failed;
+		void init(Devs<X,T>* model);
+		void init_sim(Devs<X,T>* model, int count);
+		// Assigns the components of a network to the LPs
+		class init_visitor:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				init_visitor(OptSimulator<X,T,S>* sim):sim(sim){}
+				void visit(Devs<X,T>* model) { sim->init(model); }
+			private:
+				OptSimulator<X,T,S>* sim;
+		};
+};
+
+template <class X, class T, class S>
+OptSimulator<X,T,S>::OptSimulator(Devs<X,T>* model,
+	MessageManager<X>* msg_manager):
+	AbstractSimulator<X,T>(),batch(64),msg_manager(msg_manager)
+{
+	Partitioner<X,T> partitioner(model);
+	LpGraph g;
+	partitioner.partition(omp_get_max_threads(),g);
+	init_sim(model,omp_get_max_threads());
+}
+
+template <class X, class T, class S>
+OptSimulator<X,T,S>::OptSimulator(Devs<X,T>* model, LpGraph& g,
+	MessageManager<X>* msg_manager):
+	AbstractSimulator<X,T>(),batch(64),msg_manager(msg_manager)
+{
+	init_sim(model,g.getLPCount());
+}
+
+template <class X, class T, class S>
+void OptSimulator<X,T,S>::init_sim(Devs<X,T>* model, int count)
+{
+	if (msg_manager == NULL) msg_manager = new NullMessageManager<X>();
+	lp_count = count;
+	if (omp_get_max_threads() < lp_count)
+	{
+		char buffer[1000];
+		sprintf(buffer,"More LPs than threads. Set OMP_NUM_THREADS=%d.",
+			lp_count);
+		exception err(buffer);
+		throw err;
+	}
+	lvt = new Time<T>[lp_count];
+	failed = new bool[lp_count];
+	lp = new OptLogicalProcess<X,T,S>*[lp_count];
+	for (int i = 0; i < lp_count; i++)
+		lp[i] = new OptLogicalProcess<X,T,S>(i,lp,lp_count,this,msg_manager);
+	init(model);
+}
+
+template <class X, class T, class S>
+void OptSimulator<X,T,S>::init(Devs<X,T>* model)
+{
+	if (model->getProc() >= 0 && model->getProc() < lp_count)
+	{
+		lp[model->getProc()]->addModel(model);
+		return;
+	}
+	Atomic<X,T>* a = model->typeIsAtomic();
+	if (a != NULL)
+	{
+		int lp_assign = a->getProc();
+		if (lp_assign < 0 || lp_assign >= lp_count)
+			lp_assign =
+				((unsigned long int)(a)^(unsigned long int)(this))%lp_count;
+		lp[lp_assign]->addModel(a);
+	}
+	else
+	{
+		init_visitor visitor(this);
+		model->typeIsNetwork()->visitComponents(&visitor);
+	}
+}
+
+template <class X, class T, class S>
+T OptSimulator<X,T,S>::nextEventTime()
+{
+	Time<T> tN = Time<T>::Inf();
+	for (int i = 0; i < lp_count; i++)
+	{
+		if (lp[i]->getNextEventTime() < tN)
+			tN = lp[i]->getNextEventTime();
+	}
+	return tN.t;
+}
+
+template <class X, class T, class S>
+void OptSimulator<X,T,S>::execUntil(T tstop)
+{
+	#pragma omp parallel num_threads(lp_count)
+	{
+		OptLogicalProcess<X,T,S>* p = lp[omp_get_thread_num()];
+		p->beginRun();
+		while (true)
+		{
+			// Execute events speculatively
+			p->advance(tstop,batch);
+			#pragma omp barrier
+			// Every message sent so far is in an input queue. Anti-messages
+			// sent now have time stamps that are not less than the local 
+			// virtual time of their sender.
+			lvt[p->getID()] = p->processInputMessages();
+			failed[p->getID()] = p->failed();
+			#pragma omp barrier
+			// The lvt and failed arrays are not written again until every
+			// thread has passed the first barrier of the next round
+			Time<T> gvt(Time<T>::Inf());
+			bool stop = false;
+			for (int i = 0; i < lp_count; i++)
+			{
+				if (lvt[i] < gvt) gvt = lvt[i];
+				stop = stop || failed[i];
+			}
+			if (stop) break;
+			p->commit(gvt);
+			if (gvt.t == adevs_inf<T>() || tstop < gvt.t) break;
+		}
+		p->endRun();
+	}
+	for (int i = 0; i < lp_count; i++)
+	{
+		if (failed[i])
+		{
+			exception err("Time Warp needs models that implement "
+				"beginLookahead and endLookahead");
+			throw err;
+		}
+	}
+}
+
+template <class X, class T, class S>
+unsigned long int OptSimulator<X,T,S>::getRollbacks() const
+{
+	unsigned long int count = 0;
+	for (int i = 0; i < lp_count; i++)
+		count += lp[i]->getRollbacks();
+	return count;
+}
+
+template <class X, class T, class S>
+OptSimulator<X,T,S>::~OptSimulator()
+{
+	for (int i = 0; i < lp_count; i++)
+		delete lp[i];
+	delete [] lp;
+	delete [] lvt;
+	delete [] failed;
+	delete msg_manager;
+}
+
+} // end of namespace
+
+#endif
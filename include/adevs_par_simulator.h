@@ -33,11 +33,14 @@
 #include "adevs_abstract_simulator.h"
 #include "adevs_msg_manager.h"
 #include "adevs_lp.h"
+#include "adevs_lp_executor.h"
 #include "adevs_lp_graph.h"
+#include "adevs_partitioner.h"
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cstdio>
 
 namespace adevs
@@ -48,30 +51,49 @@ namespace adevs
  * Models, network and atomic, can be assigned to specific threads (processors) by calling the
  * setProc() method. The components of a network will inherit its thread assignment.
  * Model's with an explicit assignment must have a positive lookahead. Atomic models that are
- * unassigned, by inheritance or otherwise, must have a positive lookahead and will
- * be assigned randomly to a thread. Note that this simulator does not support dynamic
- * structure models.
+ * unassigned, by inheritance or otherwise, must have a positive lookahead. They are
+ * assigned to threads by a Partitioner if the simulator picks the number of threads, and
+ * randomly otherwise. The models that the simulator assigns can be moved
+ * between threads as the simulation runs (see setLoadBalancing).
+ * The structure of a network that is assigned to a thread with setProc
+ * changes when its model transition function says so, as in the Simulator,
+ * and the thread that owns the network routes the input that it receives.
+ * The model transitions of other networks are evaluated when the threads
+ * stop together, which is at the end of execUntil and at every load
+ * balancing stop. Models added then that have no thread are put by the
+ * Partitioner on the threads of the models that they are coupled to, and
+ * the models that are already placed do not move (see Partitioner::place).
+ * A network that changes while the threads run must not couple its thread
+ * to a thread that it did not already send input to, because the graph of
+ * the threads is found again only when they stop. The template argument S
+ * selects the event schedule used by each thread, as for the Simulator.
  */
-template <class X, class T = double> class ParSimulator:
+template <class X, class T = double, class S = Schedule<X,T> > class ParSimulator:
    public AbstractSimulator<X,T>	
 {
 	public:
 		/**
 		 * Create a simulator for the provided model. The Atomic components will
-		 * be assigned to the preferred processors, or assigned randomly if no
-		 * preference is given or the preference can not be satisfied. The
+		 * be assigned to the preferred processors. Components without a
+		 * preference are assigned by a Partitioner, which calls their setProc
+		 * method, so that the threads share the work and coupled
+		 * models tend to share a thread. The
 		 * message manager is used to handle inter-thread events. If msg_manager
 		 * is NULL, the assignment and copy constructors of output objects 
 		 * are used and their is no explicit cleanup (see the MessageManager
-		 * documentation). This constructor assumes all to all connection of the
-		 * processors.
+		 * documentation). The processors are connected as the couplings of
+		 * the model require, so a thread sends null messages only to the
+		 * threads that its models can send input to.
 		 */
 		ParSimulator(Devs<X,T>* model, MessageManager<X>* msg_manager = NULL);
 		/**
 		 * This constructor accepts a directed graph whose edges tell the
 		 * simulator which processes feed input to which other processes.
 		 * For example, a simulator with processors 1, 2, and 3 where 1 -> 2
-		 * and 2 -> 3 would have two edges: 1->2 and 2->3.
+		 * and 2 -> 3 would have two edges: 1->2 and 2->3. If the graph has
+		 * more processes than there are threads, then the processes are
+		 * run as tasks by omp_get_max_threads() threads (see LpExecutor).
+		 * A Partitioner can make a graph with any number of processes.
 		 */
 		ParSimulator(Devs<X,T>* model, LpGraph& g,
 			MessageManager<X>* msg_manager = NULL);
@@ -81,8 +103,59 @@ template <class X, class T = double> class ParSimulator:
 		 * Execute the simulator until the next event time is greater
 		 * than the specified value. There is no global clock, 
 		 * so this must be the actual time that you want to stop.
+		 * The model transitions that were put off are evaluated
+		 * before this returns.
 		 */
 		void execUntil(T stop_time);
+		/**
+		 * <P>Move models between threads to follow the work as it moves
+		 * through the model. The threads stop together at every multiple
+		 * of interval, and if the number of state changes computed by
+		 * the busiest thread since the last stop is more than
+		 * (1+tolerance) times the average, then the models that the
+		 * simulator assigned to threads, rather than those assigned with
+		 * setProc, are assigned again with Partitioner::repartition.
+		 * The models that move take their pending input with them. An
+		 * interval of zero or less, which is the default, turns this off.</P>
+		 * <P>The threads do not compute output ahead of a stop, and so a
+		 * short interval reduces the benefit of lookahead. The interval
+		 * should be long enough for each thread to compute many events.</P>
+		 */
+		void setLoadBalancing(T interval, double tolerance = 0.1);
+		/// Get the number of times that models were moved between threads
+		unsigned long int getRebalanceCount() const { return rebalances; }
+		/**
+		 * Get the statistics for the input queue of a thread. The
+		 * max_depth, in particular, shows how far the thread falls
+		 * behind the threads that send messages to it.
+		 */
+		const MessageQStats& getQueueStats(int lp_id) const
+		{
+			return lp[lp_id]->getQueueStats();
+		}
+		/**
+		 * Get the counts of the events computed and the null and output
+		 * messages sent by a thread.
+		 */
+		const LpStats& getLpStats(int lp_id) const
+		{
+			return lp[lp_id]->getStats();
+		}
+		/// Get the number of logical processes
+		int getLPCount() const { return lp_count; }
+		/**
+		 * Tell the tracer what each logical process does as it runs,
+		 * or stop if the tracer is NULL. For example, a ChromeTracer
+		 * gives a timeline of the processes that shows where they wait
+		 * for each other. This may be called only when execUntil is not
+		 * running. The tracer is not deleted by the simulator.
+		 */
+		void setTracer(LpTracer<T>* tracer)
+		{
+			if (tracer != NULL) tracer->start(lp_count);
+			for (int i = 0; i < lp_count; i++)
+				lp[i]->setTracer(tracer);
+		}
 		/**
 		 * Deletes the simulator, but leaves the model intact. The model must
 		 * exist when the simulator is deleted, so delete the model only after
@@ -90,67 +163,92 @@ template <class X, class T = double> class ParSimulator:
 		 */
 		~ParSimulator();
 	private:
-		LogicalProcess<X,T>** lp;
+		Devs<X,T>* model;
+		LogicalProcess<X,T,S>** lp;
 		int lp_count;
+		// The model transitions that are put off until the threads stop
+		ModelTransitions<X,T> transitions;
+		// Finds the new assignments for load balancing
+		Partitioner<X,T>* partitioner;
+		// The load balancing interval, the next stop, and how
+		// much imbalance is tolerated
+		T interval, t_barrier;
+		double tolerance;
+		unsigned long int rebalances;
+		// The state changes computed by each process up to the last stop
+		std::vector<unsigned long int> last_events;
+		// Runs the processes if there are more of them than threads
+		LpExecutor<LogicalProcess<X,T,S>,T>* executor;
 		MessageManager<X>* msg_manager;
-		void init(Devs<X,T>* model);
+		void init(Devs<X,T>* model, T t = adevs_zero<T>());
 		void init_sim(Devs<X,T>* model, LpGraph& g);
+		// Run the processes until t_stop
+		void run(T t_stop);
+		// Change the structure of the model at the stop t
+		void changeStructure(T t);
+		// Move models if the load is unbalanced at the stop t
+		void rebalance(T t);
+		// Assigns the components of a network to the LPs
+		class init_visitor:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				init_visitor(ParSimulator<X,T,S>* sim, T t):sim(sim),t(t){}
+				void visit(Devs<X,T>* model) { sim->init(model,t); }
+			private:
+				ParSimulator<X,T,S>* sim;
+				T t;
+		};
 }; 
 
-template <class X, class T>
-ParSimulator<X,T>::ParSimulator(Devs<X,T>* model, MessageManager<X>* msg_manager):
+template <class X, class T, class S>
+ParSimulator<X,T,S>::ParSimulator(Devs<X,T>* model, MessageManager<X>* msg_manager):
 	AbstractSimulator<X,T>(),msg_manager(msg_manager)
 {
-	// Create an all to all coupling
 	lp_count = omp_get_max_threads();
+	// Assign the free models to the threads and connect the threads
+	// that have coupled models
+	partitioner = new Partitioner<X,T>(model);
 	LpGraph g;
-	for (int i = 0; i < lp_count; i++)
-	{
-		for (int j = 0; j < lp_count; j++)
-		{
-			if (i != j)
-			{
-				g.addEdge(i,j);
-				g.addEdge(j,i);
-			}
-		}
-	}
+	partitioner->partition(lp_count,g);
 	init_sim(model,g);
 }
 
-template <class X, class T>
-ParSimulator<X,T>::ParSimulator(Devs<X,T>* model, LpGraph& g,
+template <class X, class T, class S>
+ParSimulator<X,T,S>::ParSimulator(Devs<X,T>* model, LpGraph& g,
 		MessageManager<X>* msg_manager):
 	AbstractSimulator<X,T>(),msg_manager(msg_manager)
 {
+	// Remember which models are free to move before they are assigned
+	partitioner = new Partitioner<X,T>(model);
 	init_sim(model,g);
 }
 
-template <class X, class T>
-void ParSimulator<X,T>::init_sim(Devs<X,T>* model, LpGraph& g)
+template <class X, class T, class S>
+void ParSimulator<X,T,S>::init_sim(Devs<X,T>* model, LpGraph& g)
 {
 	if (msg_manager == NULL) msg_manager = new NullMessageManager<X>();
+	this->model = model;
 	lp_count = g.getLPCount();
-	if (omp_get_max_threads() < lp_count)
-	{
-		char buffer[1000];
-		sprintf(buffer,"More LPs than threads. Set OMP_NUM_THREADS=%d.",
-			lp_count);
-		exception err(buffer);
-		throw err;
-	}
-	omp_set_num_threads(lp_count);
-	lp = new LogicalProcess<X,T>*[lp_count];
+	executor = NULL;
+	interval = t_barrier = adevs_zero<T>();
+	tolerance = 0.0;
+	rebalances = 0;
+	last_events.assign(lp_count,0);
+	lp = new LogicalProcess<X,T,S>*[lp_count];
 	for (int i = 0; i < lp_count; i++)
 	{
-		lp[i] = new LogicalProcess<X,T>(i,g.getI(i),g.getE(i),
-			lp,this,msg_manager);
+		lp[i] = new LogicalProcess<X,T,S>(i,g.getI(i),g.getE(i),
+			lp,lp_count,this,msg_manager);
 	}
+	if (omp_get_max_threads() < lp_count)
+		executor = new LpExecutor<LogicalProcess<X,T,S>,T>(
+			lp,lp_count,omp_get_max_threads());
 	init(model);
 }
 
-template <class X, class T>
-T ParSimulator<X,T>::nextEventTime()
+template <class X, class T, class S>
+T ParSimulator<X,T,S>::nextEventTime()
 {
 	Time<T> tN = Time<T>::Inf();
 	for (int i = 0; i < lp_count; i++)
@@ -161,30 +259,160 @@ T ParSimulator<X,T>::nextEventTime()
 	return tN.t;
 }
 
-template <class X, class T>
-ParSimulator<X,T>::~ParSimulator()
+template <class X, class T, class S>
+ParSimulator<X,T,S>::~ParSimulator()
 {
+	if (executor != NULL)
+		delete executor;
+	delete partitioner;
 	for (int i = 0; i < lp_count; i++)
 		delete lp[i];
 	delete [] lp;
    delete msg_manager;	
 }
 
-template <class X, class T>
-void ParSimulator<X,T>::execUntil(T tstop)
+template <class X, class T, class S>
+void ParSimulator<X,T,S>::execUntil(T tstop)
+{
+	while (adevs_zero<T>() < interval && t_barrier <= tstop)
+	{
+		run(t_barrier);
+		changeStructure(t_barrier);
+		rebalance(t_barrier);
+		// Skip the stops at which nothing has happened
+		T tN = nextEventTime();
+		if (tstop < tN) break;
+		do t_barrier += interval; while (t_barrier < tN);
+	}
+	run(tstop);
+	changeStructure(tstop);
+}
+
+template <class X, class T, class S>
+void ParSimulator<X,T,S>::run(T t_stop)
 {
-	#pragma omp parallel
+	if (executor != NULL)
+	{
+		executor->run(t_stop);
+		return;
+	}
+	#pragma omp parallel num_threads(lp_count)
 	{
-		lp[omp_get_thread_num()]->run(tstop);
+		lp[omp_get_thread_num()]->run(t_stop);
 	}
 }
 
-template <class X, class T>
-void ParSimulator<X,T>::init(Devs<X,T>* model)
+template <class X, class T, class S>
+void ParSimulator<X,T,S>::setLoadBalancing(T interval, double tolerance)
+{
+	this->interval = interval;
+	this->tolerance = tolerance;
+	// The first stop comes after the time that has been simulated
+	T tN = nextEventTime();
+	t_barrier = interval;
+	if (adevs_zero<T>() < interval && tN < adevs_inf<T>())
+	{
+		while (t_barrier < tN) t_barrier += interval;
+	}
+	for (int i = 0; i < lp_count; i++)
+	{
+		lp[i]->setProfiler((adevs_zero<T>() < interval) ? partitioner : NULL);
+		last_events[i] = lp[i]->getStats().events;
+	}
+	partitioner->clearProfile();
+}
+
+template <class X, class T, class S>
+void ParSimulator<X,T,S>::rebalance(T t)
+{
+	// Measure the load on each process since the last stop
+	unsigned long int total = 0, busiest = 0;
+	for (int i = 0; i < lp_count; i++)
+	{
+		unsigned long int load = lp[i]->getStats().events-last_events[i];
+		last_events[i] = lp[i]->getStats().events;
+		total += load;
+		busiest = std::max(busiest,load);
+	}
+	if ((double)(busiest*lp_count) <= (1.0+tolerance)*(double)total)
+	{
+		partitioner->clearProfile();
+		return;
+	}
+	// Assign the models again and move those that were reassigned
+	LpGraph g;
+	partitioner->repartition(lp_count,g);
+	partitioner->clearProfile();
+	std::vector<Atomic<X,T>*> models;
+	std::vector<Message<X,T> > msgs;
+	for (int i = 0; i < lp_count; i++)
+		lp[i]->moveModelsOut(models,msgs);
+	for (unsigned i = 0; i < models.size(); i++)
+		lp[models[i]->getProc()]->moveModelIn(models[i]);
+	for (unsigned i = 0; i < msgs.size(); i++)
+		lp[msgs[i].target->getProc()]->moveMessageIn(msgs[i]);
+	for (int i = 0; i < lp_count; i++)
+		lp[i]->restart(t,g.getI(i),g.getE(i));
+	rebalances++;
+}
+
+template <class X, class T, class S>
+void ParSimulator<X,T,S>::changeStructure(T t)
+{
+	bool changed = false;
+	for (int i = 0; i < lp_count; i++)
+	{
+		if (lp[i]->takeModelTransitions(transitions))
+			changed = true;
+	}
+	if (transitions.empty())
+	{
+		// Find the models that the threads added and removed
+		if (changed) partitioner->rebuild(model);
+		return;
+	}
+	Bag<Devs<X,T>*> added, removed;
+	transitions.evaluate(added,removed);
+	partitioner->rebuild(model);
+	// Put the new models next to the models that they are coupled to
+	LpGraph g;
+	partitioner->place(lp_count,g);
+	// Take the removed models away from the threads
+	Set<Devs<X,T>*> gone;
+	typename Bag<Devs<X,T>*>::iterator iter;
+	for (iter = removed.begin(); iter != removed.end(); iter++)
+	{
+		gone.insert(*iter);
+		if ((*iter)->typeIsNetwork() != NULL)
+			ModelTransitions<X,T>::getAllChildren((*iter)->typeIsNetwork(),gone);
+	}
+	if (!gone.empty())
+	{
+		for (int i = 0; i < lp_count; i++)
+			lp[i]->removeModels(gone);
+	}
+	// Assign the new models. The components of a new network
+	// are in the bag too and are assigned with it.
+	Set<Devs<X,T>*> fresh;
+	for (iter = added.begin(); iter != added.end(); iter++)
+		fresh.insert(*iter);
+	for (iter = added.begin(); iter != added.end(); iter++)
+	{
+		if (fresh.find((*iter)->getParent()) == fresh.end())
+			init(*iter,t);
+	}
+	transitions.deleteModels(removed);
+	// Connect the threads as the new couplings require
+	for (int i = 0; i < lp_count; i++)
+		lp[i]->restart(t,g.getI(i),g.getE(i));
+}
+
+template <class X, class T, class S>
+void ParSimulator<X,T,S>::init(Devs<X,T>* model, T t)
 {
 	if (model->getProc() >= 0 && model->getProc() < lp_count)
 	{
-		lp[model->getProc()]->addModel(model);
+		lp[model->getProc()]->addModel(model,t);
 		return;
 	}
 	Atomic<X,T>* a = model->typeIsAtomic();
@@ -194,17 +422,12 @@ void ParSimulator<X,T>::init(Devs<X,T>* model)
 		if (lp_assign < 0 || lp_assign >= lp_count)
 			lp_assign =
 				((unsigned long int)(a)^(unsigned long int)(this))%lp_count;
-		lp[lp_assign]->addModel(a);
+		lp[lp_assign]->addModel(a,t);
 	}
 	else
 	{
-		Set<Devs<X,T>*> components;
-		model->typeIsNetwork()->getComponents(components);
-		typename Set<Devs<X,T>*>::iterator iter = components.begin();
-		for (; iter != components.end(); iter++)
-		{
-			init(*iter);
-		}
+		init_visitor visitor(this,t);
+		model->typeIsNetwork()->visitComponents(&visitor);
 	}
 }
 
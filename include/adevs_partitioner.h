@@ -0,0 +1,916 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_partitioner_h_
+#define __adevs_partitioner_h_
+#include "adevs_models.h"
+#include "adevs_event_listener.h"
+#include "adevs_lp_graph.h"
+#include <cassert>
+#include <vector>
+#include <map>
+#include <set>
+#include <queue>
+#include <utility>
+#include <algorithm>
+
+namespace adevs
+{
+
+/**
+ * <P>The Partitioner assigns the atomic models of a parallel simulation to
+ * processors so that the processors have about the same amount of work
+ * and models that are coupled tend to share a processor. The couplings
+ * are found with the visitCouplings method of each network. If a network
+ * can not list its couplings, then its components are treated as if they
+ * were all coupled to each other.</P>
+ * <P>Every atomic model and every coupling has a weight of one unless a
+ * profile is collected by adding the Partitioner as an EventListener to
+ * a Simulator for a short trial run of the model. In that case, the
+ * weight of a model grows with its number of state changes and the
+ * weight of its couplings with its number of outputs.</P>
+ * <P>The partition is computed with a multilevel algorithm. The graph
+ * is coarsened by merging the ends of its heaviest edges, the coarsest
+ * graph is partitioned by growing a region for each processor, and
+ * the partition is improved by moving models at the boundaries of the
+ * regions as the graph is taken back to its original size. Models that
+ * are assigned to a processor by setProc before the Partitioner is
+ * created, on their own or through a network that contains them, stay
+ * where they are.</P>
+ * <P>The repartition method moves models that are already assigned so
+ * that the work is balanced again. It is used by the ParSimulator to
+ * follow a load that moves through the model. The rebuild method finds
+ * the models and couplings again after the structure of the model has
+ * changed, and the place method then assigns the new models.</P>
+ */
+template <class X, class T = double> class Partitioner:
+	public EventListener<X,T>
+{
+	public:
+		/**
+		 * Find the atomic models and couplings of the model. The
+		 * structure of the model must not change before the partition
+		 * method is called.
+		 */
+		Partitioner(Devs<X,T>* model);
+		/// Counts the outputs of each atomic model
+		void outputEvent(Event<X,T> x, T t);
+		/// Counts the state changes of each atomic model
+		void stateChange(Atomic<X,T>* model, T t);
+		/**
+		 * Assign each atomic model that does not have a processor to one
+		 * of lp_count processors by calling its setProc method, and
+		 * replace g with a graph that has an edge from processor A to
+		 * processor B if a model on A can send input to a model on B.
+		 * If every model is already assigned, then this only builds
+		 * the graph, which can be given to the ParSimulator.
+		 */
+		void partition(int lp_count, LpGraph& g);
+		/**
+		 * Move the models that were free when the Partitioner was created
+		 * from the processors that they have now, by calling their
+		 * setProc method, so that the profile collected since the last
+		 * call to clearProfile is balanced. Only models at the boundaries
+		 * of the processors are moved, and only as far as they need to go.
+		 * The graph g is replaced as by the partition method.
+		 */
+		void repartition(int lp_count, LpGraph& g);
+		/**
+		 * Find the atomic models and couplings of the model again after
+		 * its structure has changed. The models that were found before
+		 * keep their profiles and are fixed or free as they were; new
+		 * models are fixed if they have a processor now. This must be
+		 * called before the removed models are deleted.
+		 */
+		void rebuild(Devs<X,T>* model);
+		/**
+		 * Assign each atomic model that does not have a processor without
+		 * moving the models that do. A model goes to the processor that it
+		 * has the heaviest couplings to, and a model that is not coupled
+		 * to an assigned model goes to the processor with the least work.
+		 * The graph g is replaced as by the partition method.
+		 */
+		void place(int lp_count, LpGraph& g);
+		/// Forget the profile and start a new one
+		void clearProfile();
+		/// Get the weight of the couplings between processors
+		long getCutWeight() const { return cut; }
+		/// Get the weight of the models assigned to processor p
+		long getLoad(int p) const { return load[p]; }
+		/// Destructor
+		~Partitioner(){}
+	private:
+		// A weighted, undirected graph in compressed form
+		struct wgraph
+		{
+			std::vector<long> vw;
+			std::vector<unsigned> xadj;
+			std::vector<int> adj;
+			std::vector<long> ew;
+			// The processor of a vertex that can not move, or -1
+			std::vector<int> fixed;
+			// The processor of each vertex if repartitioning, or empty
+			std::vector<int> home;
+			int size() const { return (int)vw.size(); }
+		};
+		// The atomic models are the first terminals of the routing graph.
+		// The other terminals are hubs that stand in for the networks
+		// whose couplings are unknown.
+		std::vector<Atomic<X,T>*> atomic;
+		std::map<Atomic<X,T>*,int> atomic_id;
+		std::vector<long> outputs, events;
+		// The networks, and the network that holds each model or -1
+		std::vector<Devs<X,T>*> nets;
+		std::vector<int> net_parent, atomic_parent, hub_net;
+		// The processor of each model when the Partitioner was created
+		std::vector<int> net_proc, atomic_proc;
+		// The routing graph has a vertex for each terminal and for the
+		// input and output of each network
+		std::vector<std::vector<int> > next;
+		std::vector<int> vertex_term, term_vertex;
+		std::map<Devs<X,T>*,int> in_v, out_v;
+		// The terminals that each terminal can send to
+		std::vector<std::vector<int> > targets;
+		std::vector<long> load;
+		long cut;
+		int add_vertex();
+		int add_model(Devs<X,T>* model, int parent);
+		int fixed_proc(int proc, int parent, int lp_count);
+		// Get the processor of each vertex as the models are now
+		void find_home(const wgraph& g0, std::vector<int>& home, int lp_count);
+		void find_targets();
+		// Build the graph of terminals and return its total weight
+		long build(int lp_count, wgraph& g0);
+		// Improve part or, if not repartitioning, create it
+		void solve(const wgraph& g0, std::vector<int>& part, int lp_count,
+			long total);
+		// Assign the free models and connect the processors
+		void assign(const wgraph& g0, const std::vector<int>& part,
+			int lp_count, LpGraph& g);
+		void coarsen(const wgraph& g, wgraph& c, std::vector<int>& cmap,
+			long max_vw);
+		void grow(const wgraph& g, std::vector<int>& part, int lp_count);
+		void refine(const wgraph& g, std::vector<int>& part, int lp_count,
+			long max_load);
+		class component_visitor:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				component_visitor(Partitioner<X,T>* p, int parent):
+					p(p),parent(parent){}
+				void visit(Devs<X,T>* model)
+				{
+					children.push_back(model);
+					p->add_model(model,parent);
+				}
+				std::vector<Devs<X,T>*> children;
+			private:
+				Partitioner<X,T>* p;
+				int parent;
+		};
+		class coupling_visitor:
+			public Network<X,T>::CouplingVisitor
+		{
+			public:
+				coupling_visitor(Partitioner<X,T>* p, Devs<X,T>* net):
+					p(p),net(net){}
+				void visit(Devs<X,T>* src, Devs<X,T>* dst)
+				{
+					// Input to the network enters at its input vertex and
+					// output from the network leaves at its output vertex
+					std::map<Devs<X,T>*,int>& from = (src == net) ? p->in_v : p->out_v;
+					std::map<Devs<X,T>*,int>& to = (dst == net) ? p->out_v : p->in_v;
+					typename std::map<Devs<X,T>*,int>::iterator a = from.find(src);
+					typename std::map<Devs<X,T>*,int>::iterator b = to.find(dst);
+					if (a != from.end() && b != to.end())
+						p->next[(*a).second].push_back((*b).second);
+				}
+			private:
+				Partitioner<X,T>* p;
+				Devs<X,T>* net;
+		};
+};
+
+template <class X, class T>
+Partitioner<X,T>::Partitioner(Devs<X,T>* model):
+	EventListener<X,T>(),
+	cut(0)
+{
+	add_model(model,-1);
+	find_targets();
+	outputs.assign(atomic.size(),0);
+	events.assign(atomic.size(),0);
+}
+
+template <class X, class T>
+void Partitioner<X,T>::outputEvent(Event<X,T> x, T)
+{
+	typename std::map<Atomic<X,T>*,int>::iterator iter =
+		atomic_id.find(x.model->typeIsAtomic());
+	if (iter != atomic_id.end()) outputs[(*iter).second]++;
+}
+
+template <class X, class T>
+void Partitioner<X,T>::stateChange(Atomic<X,T>* model, T)
+{
+	typename std::map<Atomic<X,T>*,int>::iterator iter =
+		atomic_id.find(model);
+	if (iter != atomic_id.end()) events[(*iter).second]++;
+}
+
+template <class X, class T>
+void Partitioner<X,T>::clearProfile()
+{
+	outputs.assign(atomic.size(),0);
+	events.assign(atomic.size(),0);
+}
+
+template <class X, class T>
+int Partitioner<X,T>::add_vertex()
+{
+	next.push_back(std::vector<int>());
+	vertex_term.push_back(-1);
+	return next.size()-1;
+}
+
+template <class X, class T>
+int Partitioner<X,T>::add_model(Devs<X,T>* model, int parent)
+{
+	Atomic<X,T>* a = model->typeIsAtomic();
+	if (a != NULL)
+	{
+		int v = add_vertex();
+		vertex_term[v] = atomic.size();
+		term_vertex.push_back(v);
+		atomic_id[a] = atomic.size();
+		atomic.push_back(a);
+		atomic_parent.push_back(parent);
+		atomic_proc.push_back(a->getProc());
+		in_v[model] = out_v[model] = v;
+		return v;
+	}
+	int id = nets.size();
+	nets.push_back(model);
+	net_parent.push_back(parent);
+	net_proc.push_back(model->getProc());
+	int in = add_vertex(), out = add_vertex();
+	in_v[model] = in;
+	out_v[model] = out;
+	Network<X,T>* n = model->typeIsNetwork();
+	component_visitor components(this,id);
+	n->visitComponents(&components);
+	coupling_visitor couplings(this,model);
+	if (!n->visitCouplings(&couplings))
+	{
+		// Anything can reach anything through the hub. Hubs are
+		// numbered after the atomic models when the search is done.
+		int hub = add_vertex();
+		vertex_term[hub] = -2-(int)hub_net.size();
+		hub_net.push_back(id);
+		next[in].push_back(hub);
+		next[hub].push_back(out);
+		for (unsigned i = 0; i < components.children.size(); i++)
+		{
+			next[out_v[components.children[i]]].push_back(hub);
+			next[hub].push_back(in_v[components.children[i]]);
+		}
+	}
+	return in;
+}
+
+template <class X, class T>
+void Partitioner<X,T>::find_targets()
+{
+	// Number the hubs
+	std::vector<int> hub_vertex(hub_net.size());
+	for (unsigned v = 0; v < next.size(); v++)
+	{
+		if (vertex_term[v] < -1)
+			hub_vertex[-2-vertex_term[v]] = v;
+	}
+	for (unsigned h = 0; h < hub_vertex.size(); h++)
+	{
+		vertex_term[hub_vertex[h]] = term_vertex.size();
+		term_vertex.push_back(hub_vertex[h]);
+	}
+	// Follow the couplings from each terminal until they reach
+	// other terminals
+	targets.resize(term_vertex.size());
+	std::vector<unsigned> visited(next.size(),0);
+	std::vector<int> stack;
+	for (unsigned t = 0; t < term_vertex.size(); t++)
+	{
+		unsigned mark = t+1;
+		stack.push_back(term_vertex[t]);
+		visited[term_vertex[t]] = mark;
+		while (!stack.empty())
+		{
+			int v = stack.back();
+			stack.pop_back();
+			for (unsigned i = 0; i < next[v].size(); i++)
+			{
+				int u = next[v][i];
+				if (visited[u] == mark) continue;
+				visited[u] = mark;
+				if (vertex_term[u] >= 0) targets[t].push_back(vertex_term[u]);
+				else stack.push_back(u);
+			}
+		}
+	}
+}
+
+template <class X, class T>
+int Partitioner<X,T>::fixed_proc(int proc, int parent, int lp_count)
+{
+	// The outermost assignment is used, as in the ParSimulator
+	if (proc < 0 || proc >= lp_count) proc = -1;
+	for (; parent >= 0; parent = net_parent[parent])
+	{
+		if (net_proc[parent] >= 0 && net_proc[parent] < lp_count)
+			proc = net_proc[parent];
+	}
+	return proc;
+}
+
+template <class X, class T>
+void Partitioner<X,T>::partition(int lp_count, LpGraph& g)
+{
+	if (lp_count < 1) lp_count = 1;
+	wgraph g0;
+	long total = build(lp_count,g0);
+	std::vector<int> part(g0.size(),0);
+	if (lp_count > 1 && g0.size() > 0)
+		solve(g0,part,lp_count,total);
+	assign(g0,part,lp_count,g);
+}
+
+template <class X, class T>
+void Partitioner<X,T>::repartition(int lp_count, LpGraph& g)
+{
+	if (lp_count < 1) lp_count = 1;
+	wgraph g0;
+	long total = build(lp_count,g0);
+	// Start from where the models are now
+	find_home(g0,g0.home,lp_count);
+	std::vector<int> part(g0.home);
+	if (lp_count > 1 && g0.size() > 0)
+		solve(g0,part,lp_count,total);
+	assign(g0,part,lp_count,g);
+}
+
+template <class X, class T>
+void Partitioner<X,T>::place(int lp_count, LpGraph& g)
+{
+	if (lp_count < 1) lp_count = 1;
+	wgraph g0;
+	build(lp_count,g0);
+	int nt = g0.size(), na = atomic.size(), seed = 0;
+	// The models that have a processor stay on it
+	std::vector<int> part(nt,-1);
+	std::vector<long> pload(lp_count,0), conn(lp_count);
+	std::queue<int> q;
+	for (int v = 0; v < nt; v++)
+	{
+		if (g0.fixed[v] >= 0)
+			part[v] = g0.fixed[v];
+		else if (v < na && atomic[v]->getProc() >= 0 &&
+				atomic[v]->getProc() < lp_count)
+			part[v] = atomic[v]->getProc();
+		if (part[v] >= 0)
+		{
+			pload[part[v]] += g0.vw[v];
+			q.push(v);
+		}
+	}
+	// Spread out from the placed models. Each new model is placed when
+	// it is first reached, next to the placed models it is coupled to.
+	for (;;)
+	{
+		if (q.empty())
+		{
+			while (seed < nt && part[seed] != -1) seed++;
+			if (seed == nt) break;
+			part[seed] = std::min_element(pload.begin(),pload.end())-pload.begin();
+			pload[part[seed]] += g0.vw[seed];
+			q.push(seed);
+		}
+		int v = q.front();
+		q.pop();
+		for (unsigned j = g0.xadj[v]; j < g0.xadj[v+1]; j++)
+		{
+			int u = g0.adj[j], best = 0;
+			if (part[u] != -1) continue;
+			conn.assign(lp_count,0);
+			for (unsigned k = g0.xadj[u]; k < g0.xadj[u+1]; k++)
+			{
+				if (part[g0.adj[k]] >= 0)
+					conn[part[g0.adj[k]]] += g0.ew[k];
+			}
+			for (int p = 1; p < lp_count; p++)
+			{
+				if (conn[p] > conn[best] ||
+					(conn[p] == conn[best] && pload[p] < pload[best]))
+					best = p;
+			}
+			part[u] = best;
+			pload[best] += g0.vw[u];
+			q.push(u);
+		}
+	}
+	assign(g0,part,lp_count,g);
+}
+
+template <class X, class T>
+void Partitioner<X,T>::find_home(const wgraph& g0, std::vector<int>& home,
+	int lp_count)
+{
+	int nt = g0.size(), na = atomic.size();
+	// A hub that is free to move goes with one of its neighbors
+	home.assign(nt,0);
+	for (int v = 0; v < nt; v++)
+	{
+		if (g0.fixed[v] >= 0)
+			home[v] = g0.fixed[v];
+		else if (v < na)
+		{
+			int p = atomic[v]->getProc();
+			home[v] = (p >= 0 && p < lp_count) ? p : 0;
+		}
+	}
+	for (int v = na; v < nt; v++)
+	{
+		if (g0.fixed[v] < 0 && g0.xadj[v] < g0.xadj[v+1])
+			home[v] = home[g0.adj[g0.xadj[v]]];
+	}
+}
+
+template <class X, class T>
+void Partitioner<X,T>::rebuild(Devs<X,T>* model)
+{
+	// Remember what is known about the models that were found before
+	std::map<Devs<X,T>*,int> old_proc;
+	std::map<Atomic<X,T>*,std::pair<long,long> > old_profile;
+	for (unsigned i = 0; i < atomic.size(); i++)
+	{
+		old_proc[atomic[i]] = atomic_proc[i];
+		old_profile[atomic[i]] = std::make_pair(events[i],outputs[i]);
+	}
+	for (unsigned i = 0; i < nets.size(); i++)
+		old_proc[nets[i]] = net_proc[i];
+	// Find the models and couplings again
+	atomic.clear();
+	atomic_id.clear();
+	nets.clear();
+	net_parent.clear();
+	atomic_parent.clear();
+	hub_net.clear();
+	net_proc.clear();
+	atomic_proc.clear();
+	next.clear();
+	vertex_term.clear();
+	term_vertex.clear();
+	in_v.clear();
+	out_v.clear();
+	targets.clear();
+	add_model(model,-1);
+	find_targets();
+	outputs.assign(atomic.size(),0);
+	events.assign(atomic.size(),0);
+	typename std::map<Devs<X,T>*,int>::iterator p;
+	for (unsigned i = 0; i < atomic.size(); i++)
+	{
+		if ((p = old_proc.find(atomic[i])) != old_proc.end())
+		{
+			atomic_proc[i] = (*p).second;
+			events[i] = old_profile[atomic[i]].first;
+			outputs[i] = old_profile[atomic[i]].second;
+		}
+	}
+	for (unsigned i = 0; i < nets.size(); i++)
+	{
+		if ((p = old_proc.find(nets[i])) != old_proc.end())
+			net_proc[i] = (*p).second;
+	}
+}
+
+template <class X, class T>
+long Partitioner<X,T>::build(int lp_count, wgraph& g0)
+{
+	int nt = term_vertex.size(), na = atomic.size();
+	g0.vw.resize(nt);
+	g0.fixed.resize(nt);
+	long total = 0;
+	for (int t = 0; t < nt; t++)
+	{
+		if (t < na)
+		{
+			g0.vw[t] = 1+events[t];
+			g0.fixed[t] = fixed_proc(atomic_proc[t],atomic_parent[t],lp_count);
+		}
+		else
+		{
+			int net = hub_net[t-na];
+			g0.vw[t] = 0;
+			g0.fixed[t] = fixed_proc(net_proc[net],net_parent[net],lp_count);
+		}
+		total += g0.vw[t];
+	}
+	std::vector<std::pair<std::pair<int,int>,long> > edges;
+	for (int s = 0; s < nt; s++)
+	{
+		long w = (s < na) ? 1+outputs[s] : 1;
+		for (unsigned i = 0; i < targets[s].size(); i++)
+		{
+			int t = targets[s][i];
+			if (t != s)
+				edges.push_back(std::make_pair(
+					std::make_pair(std::min(s,t),std::max(s,t)),w));
+		}
+	}
+	std::sort(edges.begin(),edges.end());
+	unsigned ne = 0;
+	for (unsigned i = 0; i < edges.size(); i++)
+	{
+		if (ne > 0 && edges[ne-1].first == edges[i].first)
+			edges[ne-1].second += edges[i].second;
+		else edges[ne++] = edges[i];
+	}
+	edges.resize(ne);
+	g0.xadj.assign(nt+1,0);
+	for (unsigned i = 0; i < ne; i++)
+	{
+		g0.xadj[edges[i].first.first+1]++;
+		g0.xadj[edges[i].first.second+1]++;
+	}
+	for (int v = 0; v < nt; v++)
+		g0.xadj[v+1] += g0.xadj[v];
+	g0.adj.resize(2*ne);
+	g0.ew.resize(2*ne);
+	std::vector<unsigned> pos(g0.xadj.begin(),g0.xadj.end()-1);
+	for (unsigned i = 0; i < ne; i++)
+	{
+		int a = edges[i].first.first, b = edges[i].first.second;
+		g0.adj[pos[a]] = b;
+		g0.ew[pos[a]++] = edges[i].second;
+		g0.adj[pos[b]] = a;
+		g0.ew[pos[b]++] = edges[i].second;
+	}
+	return total;
+}
+
+template <class X, class T>
+void Partitioner<X,T>::solve(const wgraph& g0, std::vector<int>& part,
+	int lp_count, long total)
+{
+	std::vector<wgraph> levels(1,g0);
+	std::vector<std::vector<int> > cmaps;
+	long max_vw = total/(4*lp_count)+1;
+	int small = std::max(8*lp_count,64);
+	while (levels.back().size() > small)
+	{
+		wgraph c;
+		std::vector<int> cmap;
+		coarsen(levels.back(),c,cmap,max_vw);
+		if (10*c.size() > 9*levels.back().size()) break;
+		levels.push_back(c);
+		cmaps.push_back(cmap);
+	}
+	long max_load = (105*total)/(100*lp_count)+1;
+	// When repartitioning, the coarse vertices stay with their
+	// processors and are moved from there
+	if (g0.home.empty()) grow(levels.back(),part,lp_count);
+	else part = levels.back().home;
+	refine(levels.back(),part,lp_count,max_load);
+	for (int k = (int)cmaps.size()-1; k >= 0; k--)
+	{
+		std::vector<int> fine(levels[k].size());
+		for (unsigned v = 0; v < fine.size(); v++)
+			fine[v] = part[cmaps[k][v]];
+		part.swap(fine);
+		refine(levels[k],part,lp_count,max_load);
+	}
+}
+
+template <class X, class T>
+void Partitioner<X,T>::assign(const wgraph& g0, const std::vector<int>& part,
+	int lp_count, LpGraph& g)
+{
+	int nt = g0.size(), na = atomic.size();
+	// Assign the models that are free to move
+	load.assign(lp_count,0);
+	cut = 0;
+	for (int v = 0; v < nt; v++)
+	{
+		load[part[v]] += g0.vw[v];
+		for (unsigned j = g0.xadj[v]; j < g0.xadj[v+1]; j++)
+		{
+			if (g0.adj[j] > v && part[g0.adj[j]] != part[v])
+				cut += g0.ew[j];
+		}
+	}
+	for (int i = 0; i < na; i++)
+	{
+		if (g0.fixed[i] < 0) atomic[i]->setProc(part[i]);
+	}
+	// Find the processors that can be reached through each hub
+	std::vector<std::set<int> > reach(nt-na);
+	std::vector<int> visited(nt,-1), stack;
+	for (int h = na; h < nt; h++)
+	{
+		stack.push_back(h);
+		visited[h] = h;
+		while (!stack.empty())
+		{
+			int s = stack.back();
+			stack.pop_back();
+			for (unsigned i = 0; i < targets[s].size(); i++)
+			{
+				int t = targets[s][i];
+				if (visited[t] == h) continue;
+				visited[t] = h;
+				if (t < na) reach[h-na].insert(part[t]);
+				else stack.push_back(t);
+			}
+		}
+	}
+	// Connect the processors
+	std::set<std::pair<int,int> > lp_edges;
+	for (int s = 0; s < na; s++)
+	{
+		for (unsigned i = 0; i < targets[s].size(); i++)
+		{
+			int t = targets[s][i];
+			if (t < na)
+			{
+				if (part[s] != part[t])
+					lp_edges.insert(std::make_pair(part[s],part[t]));
+				continue;
+			}
+			std::set<int>::iterator q = reach[t-na].begin();
+			for (; q != reach[t-na].end(); q++)
+			{
+				if (*q != part[s])
+					lp_edges.insert(std::make_pair(part[s],*q));
+			}
+		}
+	}
+	g = LpGraph(lp_count);
+	std::set<std::pair<int,int> >::iterator e = lp_edges.begin();
+	for (; e != lp_edges.end(); e++)
+		g.addEdge((*e).first,(*e).second);
+}
+
+template <class X, class T>
+void Partitioner<X,T>::coarsen(const wgraph& g, wgraph& c,
+	std::vector<int>& cmap, long max_vw)
+{
+	int n = g.size();
+	// Visit the vertices in a scrambled order so that the matching
+	// does not follow the order in which the models were found
+	std::vector<int> order(n);
+	for (int i = 0; i < n; i++) order[i] = i;
+	unsigned seed = 1;
+	for (int i = n-1; i > 0; i--)
+	{
+		seed = seed*1103515245+12345;
+		std::swap(order[i],order[((seed>>16)&0x7fff)%(i+1)]);
+	}
+	// Match each vertex to the neighbor with the heaviest edge
+	int cn = 0;
+	cmap.assign(n,-1);
+	for (int k = 0; k < n; k++)
+	{
+		int v = order[k], best = -1;
+		if (cmap[v] >= 0) continue;
+		long best_w = 0;
+		for (unsigned j = g.xadj[v]; j < g.xadj[v+1]; j++)
+		{
+			int u = g.adj[j];
+			if (cmap[u] >= 0 || g.vw[v]+g.vw[u] > max_vw) continue;
+			if (g.fixed[v] >= 0 && g.fixed[u] >= 0 && g.fixed[v] != g.fixed[u])
+				continue;
+			if (!g.home.empty() && g.home[v] != g.home[u])
+				continue;
+			if (best == -1 || g.ew[j] > best_w)
+			{
+				best = u;
+				best_w = g.ew[j];
+			}
+		}
+		cmap[v] = cn;
+		if (best >= 0) cmap[best] = cn;
+		cn++;
+	}
+	// Merge the matched vertices and their edges
+	c.vw.assign(cn,0);
+	c.fixed.assign(cn,-1);
+	if (!g.home.empty()) c.home.assign(cn,0);
+	std::vector<unsigned> start(cn+1,0);
+	for (int v = 0; v < n; v++)
+	{
+		c.vw[cmap[v]] += g.vw[v];
+		if (g.fixed[v] >= 0) c.fixed[cmap[v]] = g.fixed[v];
+		if (!g.home.empty()) c.home[cmap[v]] = g.home[v];
+		start[cmap[v]+1]++;
+	}
+	for (int i = 0; i < cn; i++) start[i+1] += start[i];
+	std::vector<int> members(n);
+	std::vector<unsigned> fill(start.begin(),start.end()-1);
+	for (int v = 0; v < n; v++) members[fill[cmap[v]]++] = v;
+	std::vector<int> where(cn,-1);
+	c.xadj.assign(1,0);
+	c.adj.clear();
+	c.ew.clear();
+	for (int cv = 0; cv < cn; cv++)
+	{
+		for (unsigned m = start[cv]; m < start[cv+1]; m++)
+		{
+			int v = members[m];
+			for (unsigned j = g.xadj[v]; j < g.xadj[v+1]; j++)
+			{
+				int cu = cmap[g.adj[j]];
+				if (cu == cv) continue;
+				if (where[cu] >= (int)c.xadj[cv])
+					c.ew[where[cu]] += g.ew[j];
+				else
+				{
+					where[cu] = c.adj.size();
+					c.adj.push_back(cu);
+					c.ew.push_back(g.ew[j]);
+				}
+			}
+		}
+		c.xadj.push_back(c.adj.size());
+	}
+}
+
+template <class X, class T>
+void Partitioner<X,T>::grow(const wgraph& g, std::vector<int>& part,
+	int lp_count)
+{
+	int n = g.size(), seed = 0;
+	long total = 0;
+	std::vector<long> pload(lp_count,0), conn(n,0), deg(n,0);
+	std::vector<int> touched;
+	part.assign(n,-1);
+	for (int v = 0; v < n; v++)
+	{
+		for (unsigned j = g.xadj[v]; j < g.xadj[v+1]; j++)
+			deg[v] += g.ew[j];
+		total += g.vw[v];
+		if (g.fixed[v] >= 0)
+		{
+			part[v] = g.fixed[v];
+			pload[part[v]] += g.vw[v];
+		}
+	}
+	long target = (total+lp_count-1)/lp_count;
+	for (int p = 0; p < lp_count-1; p++)
+	{
+		// Grow the region around the models that are already in it. The
+		// next model is the one that adds the least to the cut, and of
+		// those the one that has waited the longest.
+		std::priority_queue<std::pair<std::pair<long,long>,int> > q;
+		long stamp = 0;
+		for (int v = 0; v < n; v++)
+		{
+			if (part[v] != p) continue;
+			for (unsigned j = g.xadj[v]; j < g.xadj[v+1]; j++)
+			{
+				int u = g.adj[j];
+				if (part[u] != -1) continue;
+				if (conn[u] == 0) touched.push_back(u);
+				conn[u] += g.ew[j];
+				q.push(std::make_pair(std::make_pair(2*conn[u]-deg[u],stamp--),u));
+			}
+		}
+		while (pload[p] < target)
+		{
+			int v = -1;
+			while (v == -1 && !q.empty())
+			{
+				int u = q.top().second;
+				if (part[u] == -1 && 2*conn[u]-deg[u] == q.top().first.first)
+					v = u;
+				q.pop();
+			}
+			// Start a new region if this one can not grow
+			if (v == -1)
+			{
+				while (seed < n && part[seed] != -1) seed++;
+				if (seed == n) break;
+				v = seed;
+			}
+			part[v] = p;
+			pload[p] += g.vw[v];
+			for (unsigned j = g.xadj[v]; j < g.xadj[v+1]; j++)
+			{
+				int u = g.adj[j];
+				if (part[u] != -1) continue;
+				if (conn[u] == 0) touched.push_back(u);
+				conn[u] += g.ew[j];
+				q.push(std::make_pair(std::make_pair(2*conn[u]-deg[u],stamp--),u));
+			}
+		}
+		for (unsigned i = 0; i < touched.size(); i++)
+			conn[touched[i]] = 0;
+		touched.clear();
+	}
+	// The last processor gets what is left
+	for (int v = 0; v < n; v++)
+	{
+		if (part[v] == -1) part[v] = lp_count-1;
+	}
+}
+
+template <class X, class T>
+void Partitioner<X,T>::refine(const wgraph& g, std::vector<int>& part,
+	int lp_count, long max_load)
+{
+	int n = g.size();
+	std::vector<long> pload(lp_count,0), conn(lp_count,0);
+	std::vector<int> touched;
+	for (int v = 0; v < n; v++)
+		pload[part[v]] += g.vw[v];
+	for (int pass = 0; pass < 8; pass++)
+	{
+		bool moved = false;
+		for (int v = 0; v < n; v++)
+		{
+			if (g.fixed[v] >= 0) continue;
+			int from = part[v], to = -1;
+			for (unsigned j = g.xadj[v]; j < g.xadj[v+1]; j++)
+			{
+				int q = part[g.adj[j]];
+				if (conn[q] == 0) touched.push_back(q);
+				conn[q] += g.ew[j];
+			}
+			// Find the neighboring processor that gains the most
+			long gain = 0;
+			for (unsigned i = 0; i < touched.size(); i++)
+			{
+				int q = touched[i];
+				if (q == from || pload[q]+g.vw[v] > max_load) continue;
+				long dg = conn[q]-conn[from];
+				if (to == -1 || dg > gain || (dg == gain && pload[q] < pload[to]))
+				{
+					to = q;
+					gain = dg;
+				}
+			}
+			for (unsigned i = 0; i < touched.size(); i++)
+				conn[touched[i]] = 0;
+			touched.clear();
+			// Move to reduce the cut, to improve the balance without
+			// increasing the cut, or to leave a processor that is
+			// overloaded
+			bool over = pload[from] > max_load;
+			bool move = (to != -1 && (gain > 0 || over ||
+				(gain == 0 && g.vw[v] > 0 && pload[to]+g.vw[v] < pload[from])));
+			if (!move && over)
+			{
+				to = std::min_element(pload.begin(),pload.end())-pload.begin();
+				move = (pload[to]+g.vw[v] < pload[from]);
+			}
+			if (move)
+			{
+				part[v] = to;
+				pload[from] -= g.vw[v];
+				pload[to] += g.vw[v];
+				moved = true;
+			}
+		}
+		if (!moved) break;
+	}
+}
+
+} // end of namespace
+
+#endif
@@ -32,8 +32,10 @@
 #define __adevs_schedule_h_
 #include "adevs_time.h"
 #include "adevs_models.h"
+#include "adevs_bag.h"
 #include <cfloat>
 #include <cstdlib>
+#include <vector>
 using namespace std;
 
 namespace adevs
@@ -70,13 +72,27 @@ template <class X, class T = double> class Schedule
 		/// Get the time of the next event.
 		T minPriority() const { return heap[1].priority; }
 		/// Visit the imminent models.
-		void visitImminent(ImminentVisitor* visitor) const {
-			visitImminent(visitor,1);
-		}
+		void visitImminent(ImminentVisitor* visitor) const;
+		/**
+		 * Append the imminent models to the bag. This does the same
+		 * thing as visitImminent, but without a virtual call for each
+		 * model, and leaves the imminent set in a contiguous block of
+		 * memory that can be processed in bulk.
+		 */
+		void getImminent(Bag<Atomic<X,T>*>& imm) const;
 		/// Remove the model at the front of the queue.
 		void removeMinimum();
 		/// Add, remove, or move a model as required by its priority.
 		void schedule(Atomic<X,T>* model, T priority);
+		/**
+		 * Schedule many models at once. This has the same effect as
+		 * calling schedule(models[i],priority[i]) for each i, but models
+		 * that are not yet in the schedule are put at the end of the heap and
+		 * then the heap is rebuilt in linear time. If only a few models
+		 * are added to a large heap, then they are percolated up instead.
+		 */
+		void scheduleAll(const std::vector<Atomic<X,T>*>& models,
+			const std::vector<T>& priority);
 		/// Returns true if the queue is empty, and false otherwise.
 		bool empty() const { return size == 0; }
 		/// Get the number of elements in the heap.
@@ -95,28 +111,49 @@ template <class X, class T = double> class Schedule
 		};
 		unsigned int capacity, size;
 		heap_element* heap;
-		/// Double the schedule capacity
-		void enlarge();
+		/// Double the schedule capacity, or more to reach min_capacity
+		void enlarge(unsigned int min_capacity = 0);
 		/// Move the item at index down and return its new position
 		unsigned int percolate_down(unsigned int index, T priority);
 		/// Move the item at index up and return its new position
 		unsigned int percolate_up(unsigned int index, T priority);
-		/// Visit the imminent set recursively
-		void visitImminent(ImminentVisitor* visitor, unsigned int root) const;
+		// Work list of heap indices used to find the imminent models
+		mutable std::vector<unsigned int> imm_stack;
+		// Buffer used to visit the imminent models
+		mutable Bag<Atomic<X,T>*> imm_buf;
 };
 
 template <class X, class T>
-void Schedule<X,T>::visitImminent(typename Schedule<X,T>::ImminentVisitor* visitor,
-		unsigned int root) const
+void Schedule<X,T>::getImminent(Bag<Atomic<X,T>*>& imm) const
+{
+	if (size == 0) return;
+	// The imminent models form a subtree at the top of the heap. Walk
+	// it in pre-order with an explicit stack of indices.
+	imm_stack.push_back(1);
+	while (!imm_stack.empty())
+	{
+		unsigned int root = imm_stack.back();
+		imm_stack.pop_back();
+		imm.insert(heap[root].item);
+		// Look for more imminent models in the right and left sub-trees.
+		// The left is pushed last so that it is visited first.
+		unsigned int child = root*2+1;
+		if (child <= size && !(heap[1].priority < heap[child].priority))
+			imm_stack.push_back(child);
+		child--;
+		if (child <= size && !(heap[1].priority < heap[child].priority))
+			imm_stack.push_back(child);
+	}
+}
+
+template <class X, class T>
+void Schedule<X,T>::visitImminent(typename Schedule<X,T>::ImminentVisitor* visitor) const
 {
-	// Stop if the bottom is reached or the next priority is not equal to the minimum
-	if (root > size || heap[1].priority < heap[root].priority)
-		return;
-	visitor->visit(heap[root].item);
-	// Look for more imminent models in the left sub-tree
-	visitImminent(visitor,root*2);
-	// Look in the right sub-tree
-	visitImminent(visitor,root*2+1);
+	getImminent(imm_buf);
+	typename Bag<Atomic<X,T>*>::iterator iter = imm_buf.begin();
+	for (; iter != imm_buf.end(); iter++)
+		visitor->visit(*iter);
+	imm_buf.clear();
 }
 
 template <class X, class T>
@@ -187,6 +224,82 @@ void Schedule<X,T>::schedule(Atomic<X,T>* model, T priority)
 	// Otherwise, the model is not enqueued and has no next event
 }
 
+template <class X, class T>
+void Schedule<X,T>::scheduleAll(const std::vector<Atomic<X,T>*>& models,
+	const std::vector<T>& priority)
+{
+	unsigned int i, old_size = size;
+	// Models that were already in the heap are rescheduled at the end
+	std::vector<unsigned int> old;
+	if (size+models.size() >= capacity)
+		enlarge(size+models.size()+1);
+	// Put the other models at the end of the heap
+	for (i = 0; i < models.size(); i++)
+	{
+		Atomic<X,T>* model = models[i];
+		if (model->q_index != 0 && model->q_index <= old_size)
+			old.push_back(i);
+		// A model listed more than once is already at the end
+		else if (model->q_index != 0)
+		{
+			if (priority[i] < adevs_inf<T>())
+				heap[model->q_index].priority = priority[i];
+			else
+			{
+				heap[model->q_index] = heap[size];
+				heap[model->q_index].item->q_index = model->q_index;
+				heap[size].item = NULL;
+				heap[size].priority = adevs_inf<T>();
+				model->q_index = 0;
+				size--;
+			}
+		}
+		else if (priority[i] < adevs_inf<T>())
+		{
+			size++;
+			if (size == capacity) enlarge();
+			heap[size].item = model;
+			heap[size].priority = priority[i];
+			model->q_index = size;
+		}
+	}
+	// If there are more new models than old, rebuild the whole heap
+	// from the bottom up. Otherwise insert the new models one by one.
+	if (size-old_size > old_size)
+	{
+		// The q_index values are fixed up after the heap is built
+		for (i = size/2; i > 0; i--)
+		{
+			heap_element e = heap[i];
+			unsigned int k = i, child;
+			for (; k*2 <= size; k = child)
+			{
+				child = k*2;
+				if (child != size && heap[child+1].priority < heap[child].priority)
+					child++;
+				if (heap[child].priority < e.priority)
+					heap[k] = heap[child];
+				else break;
+			}
+			heap[k] = e;
+		}
+		for (i = 1; i <= size; i++)
+			heap[i].item->q_index = i;
+	}
+	else
+	{
+		for (i = old_size+1; i <= size; i++)
+		{
+			heap_element e = heap[i];
+			unsigned int k = percolate_up(i,e.priority);
+			heap[k] = e;
+			e.item->q_index = k;
+		}
+	}
+	for (i = 0; i < old.size(); i++)
+		schedule(models[old[i]],priority[old[i]]);
+}
+
 template <class X, class T>
 unsigned int Schedule<X,T>::percolate_down(unsigned int index, T priority)
 {
@@ -223,12 +336,15 @@ unsigned int Schedule<X,T>::percolate_up(unsigned int index, T priority)
 }
 
 template <class X, class T>
-void Schedule<X,T>::enlarge()
+void Schedule<X,T>::enlarge(unsigned int min_capacity)
 {
-	heap_element* rheap = new heap_element[capacity*2];
+	unsigned int new_capacity = capacity*2;
+	if (new_capacity < min_capacity)
+		new_capacity = min_capacity;
+	heap_element* rheap = new heap_element[new_capacity];
 	for (unsigned int i = 0; i < capacity; i++)
 		rheap[i] = heap[i];
-	capacity *= 2;
+	capacity = new_capacity;
 	delete [] heap;
 	heap = rheap;
 }
@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_shared_value_h_
+#define __adevs_shared_value_h_
+#include <cstdlib>
+#if !defined(__GNUC__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace adevs
+{
+
+/*
+ * Thread safe increment and decrement of a reference count. These
+ * return the new value of the count.
+ */
+#if defined(__GNUC__)
+inline long shared_value_incr(volatile long* count) { return __sync_add_and_fetch(count,1); }
+inline long shared_value_decr(volatile long* count) { return __sync_sub_and_fetch(count,1); }
+#elif defined(_MSC_VER)
+inline long shared_value_incr(volatile long* count) { return _InterlockedIncrement(count); }
+inline long shared_value_decr(volatile long* count) { return _InterlockedDecrement(count); }
+#else
+inline long shared_value_incr(volatile long* count)
+{
+	long result;
+	#pragma omp critical(adevs_shared_value)
+	result = ++(*count);
+	return result;
+}
+inline long shared_value_decr(volatile long* count)
+{
+	long result;
+	#pragma omp critical(adevs_shared_value)
+	result = --(*count);
+	return result;
+}
+#endif
+
+/**
+ * <P>A shared_value holds an immutable object that is shared by all
+ * copies of the shared_value. The object is created once, when
+ * the first shared_value is constructed, and deleted when the last copy is
+ * destroyed. Copying a shared_value only updates a reference count, and
+ * so a large value that is sent to many models, or from one thread to
+ * another, is never copied. A fan-out to any number of receivers costs
+ * one allocation.</P>
+ * <P>The reference count is updated atomically, and so copies of a
+ * shared_value may be made and destroyed in different threads. This
+ * allows shared values to be passed between the threads of a ParSimulator
+ * using the default NullMessageManager, and output bags that hold them
+ * need no gc_output.</P>
+ * <P>Use it as the I/O type of a model, or as the value in a PortValue,
+ * like PortValue<shared_value<Packet> >.</P>
+ */
+template <class T> class shared_value
+{
+	public:
+		/// Create a shared_value that holds nothing.
+		shared_value():
+			rep(NULL)
+		{
+		}
+		/// Create a shared object that is a copy of value.
+		explicit shared_value(const T& value):
+			rep(new shared_rep(value))
+		{
+		}
+		/// Share the object held by src.
+		shared_value(const shared_value<T>& src):
+			rep(src.rep)
+		{
+			if (rep != NULL) shared_value_incr(&(rep->refs));
+		}
+		/// Share the object held by src.
+		const shared_value<T>& operator=(const shared_value<T>& src)
+		{
+			if (src.rep != rep)
+			{
+				if (src.rep != NULL) shared_value_incr(&(src.rep->refs));
+				release();
+				rep = src.rep;
+			}
+			return *this;
+		}
+		/// Get the shared object. This must not be called if isNull().
+		const T& get() const { return rep->value; }
+		/// Get the shared object. This must not be called if isNull().
+		const T& operator*() const { return rep->value; }
+		/// Access the shared object. This must not be called if isNull().
+		const T* operator->() const { return &(rep->value); }
+		/// Returns true if there is no shared object.
+		bool isNull() const { return rep == NULL; }
+		/// Number of shared_values holding the object, or zero if isNull().
+		long useCount() const { return (rep == NULL) ? 0 : rep->refs; }
+		/// Share nothing.
+		void reset() { release(); rep = NULL; }
+		/// Destructor deletes the object if this is the last copy.
+		~shared_value() { release(); }
+	private:
+		// The object and its reference count are allocated together
+		struct shared_rep
+		{
+			shared_rep(const T& value):refs(1),value(value){}
+			volatile long refs;
+			const T value;
+		};
+		shared_rep* rep;
+		void release()
+		{
+			if (rep != NULL && shared_value_decr(&(rep->refs)) == 0)
+				delete rep;
+		}
+};
+
+} // end of namespace
+
+#endif
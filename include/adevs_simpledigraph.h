@@ -41,7 +41,9 @@ namespace adevs
 /**
  * This is a very simple digraph model for connecting single input/single
  * output systems. Output generated by a component model is sent to all
- * components connected to it.
+ * components connected to it. The routes of a SimpleDigraph are static (see
+ * Network::routesAreStatic()), and the couple method tells the Simulator
+ * to recompile them, and so the couplings may be changed at any time.
  */
 template <class VALUE, class T = double> class SimpleDigraph: 
 public Network<VALUE,T>
@@ -61,9 +63,15 @@ public Network<VALUE,T>
 		void couple(Component* src, Component* dst);
 		/// Puts the network's set of components into c
 		void getComponents(Set<Component*>& c);
+		/// Visit the network's components without copying them
+		void visitComponents(typename Network<VALUE,T>::ComponentVisitor* visitor);
 		/// Route an event according to the network's couplings
 		void route(const VALUE& x, Component* model, 
 		Bag<Event<VALUE,T> >& r);
+		/// The targets depend only on the model.
+		bool routesAreStatic() const { return true; }
+		/// Visit the source and target of every coupling
+		bool visitCouplings(typename Network<VALUE,T>::CouplingVisitor* visitor);
 		/// Destructor.  Destroys all of the component models.
 		~SimpleDigraph();
 
@@ -88,6 +96,7 @@ void SimpleDigraph<VALUE,T>::couple(Component* src, Component* dst)
 	if (src != this) add(src);
 	if (dst != this) add(dst);
 	graph[src].insert(dst);
+	this->couplingsChanged();
 }
 
 template <class VALUE, class T>
@@ -96,6 +105,29 @@ void SimpleDigraph<VALUE,T>::getComponents(Set<Component*>& c)
 	c = models;
 }
 
+template <class VALUE, class T>
+void SimpleDigraph<VALUE,T>::visitComponents(
+	typename Network<VALUE,T>::ComponentVisitor* visitor)
+{
+	typename Set<Component*>::iterator iter = models.begin();
+	for (; iter != models.end(); iter++)
+		visitor->visit(*iter);
+}
+
+template <class VALUE, class T>
+bool SimpleDigraph<VALUE,T>::visitCouplings(
+	typename Network<VALUE,T>::CouplingVisitor* visitor)
+{
+	typename std::map<Component*,Bag<Component*> >::iterator iter;
+	for (iter = graph.begin(); iter != graph.end(); iter++)
+	{
+		typename Bag<Component*>::iterator dst = (*iter).second.begin();
+		for (; dst != (*iter).second.end(); dst++)
+			visitor->visit((*iter).first,*dst);
+	}
+	return true;
+}
+
 template <class VALUE, class T>
 void SimpleDigraph<VALUE,T>::
 route(const VALUE& x, Component* model, 
@@ -37,7 +37,11 @@
 #include "adevs_bag.h"
 #include "adevs_set.h"
 #include "object_pool.h"
+#include "adevs_model_transitions.h"
 #include "adevs_lp.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
@@ -50,24 +54,34 @@ namespace adevs
  * This Simulator class implements the DEVS simulation algorithm.
  * Its methods throw adevs::exception objects if any of the DEVS model
  * constraints are violated (i.e., a negative time advance or a model
- * attempting to send an input directly to itself).
+ * attempting to send an input directly to itself). The optional template
+ * argument S selects the event schedule. This is the binary heap
+ * Schedule by default. The CalendarSchedule may be used instead for 
+ * models with very many components whose events are clustered in time.
  */
-template <class X, class T = double> class Simulator:
-	public AbstractSimulator<X,T>,
-	private Schedule<X,T>::ImminentVisitor
+template <class X, class T = double, class S = Schedule<X,T> > class Simulator:
+	public AbstractSimulator<X,T>
 {
 	public:
 		/**
 		 * Create a simulator for a model. The simulator
 		 * constructor will fail and throw an adevs::exception if the
 		 * time advance of any component atomic model is less than zero.
+		 * The atomic models are gathered first and then put into the
+		 * schedule all at once.
 		 * @param model The model to simulate
+		 * @param parallel If true, this is the same as calling 
+		 * setParallel(true) and the initial time advances are
+		 * also computed in parallel
 		 */
-		Simulator(Devs<X,T>* model):
+		Simulator(Devs<X,T>* model, bool parallel = false):
 			AbstractSimulator<X,T>(),
-			Schedule<X,T>::ImminentVisitor(),
-			lps(NULL)
+			lps(NULL),
+			route_gen(0),
+			coupling_gen(Network<X,T>::getCouplingGeneration()),
+			pars(NULL)
 		{
+			setParallel(parallel);
 			schedule(model,adevs_zero<T>());
 		}
 		/**
@@ -115,17 +129,55 @@ template <class X, class T = double> class Simulator:
 		~Simulator();
 		/**
 		 * Assign a model to the simulator. This has the same effect as passing
-		 * the model to the constructor.
+		 * the model to the constructor, except that the model's last event
+		 * is at t.
 		 */
-		void addModel(Atomic<X,T>* model) 
+		void addModel(Atomic<X,T>* model, T t = adevs_zero<T>()) 
 		{
-			schedule(model,adevs_zero<T>());
+			invalidate_routes();
+			schedule(model,t);
+		}
+		/**
+		 * Take a model away from the simulator without changing it, so
+		 * that it can be given to another simulator with moveModelIn.
+		 * The model must not be imminent or activated. This method is
+		 * used by the parallel simulator to move models between threads.
+		 */
+		void moveModelOut(Atomic<X,T>* model)
+		{
+			assert(model->x == NULL && model->y == NULL);
+			unschedule_model(model);
+		}
+		/**
+		 * Assign a model that was taken from another simulator with
+		 * moveModelOut. Its time of last event is kept, and so its next
+		 * event time is its last event time plus its time advance.
+		 */
+		void moveModelIn(Atomic<X,T>* model)
+		{
+			invalidate_routes();
+			schedule(model,model->tL,model->ta());
 		}
 		/**
 		 * Create a simulator that will be used by an LP as part of a parallel
 		 * simulation. This method is used by the parallel simulator.
 		 */
-		Simulator(LogicalProcess<X,T>* lp);
+		Simulator(AbstractLogicalProcess<X,T>* lp);
+		/**
+		 * Evaluate the output, state transition, model transition, and
+		 * time advance functions of the imminent and activated models
+		 * in parallel using OpenMP threads. Without OpenMP these functions
+		 * are evaluated by the calling thread as usual. The functions
+		 * of different atomic models may be called concurrently, and so
+		 * they must not share data unless the modeler protects it. Output
+		 * events are also routed in parallel, and so the route methods of
+		 * the network models must be safe to call concurrently. Listeners
+		 * are notified by the calling thread, and in the same order,
+		 * as in the sequential simulation. This is ignored by a simulator
+		 * that supports a logical process.
+		 * @param flag True to evaluate in parallel, false otherwise
+		 */
+		void setParallel(bool flag);
 		/**
 		 * <P>Call this method to indicate that all subsequent calls are part
 		 * of a lookahead calculation. Lookahead calculations will cause
@@ -135,7 +187,8 @@ template <class X, class T = double> class Simulator:
 		 * <P>Lookahead calculations are done with the lookNextEvent method,
 		 * which may throw a lookahead_impossible_exception. This occurs when
 		 * the simulator calculate a new state for an atomic model
-		 * whose beginLookahead method is unsupported.</P>
+		 * whose beginLookahead method is unsupported. The tryLookNextEvent
+		 * method returns false instead.</P>
 		 */
 		void beginLookahead();
 		/**
@@ -150,93 +203,174 @@ template <class X, class T = double> class Simulator:
 		 * calling endLookahead. 
 		 */
 		void lookNextEvent();
+		/**
+		 * Like lookNextEvent, but this returns false instead of throwing
+		 * a lookahead_impossible_exception if the lookahead can not go on.
+		 * The output at the event has been computed in either case.
+		 */
+		bool tryLookNextEvent()
+		{
+			computeNextOutput();
+			return tryComputeNextState(bogus_input,sched.minPriority());
+		}
+		/**
+		 * Like computeNextState, but this returns false instead of throwing
+		 * a lookahead_impossible_exception if a lookahead can not go on.
+		 */
+		bool tryComputeNextState(Bag<Event<X,T> >& input, T t);
 	private:
 		typedef enum { OUTPUT_OK, OUTPUT_NOT_OK, RESTORING_OUTPUT } OutputStatus;
 		// Structure to support parallel computing by a logical process
 		struct lp_support
 		{
 			// The processor that this simulator works for
-			LogicalProcess<X,T>* lp;
+			AbstractLogicalProcess<X,T>* lp;
 			bool look_ahead, stop_forced;
 			OutputStatus out_flag;
 			Bag<Atomic<X,T>*> to_restore;
 		};
 		// This is NULL if the simulator is not supporting a logical process
 		lp_support* lps;
+		// Events routed by a thread while computing output in parallel
+		struct route_buffer
+		{
+			route_buffer():dynamic(false),err(NULL){}
+			~route_buffer() { if (err != NULL) delete err; }
+			// Output events to report to the listeners
+			Bag<Event<X,T> > out;
+			// Input events for the atomic models
+			Bag<Event<X,T> > in;
+			// Bags for the receivers of events
+			object_pool<Bag<Event<X,T> > > recv_pool;
+			// Arena for the output functions called by the thread
+			Arena arena;
+			// Set if the route passed through a network without static routes
+			bool dynamic;
+			// First error raised by the thread
+			exception* err;
+		};
+		typedef typename route_key<X>::type key_type;
+		// The precompiled route of values with one key from one atomic model
+		struct compiled_route
+		{
+			key_type key;
+			// If true, then the route can not be precompiled
+			bool dynamic;
+			// Models that produce the value as output
+			std::vector<std::pair<Devs<X,T>*,key_type> > out;
+			// Atomic models that receive the value as input
+			std::vector<std::pair<Atomic<X,T>*,key_type> > in;
+		};
+		// The precompiled routes of an atomic model
+		struct route_entry
+		{
+			Atomic<X,T>* src;
+			// The routes are out of date if this is not route_gen
+			unsigned gen;
+			std::vector<compiled_route> routes;
+		};
+		// Precompiled routes indexed by Atomic::route_index-1
+		std::vector<route_entry> route_table;
+		// Entries in the route table that are not in use
+		std::vector<unsigned> free_routes;
+		// Incremented each time the routes become out of date
+		unsigned route_gen;
+		// The coupling generation of the networks when last checked
+		long coupling_gen;
+		// Buffer used to record a route as it is compiled
+		route_buffer route_rec;
+		// Structure to support parallel evaluation of the model functions
+		struct par_support
+		{
+			~par_support()
+			{
+				for (unsigned i = 0; i < buf.size(); i++)
+					delete buf[i];
+			}
+			// One buffer for each thread
+			std::vector<route_buffer*> buf;
+			// Random access copy of the imminent or activated models
+			std::vector<Atomic<X,T>*> models;
+			// Results of the time advance and model transition functions
+			std::vector<T> ta;
+			std::vector<char> trans;
+		};
+		// This is NULL if the model functions are evaluated sequentially
+		par_support* pars;
 		// Bogus input bag for execNextEvent() method
 		Bag<Event<X,T> > bogus_input;
 		// The event schedule
-		Schedule<X,T> sched;
+		S sched;
 		// List of models that are imminent or activated by input
 		Bag<Atomic<X,T>*> activated;
+		// The imminent models whose output is being computed
+		Bag<Atomic<X,T>*> imminent;
 		// Pools of preallocated, commonly used objects
 		object_pool<Bag<X> > io_pool;
 		object_pool<Bag<Event<X,T> > > recv_pool;
+		// Memory for output values that is reset after every cycle
+		Arena arena;
 		// Sets for computing structure changes.
 		Bag<Devs<X,T>*> added;
 		Bag<Devs<X,T>*> removed;
-		Set<Devs<X,T>*> next;
-		Set<Devs<X,T>*> prev;
-		// Model transition functions are evaluated from the bottom up!
-		struct bottom_to_top_depth_compare
+		ModelTransitions<X,T> transitions;
+		/// Evaluate the model transition function of the network
+		void model_transition_needed(Network<X,T>* model)
 		{
-			bool operator()(const Network<X,T>* m1, const Network<X,T>* m2) const
-			{
-				unsigned long int d1 = 0, d2 = 0;
-				// Compute depth of m1
-				const Network<X,T>* m = m1->getParent();
-				while (m != NULL) 
-				{
-					d1++;
-					m = m->getParent();
-				}
-				// Compute depth of m2
-				m = m2->getParent();
-				while (m != NULL)
-				{
-					d2++;
-					m = m->getParent();
-				}
-				// Models at the same depth are sorted by name
-				if (d1 == d2) return m1 < m2;
-				// Otherwise, sort by depth
-				return d1 > d2;
-			}
-		};
-		struct top_to_bottom_depth_compare
-		{
-			bool operator()(const Devs<X,T>* m1, const Devs<X,T>* m2) const
-			{
-				unsigned long int d1 = 0, d2 = 0;
-				// Compute depth of m1
-				const Network<X,T>* m = m1->getParent();
-				while (m != NULL) 
-				{
-					d1++;
-					m = m->getParent();
-				}
-				// Compute depth of m2
-				m = m2->getParent();
-				while (m != NULL)
-				{
-					d2++;
-					m = m->getParent();
-				}
-				// Models at the same depth are sorted by name
-				if (d1 == d2) return m1 < m2;
-				// Otherwise, sort by depth
-				return d1 < d2;
-			}
-		};
-		std::set<Network<X,T>*,bottom_to_top_depth_compare> model_func_eval_set;
-		std::set<Devs<X,T>*,top_to_bottom_depth_compare> sorted_removed;
+			transitions.needed(model);
+		}
 		/**
 		 * Recursively add the model and its elements to the schedule 
 		 * using t as the time of last event.
 		 */
 		void schedule(Devs<X,T>* model, T t);
-		/// Route an event generated by the source model contained in the parent model.
-		void route(Network<X,T>* parent, Devs<X,T>* src, X& x);
+		/// Put the atomic components of a model into the list
+		void gather_atomics(Devs<X,T>* model, std::vector<Atomic<X,T>*>& models);
+		/**
+		 * Compute the time advances of a list of atomic models, in parallel
+		 * if that is enabled, and put them into the schedule together
+		 * using t as the time of last event.
+		 */
+		void schedule_all(std::vector<Atomic<X,T>*>& models, T t);
+		/**
+		 * Schedule an atomic model whose time advance is dt using
+		 * t as the time of last event.
+		 */
+		void schedule(Atomic<X,T>* a, T t, T dt);
+		/**
+		 * Route an event generated by the source model contained in the parent model.
+		 * If buf is not NULL, then the listener notifications and inputs
+		 * to atomic models are stored in it instead of being acted on.
+		 */
+		void route(Network<X,T>* parent, Devs<X,T>* src, X& x,
+			route_buffer* buf = NULL);
+		/**
+		 * Route an output of an atomic model using its precompiled route,
+		 * compiling the route first if it is new.
+		 */
+		void route_output(Atomic<X,T>* src, X& x, route_buffer* buf = NULL);
+		/// Find the precompiled route for a value. Returns NULL if there is none.
+		compiled_route* find_route(Atomic<X,T>* src, const X& x);
+		/// Route the value with recording turned on and store the route. 
+		compiled_route* compile_route(Atomic<X,T>* src, X& x);
+		/**
+		 * Mark all of the precompiled routes as out of date. The routes
+		 * of each model are discarded when it next produces an output.
+		 */
+		void invalidate_routes();
+		/**
+		 * Invalidate the precompiled routes if a network has changed
+		 * its couplings since the last check.
+		 */
+		void check_couplings();
+		/// Discard the precompiled routes of a model that is being removed
+		void release_routes(Atomic<X,T>* model);
+		/// Discard all of the precompiled routes
+		void clear_routes();
+		/// Notify the listeners of an output, or save it in buf if not NULL
+		void notify_output(Devs<X,T>* src, X& x, route_buffer* buf);
+		/// Deliver an input to an atomic model, or save it in buf if not NULL
+		void deliver(Atomic<X,T>* amodel, X& x, route_buffer* buf);
 		/**	
 		 * Add an input to the input bag of an an atomic model. If the 
 		 * model is not already active , then this method adds the model to
@@ -261,52 +395,116 @@ template <class X, class T = double> class Simulator:
 		 * and removed sets. 
 		 */
 		void exec_event(Atomic<X,T>* model, T t);
-		/**
-		 * Construct the complete descendant set of a network model and store it in s.
-		 */
-		void getAllChildren(Network<X,T>* model, Set<Devs<X,T>*>& s);
+		/// Call the internal, external, or confluent transition function
+		void exec_delta(Atomic<X,T>* model, T t);
+		/// Compute and route output of the imminent models in parallel
+		void par_output();
+		/// Compute the states of the activated models in parallel
+		void par_exec_events(T t);
+		/// Clean up and reschedule the activated models in parallel
+		void par_reschedule(T t);
+		/// Make sure there is a buffer for every thread
+		void par_buffers();
+		/// Record an error raised by the calling thread
+		void par_error(const exception& err);
+		/// Throw the first error raised by a thread, if any
+		void par_rethrow();
+		/// The number of the calling thread
+		static int thread_num()
+		{
+#ifdef _OPENMP
+			return omp_get_thread_num();
+#else
+			return 0;
+#endif
+		}
+		/// The number of threads in the current parallel region
+		static int num_threads()
+		{
+#ifdef _OPENMP
+			return omp_get_num_threads();
+#else
+			return 1;
+#endif
+		}
+		/// Puts the atomic models inside of a network into a list
+		class atomic_collector:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				atomic_collector(std::vector<Atomic<X,T>*>& models):
+					models(models){}
+				void visit(Devs<X,T>* model)
+				{
+					Atomic<X,T>* a = model->typeIsAtomic();
+					if (a != NULL) models.push_back(a);
+					else model->typeIsNetwork()->visitComponents(this);
+				}
+			private:
+				std::vector<Atomic<X,T>*>& models;
+		};
 		/**
 		 * Update data structures needed for a reset of the simulator
 		 * following a speculative lookahead. Returns true if the
 		 * lookahead can be managed. False otherwise.
 		 */
 		bool manage_lookahead_data(Atomic<X,T>* model);
-		/**
-		 * Visit method inhereted from ImminentVisitor
-		 */
-		void visit(Atomic<X,T>* model);
 };
 
-template <class X, class T>
-void Simulator<X,T>::visit(Atomic<X,T>* model)
+template <class X, class T, class S>
+void Simulator<X,T,S>::computeNextOutput()
 {
-	assert(model->y == NULL);
-	model->y = io_pool.make_obj();
-	// Put it in the active list if it is not already there
-	if (model->x == NULL)
+	// If the imminent set is up to date, then just return
+	if (activated.empty() == false) return;
+	// Get the imminent models from the schedule. 
+	sched.getImminent(imminent);
+	// Compute and route the output in parallel if requested
+	if (pars != NULL && imminent.size() > 1)
+	{
+		par_output();
+		imminent.clear();
+		return;
+	}
+	// Compute the output functions of the imminent models and put
+	// them into the active list. The bags of output are held for
+	// garbage collection at a later time.
+	typename Bag<Atomic<X,T>*>::iterator iter;
+	for (iter = imminent.begin(); iter != imminent.end(); iter++)
+	{
+		Atomic<X,T>* model = *iter;
+		assert(model->x == NULL);
+		assert(model->y == NULL);
+		model->y = io_pool.make_obj();
 		activated.insert(model);
-	// Compute output functions and route the events. The bags of output
-	// are held for garbage collection at a later time.
-	model->output_func(*(model->y));
-	// Route each event in y
-	for (typename Bag<X>::iterator y_iter = model->y->begin(); 
-		y_iter != model->y->end(); y_iter++)
+		model->arena = &arena;
+		model->output_func(*(model->y));
+	}
+	// Route each event in the output bags
+	check_couplings();
+	for (iter = imminent.begin(); iter != imminent.end(); iter++)
 	{
-		route(model->getParent(),model,*y_iter);
+		Atomic<X,T>* model = *iter;
+		for (typename Bag<X>::iterator y_iter = model->y->begin(); 
+			y_iter != model->y->end(); y_iter++)
+		{
+			route_output(model,*y_iter);
+		}
 	}
+	imminent.clear();
 }
 
-template <class X, class T>
-void Simulator<X,T>::computeNextOutput()
+template <class X, class T, class S>
+void Simulator<X,T,S>::computeNextState(Bag<Event<X,T> >& input, T t)
 {
-	// If the imminent set is up to date, then just return
-	if (activated.empty() == false) return;
-	// Get the imminent models from the schedule. 
-	sched.visitImminent(this);
+	if (!tryComputeNextState(input,t))
+	{
+		lookahead_impossible_exception err;
+		throw err;
+	}
 }
 
-template <class X, class T>
-void Simulator<X,T>::computeNextState(Bag<Event<X,T> >& input, T t)
+template <class X, class T, class S>
+bool Simulator<X,T,S>::tryComputeNextState(Bag<Event<X,T> >& input, T t)
 {
 	// Clean up if there was a previous IO calculation
 	if (t < sched.minPriority())
@@ -343,109 +541,82 @@ void Simulator<X,T>::computeNextState(Bag<Event<X,T> >& input, T t)
 	 * special container that will be used when the structure changes are
 	 * computed (see exec_event(.)).
 	 */
-	for (typename Bag<Atomic<X,T>*>::iterator iter = activated.begin(); 
-		iter != activated.end(); iter++)
+	if (pars != NULL && activated.size() > 1)
+		par_exec_events(t);
+	else
 	{
-		exec_event(*iter,t); 
+		for (typename Bag<Atomic<X,T>*>::iterator iter = activated.begin(); 
+			iter != activated.end(); iter++)
+		{
+			exec_event(*iter,t); 
+		}
 	}
 	/**
 	 * Compute model transitions and build up the prev (pre-transition)
 	 * and next (post-transition) component sets. These sets are built
 	 * up from only the models that have the model_transition function
-	 * evaluated.
+	 * evaluated and that do not report their own changes.
 	 */
-	if (model_func_eval_set.empty() == false)
+	if (transitions.empty() == false)
 	{
-		while (!model_func_eval_set.empty())
-		{
-			Network<X,T>* network_model = *(model_func_eval_set.begin());
-			model_func_eval_set.erase(model_func_eval_set.begin());
-			getAllChildren(network_model,prev);
-			if (network_model->model_transition() &&
-					network_model->getParent() != NULL)
-			{
-				model_func_eval_set.insert(network_model->getParent());
-			}
-			getAllChildren(network_model,next);
-		}
-		// Find the set of models that were added.
-		set_assign_diff(added,next,prev);
-		// Find the set of models that were removed
-		set_assign_diff(removed,prev,next);
-		// Intersection of added and removed is always empty, so no need to look
-		// for models in both (an earlier version of the code did this).
-		next.clear();
-		prev.clear();
+		// The couplings may change
+		invalidate_routes();
+		transitions.evaluate(added,removed);
 		/** 
 		 * The model adds are processed first.  This is done so that, if any
 		 * of the added models are components something that was removed at
 		 * a higher level, then the models will not have been deleted when
 		 * trying to schedule them.
 		 */
+		std::vector<Atomic<X,T>*> new_models;
 		for (typename Bag<Devs<X,T>*>::iterator iter = added.begin(); 
 			iter != added.end(); iter++)
 		{
-			schedule(*iter,t);
+			if (lps != NULL) lps->lp->notifyAdded(*iter,t);
+			gather_atomics(*iter,new_models);
 		}
+		schedule_all(new_models,t);
 		// Done with the additions
 		added.clear();
 		// Remove the models that are in the removed set.
 		for (typename Bag<Devs<X,T>*>::iterator iter = removed.begin(); 
 			iter != removed.end(); iter++)
 		{
+			if (lps != NULL) lps->lp->notifyRemoved(*iter);
 			clean_up(*iter);
 			unschedule_model(*iter);
-			// Add to a sorted remove set for deletion
-			sorted_removed.insert(*iter); 
-		}
-		// Done with the unsorted remove set
-		removed.clear();
-		// Delete the sorted removed models
-		while (!sorted_removed.empty())
-		{
-			// Get the model to erase
-			Devs<X,T>* model_to_remove = *(sorted_removed.begin());
-			// Remove the model
-			sorted_removed.erase(sorted_removed.begin());
-			/**
-			 * If this model has children, then remove them from the 
-			 * deletion set. This will avoid double delete problems.
-			 */
-			if (model_to_remove->typeIsNetwork() != NULL)
-			{
-				getAllChildren(model_to_remove->typeIsNetwork(),prev);
-				typename Set<Devs<X,T>*>::iterator iter = prev.begin();
-				for (; iter != prev.end(); iter++)
-					sorted_removed.erase(*iter);
-				prev.clear();
-			}
-			// Delete the model and its children
-			delete model_to_remove;
 		}
-		// Removed sets should be empty now
-		assert(prev.empty());
-		assert(sorted_removed.empty());
+		// Delete the removed models
+		transitions.deleteModels(removed);
 	} // End of the structure change
 	// Cleanup and reschedule models that changed state in this iteration
 	// and survived the structure change phase.
-	for (typename Bag<Atomic<X,T>*>::iterator iter = activated.begin(); 
-		iter != activated.end(); iter++)
+	if (pars != NULL && activated.size() > 1)
+		par_reschedule(t);
+	else
 	{
-		clean_up(*iter);
-		schedule(*iter,t);
+		for (typename Bag<Atomic<X,T>*>::iterator iter = activated.begin(); 
+			iter != activated.end(); iter++)
+		{
+			clean_up(*iter);
+			schedule(*iter,t);
+		}
 	}
 	// Empty the bags
 	activated.clear();
-	// If we are looking ahead, throw an exception if a stop was forced
-	if (lps != NULL && lps->stop_forced)
+	// Destroy the output values that were put into the arenas
+	arena.reset();
+	if (pars != NULL)
 	{
-		lookahead_impossible_exception err;
-		throw err;
+		for (unsigned k = 0; k < pars->buf.size(); k++)
+			pars->buf[k]->arena.reset();
 	}
+	// If we are looking ahead, report that a stop was forced
+	return (lps == NULL || !lps->stop_forced);
 }
 
-template <class X, class T>
-void Simulator<X,T>::clean_up(Devs<X,T>* model)
+template <class X, class T, class S>
+void Simulator<X,T,S>::clean_up(Devs<X,T>* model)
 {
 	Atomic<X,T>* amodel = model->typeIsAtomic();
 	if (amodel != NULL)
@@ -458,7 +629,8 @@ void Simulator<X,T>::clean_up(Devs<X,T>* model)
 		}
 		if (amodel->y != NULL)
 		{
-			amodel->gc_output(*(amodel->y));
+			if (amodel->gc_needed)
+				amodel->gc_output(*(amodel->y));
 			amodel->y->clear();
 			io_pool.destroy_obj(amodel->y);
 			amodel->y = NULL;
@@ -466,68 +638,115 @@ void Simulator<X,T>::clean_up(Devs<X,T>* model)
 	}
 	else
 	{
-		Set<Devs<X,T>*> components;
-		model->typeIsNetwork()->getComponents(components);
-		for (typename Set<Devs<X,T>*>::iterator iter = components.begin();
-		iter != components.end(); iter++)
-		{
-			clean_up(*iter);
-		}
+		std::vector<Atomic<X,T>*> models;
+		gather_atomics(model,models);
+		for (unsigned i = 0; i < models.size(); i++)
+			clean_up(models[i]);
 	}
 }
 
-template <class X, class T>
-void Simulator<X,T>::unschedule_model(Devs<X,T>* model)
+template <class X, class T, class S>
+void Simulator<X,T,S>::unschedule_model(Devs<X,T>* model)
 {
 	if (model->typeIsAtomic() != NULL)
 	{
 		sched.schedule(model->typeIsAtomic(),adevs_inf<T>());
 		activated.erase(model->typeIsAtomic());
+		release_routes(model->typeIsAtomic());
 	}
 	else
 	{
-		Set<Devs<X,T>*> components;
-		model->typeIsNetwork()->getComponents(components);
-		for (typename Set<Devs<X,T>*>::iterator iter = components.begin();
-		iter != components.end(); iter++)
-		{
-			unschedule_model(*iter);
-		}
+		std::vector<Atomic<X,T>*> models;
+		gather_atomics(model,models);
+		for (unsigned i = 0; i < models.size(); i++)
+			unschedule_model(models[i]);
 	}
 }
 
-template <class X, class T>
-void Simulator<X,T>::schedule(Devs<X,T>* model, T t)
+template <class X, class T, class S>
+void Simulator<X,T,S>::schedule(Devs<X,T>* model, T t)
 {
 	Atomic<X,T>* a = model->typeIsAtomic();
 	if (a != NULL)
 	{
+		// The time advance may depend on the time of last event
 		a->tL = t;
-		T dt = a->ta();
-		if (dt < adevs_zero<T>())
+		schedule(a,t,a->ta());
+	}
+	else
+	{
+		std::vector<Atomic<X,T>*> models;
+		gather_atomics(model,models);
+		schedule_all(models,t);
+	}
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::gather_atomics(Devs<X,T>* model,
+	std::vector<Atomic<X,T>*>& models)
+{
+	atomic_collector visitor(models);
+	visitor.visit(model);
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::schedule_all(std::vector<Atomic<X,T>*>& models, T t)
+{
+	int n = (int)models.size();
+	std::vector<T> prio(n);
+	// The time advance may depend on the time of last event
+	for (int i = 0; i < n; i++)
+		models[i]->tL = t;
+	// Compute the time advances and convert them to absolute times
+	if (pars != NULL && n > 1)
+	{
+		par_buffers();
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic,64)
+#endif
+		for (int i = 0; i < n; i++)
 		{
-			exception err("Negative time advance",a);
-			throw err;
+			try
+			{
+				prio[i] = models[i]->ta();
+			}
+			catch(exception& err) { par_error(err); }
+			catch(std::exception& err) { par_error(exception(err.what())); }
 		}
-		if (dt == adevs_inf<T>())
-			sched.schedule(a,adevs_inf<T>());
-		else
-			sched.schedule(a,t+dt);
+		par_rethrow();
 	}
-	else
+	for (int i = 0; i < n; i++)
 	{
-		Set<Devs<X,T>*> components;
-		model->typeIsNetwork()->getComponents(components);
-		typename Set<Devs<X,T>*>::iterator iter = components.begin();
-		for (; iter != components.end(); iter++)
+		if (pars == NULL || n == 1)
+			prio[i] = models[i]->ta();
+		if (prio[i] < adevs_zero<T>())
 		{
-			schedule(*iter,t);
+			exception err("Negative time advance",models[i]);
+			throw err;
 		}
+		if (prio[i] < adevs_inf<T>())
+			prio[i] = t+prio[i];
 	}
+	sched.scheduleAll(models,prio);
 }
 
-template <class X, class T>
-void Simulator<X,T>::inject_event(Atomic<X,T>* model, X& value)
+template <class X, class T, class S>
+void Simulator<X,T,S>::schedule(Atomic<X,T>* a, T t, T dt)
+{
+	a->tL = t;
+	if (dt < adevs_zero<T>())
+	{
+		exception err("Negative time advance",a);
+		throw err;
+	}
+	if (dt == adevs_inf<T>())
+		sched.schedule(a,adevs_inf<T>());
+	else
+		sched.schedule(a,t+dt);
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::inject_event(Atomic<X,T>* model, X& value)
 {
 	if (model->x == NULL)
 	{
@@ -538,16 +757,22 @@ void Simulator<X,T>::inject_event(Atomic<X,T>* model, X& value)
 	model->x->insert(value);
 }
 
-template <class X, class T>
-void Simulator<X,T>::route(Network<X,T>* parent, Devs<X,T>* src, X& x)
+template <class X, class T, class S>
+void Simulator<X,T,S>::route(Network<X,T>* parent, Devs<X,T>* src, X& x,
+	route_buffer* buf)
 {
 	// Notify event listeners if this is an output event
-	if (parent != src && (lps == NULL || lps->out_flag != RESTORING_OUTPUT))
-		this->notify_output_listeners(src,x,sched.minPriority());
+	if (parent != src)
+		notify_output(src,x,buf);
 	// No one to do the routing, so return
 	if (parent == NULL) return;
+	// Note if the route can not be precompiled
+	if (buf != NULL && !parent->routesAreStatic())
+		buf->dynamic = true;
 	// Compute the set of receivers for this value
-	Bag<Event<X,T> >* recvs = recv_pool.make_obj();
+	object_pool<Bag<Event<X,T> > >& pool =
+		(buf == NULL) ? recv_pool : buf->recv_pool;
+	Bag<Event<X,T> >* recvs = pool.make_obj();
 	parent->route(x,src,*recvs);
 	// Deliver the event to each of its targets
 	Atomic<X,T>* amodel = NULL;
@@ -567,33 +792,210 @@ void Simulator<X,T>::route(Network<X,T>* parent, Devs<X,T>* src, X& x)
 		amodel = (*recv_iter).model->typeIsAtomic();
 		if (amodel != NULL)
 		{
-			// Inject it only if it is assigned to our processor
-			if (lps == NULL || amodel->getProc() == lps->lp->getID())
-				inject_event(amodel,(*recv_iter).value);
-			// Otherwise tell the lp about it
-			else if (lps->out_flag != RESTORING_OUTPUT)
-				lps->lp->notifyInput(amodel,(*recv_iter).value);
+			deliver(amodel,(*recv_iter).value,buf);
 		}
 		// if this is an external output from the parent model
 		else if ((*recv_iter).model == parent)
 		{
-			route(parent->getParent(),parent,(*recv_iter).value);
+			route(parent->getParent(),parent,(*recv_iter).value,buf);
 		}
 		// otherwise it is an input to a coupled model
 		else
 		{
-			route((*recv_iter).model->typeIsNetwork(),
-			(*recv_iter).model,(*recv_iter).value);
+			Network<X,T>* net = (*recv_iter).model->typeIsNetwork();
+			// The logical process that owns the network routes its input.
+			// This route can not be precompiled.
+			if (lps != NULL && net->getProc() >= 0 &&
+				net->getProc() != lps->lp->getID() &&
+				lps->lp->routesNetworkInput())
+			{
+				if (buf != NULL)
+					buf->dynamic = true;
+				else if (lps->out_flag != RESTORING_OUTPUT)
+					lps->lp->notifyNetworkInput(net,(*recv_iter).value);
+			}
+			else route(net,(*recv_iter).model,(*recv_iter).value,buf);
 		}
 	}
 	recvs->clear();
-	recv_pool.destroy_obj(recvs);
+	pool.destroy_obj(recvs);
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::notify_output(Devs<X,T>* src, X& x, route_buffer* buf)
+{
+	if (buf != NULL)
+		buf->out.insert(Event<X,T>(src,x));
+	else if (lps == NULL || lps->out_flag != RESTORING_OUTPUT)
+		this->notify_output_listeners(src,x,sched.minPriority());
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::deliver(Atomic<X,T>* amodel, X& x, route_buffer* buf)
+{
+	// Save it for later if recording the route
+	if (buf != NULL)
+		buf->in.insert(Event<X,T>(amodel,x));
+	// Inject it only if it is assigned to our processor
+	else if (lps == NULL || amodel->getProc() == lps->lp->getID())
+		inject_event(amodel,x);
+	// Otherwise tell the lp about it
+	else if (lps->out_flag != RESTORING_OUTPUT)
+		lps->lp->notifyInput(amodel,x);
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::route_output(Atomic<X,T>* src, X& x, route_buffer* buf)
+{
+	compiled_route* r = find_route(src,x);
+	if (r == NULL)
+		r = compile_route(src,x);
+	if (r->dynamic)
+	{
+		route(src->getParent(),src,x,buf);
+		return;
+	}
+	// Replay the route, replacing the key as it was replaced
+	// by the networks along the way
+	X value(x);
+	for (unsigned i = 0; i < r->out.size(); i++)
+	{
+		route_key<X>::set(value,r->out[i].second);
+		notify_output(r->out[i].first,value,buf);
+	}
+	for (unsigned i = 0; i < r->in.size(); i++)
+	{
+		route_key<X>::set(value,r->in[i].second);
+		deliver(r->in[i].first,value,buf);
+	}
+}
+
+template <class X, class T, class S>
+typename Simulator<X,T,S>::compiled_route*
+Simulator<X,T,S>::find_route(Atomic<X,T>* src, const X& x)
+{
+	if (src->route_index == 0) return NULL;
+	route_entry& entry = route_table[src->route_index-1];
+	std::vector<compiled_route>& routes = entry.routes;
+	if (entry.gen != route_gen)
+	{
+		routes.clear();
+		entry.gen = route_gen;
+		return NULL;
+	}
+	key_type key = route_key<X>::get(x);
+	for (unsigned i = 0; i < routes.size(); i++)
+	{
+		if (!(routes[i].key < key) && !(key < routes[i].key))
+			return &(routes[i]);
+	}
+	return NULL;
+}
+
+template <class X, class T, class S>
+typename Simulator<X,T,S>::compiled_route*
+Simulator<X,T,S>::compile_route(Atomic<X,T>* src, X& x)
+{
+	// Route the value and record where it goes
+	route_rec.out.clear();
+	route_rec.in.clear();
+	route_rec.dynamic = false;
+	route(src->getParent(),src,x,&route_rec);
+	if (src->route_index == 0)
+	{
+		if (free_routes.empty())
+		{
+			route_table.push_back(route_entry());
+			src->route_index = route_table.size();
+		}
+		else
+		{
+			src->route_index = free_routes.back()+1;
+			free_routes.pop_back();
+		}
+		route_table[src->route_index-1].src = src;
+		route_table[src->route_index-1].gen = route_gen;
+	}
+	std::vector<compiled_route>& routes = route_table[src->route_index-1].routes;
+	routes.push_back(compiled_route());
+	compiled_route& r = routes.back();
+	r.key = route_key<X>::get(x);
+	r.dynamic = route_rec.dynamic;
+	if (!r.dynamic)
+	{
+		typename Bag<Event<X,T> >::iterator iter;
+		for (iter = route_rec.out.begin(); iter != route_rec.out.end(); iter++)
+			r.out.push_back(std::make_pair((*iter).model,
+				route_key<X>::get((*iter).value)));
+		for (iter = route_rec.in.begin(); iter != route_rec.in.end(); iter++)
+			r.in.push_back(std::make_pair((*iter).model->typeIsAtomic(),
+				route_key<X>::get((*iter).value)));
+	}
+	route_rec.out.clear();
+	route_rec.in.clear();
+	return &r;
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::invalidate_routes()
+{
+	route_gen++;
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::check_couplings()
+{
+	long gen = Network<X,T>::getCouplingGeneration();
+	if (gen != coupling_gen)
+	{
+		coupling_gen = gen;
+		invalidate_routes();
+	}
 }
 
-template <class X, class T>
-void Simulator<X,T>::exec_event(Atomic<X,T>* model, T t)
+template <class X, class T, class S>
+void Simulator<X,T,S>::release_routes(Atomic<X,T>* model)
+{
+	if (model->route_index == 0) return;
+	route_entry& entry = route_table[model->route_index-1];
+	entry.src = NULL;
+	entry.routes.clear();
+	free_routes.push_back(model->route_index-1);
+	model->route_index = 0;
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::clear_routes()
+{
+	for (unsigned i = 0; i < route_table.size(); i++)
+	{
+		if (route_table[i].src != NULL)
+			route_table[i].src->route_index = 0;
+	}
+	route_table.clear();
+	free_routes.clear();
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::exec_event(Atomic<X,T>* model, T t)
 {
 	if (!manage_lookahead_data(model)) return;
+	exec_delta(model,t);
+	// Notify any listeners
+	this->notify_state_listeners(model,t);
+	// Check for a model transition. A change of structure can not
+	// be undone, and so it stops a lookahead.
+	if (model->model_transition() && model->getParent() != NULL)
+	{
+		if (lps != NULL && lps->look_ahead)
+			lps->stop_forced = true;
+		else model_transition_needed(model->getParent());
+	}
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::exec_delta(Atomic<X,T>* model, T t)
+{
 	// Internal event
 	if (model->x == NULL)
 		model->delta_int();
@@ -603,36 +1005,227 @@ void Simulator<X,T>::exec_event(Atomic<X,T>* model, T t)
 	// External event
 	else
 		model->delta_ext(t-model->tL,*(model->x));
-	// Notify any listeners
-	this->notify_state_listeners(model,t);
-	// Check for a model transition
-	if (model->model_transition() && model->getParent() != NULL)
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::par_output()
+{
+	std::vector<Atomic<X,T>*>& models = pars->models;
+	models.clear();
+	// The output bags are taken from the pool here because
+	// the pool is not thread safe
+	typename Bag<Atomic<X,T>*>::iterator iter;
+	for (iter = imminent.begin(); iter != imminent.end(); iter++)
+	{
+		Atomic<X,T>* model = *iter;
+		assert(model->x == NULL);
+		assert(model->y == NULL);
+		model->y = io_pool.make_obj();
+		activated.insert(model);
+		models.push_back(model);
+	}
+	int n = (int)models.size();
+	par_buffers();
+	// Compute the output functions
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic,16)
+#endif
+	for (int i = 0; i < n; i++)
 	{
-		model_func_eval_set.insert(model->getParent());
+		try
+		{
+			models[i]->arena = &(pars->buf[thread_num()]->arena);
+			models[i]->output_func(*(models[i]->y));
+		}
+		catch(exception& err) { par_error(err); }
+		catch(std::exception& err) { par_error(exception(err.what())); }
+	}
+	par_rethrow();
+	// Compile any new routes here because the route table is not thread safe
+	check_couplings();
+	for (int i = 0; i < n; i++)
+	{
+		Atomic<X,T>* model = models[i];
+		for (typename Bag<X>::iterator y_iter = model->y->begin(); 
+			y_iter != model->y->end(); y_iter++)
+		{
+			if (find_route(model,*y_iter) == NULL)
+				compile_route(model,*y_iter);
+		}
+	}
+	// Route the output. Each thread gets a contiguous block of models
+	// so that the buffers, taken in order, hold the events in the same
+	// order that the sequential simulator would produce them.
+#ifdef _OPENMP
+	#pragma omp parallel
+#endif
+	{
+		int tid = thread_num(), nthreads = num_threads();
+		route_buffer* buf = pars->buf[tid];
+		int first = (int)(((long long)n*tid)/nthreads);
+		int last = (int)(((long long)n*(tid+1))/nthreads);
+		try
+		{
+			for (int i = first; i < last; i++)
+			{
+				Atomic<X,T>* model = models[i];
+				for (typename Bag<X>::iterator y_iter = model->y->begin(); 
+					y_iter != model->y->end(); y_iter++)
+				{
+					route_output(model,*y_iter,buf);
+				}
+			}
+		}
+		catch(exception& err) { par_error(err); }
+		catch(std::exception& err) { par_error(exception(err.what())); }
+	}
+	par_rethrow();
+	// Notify the listeners and deliver the input
+	for (unsigned k = 0; k < pars->buf.size(); k++)
+	{
+		route_buffer* buf = pars->buf[k];
+		typename Bag<Event<X,T> >::iterator e_iter;
+		for (e_iter = buf->out.begin(); e_iter != buf->out.end(); e_iter++)
+			this->notify_output_listeners((*e_iter).model,(*e_iter).value,
+				sched.minPriority());
+		for (e_iter = buf->in.begin(); e_iter != buf->in.end(); e_iter++)
+			inject_event((*e_iter).model->typeIsAtomic(),(*e_iter).value);
+		buf->out.clear();
+		buf->in.clear();
 	}
 }
 
-template <class X, class T>
-void Simulator<X,T>::getAllChildren(Network<X,T>* model, Set<Devs<X,T>*>& s)
+template <class X, class T, class S>
+void Simulator<X,T,S>::par_exec_events(T t)
 {
-	Set<Devs<X,T>*> tmp;
-	// Get the component set
-	model->getComponents(tmp);
-	// Add all of the local level elements to s
-	s.insert(tmp.begin(),tmp.end());
-	// Find the components of type network and update s recursively
-	typename Set<Devs<X,T>*>::iterator iter;
-	for (iter = tmp.begin(); iter != tmp.end(); iter++)
+	std::vector<Atomic<X,T>*>& models = pars->models;
+	std::vector<char>& trans = pars->trans;
+	models.clear();
+	typename Bag<Atomic<X,T>*>::iterator iter;
+	for (iter = activated.begin(); iter != activated.end(); iter++)
+		models.push_back(*iter);
+	int n = (int)models.size();
+	trans.resize(n);
+	par_buffers();
+	// Compute the new states
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic,16)
+#endif
+	for (int i = 0; i < n; i++)
+	{
+		try
+		{
+			exec_delta(models[i],t);
+			trans[i] = models[i]->model_transition();
+		}
+		catch(exception& err) { par_error(err); }
+		catch(std::exception& err) { par_error(exception(err.what())); }
+	}
+	par_rethrow();
+	// Notify the listeners and find the networks that need their
+	// model transition functions evaluated
+	for (int i = 0; i < n; i++)
+	{
+		this->notify_state_listeners(models[i],t);
+		if (trans[i] && models[i]->getParent() != NULL)
+			model_transition_needed(models[i]->getParent());
+	}
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::par_reschedule(T t)
+{
+	std::vector<Atomic<X,T>*>& models = pars->models;
+	std::vector<T>& ta = pars->ta;
+	models.clear();
+	// The garbage collection returns bags to the pool and so
+	// is done by the calling thread
+	typename Bag<Atomic<X,T>*>::iterator iter;
+	for (iter = activated.begin(); iter != activated.end(); iter++)
+	{
+		clean_up(*iter);
+		(*iter)->tL = t;
+		models.push_back(*iter);
+	}
+	int n = (int)models.size();
+	ta.resize(n);
+	par_buffers();
+	// Compute the time advances
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic,16)
+#endif
+	for (int i = 0; i < n; i++)
 	{
-		if ((*iter)->typeIsNetwork() != NULL)
+		try
 		{
-			getAllChildren((*iter)->typeIsNetwork(),s);
+			ta[i] = models[i]->ta();
 		}
+		catch(exception& err) { par_error(err); }
+		catch(std::exception& err) { par_error(exception(err.what())); }
 	}
+	par_rethrow();
+	for (int i = 0; i < n; i++)
+		schedule(models[i],t,ta[i]);
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::par_buffers()
+{
+#ifdef _OPENMP
+	unsigned nthreads = omp_get_max_threads();
+#else
+	unsigned nthreads = 1;
+#endif
+	while (pars->buf.size() < nthreads)
+		pars->buf.push_back(new route_buffer());
 }
 
-template <class X, class T>
-Simulator<X,T>::~Simulator()
+template <class X, class T, class S>
+void Simulator<X,T,S>::par_error(const exception& err)
+{
+	route_buffer* buf = pars->buf[thread_num()];
+	if (buf->err == NULL)
+		buf->err = new exception(err);
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::par_rethrow()
+{
+	exception* first = NULL;
+	for (unsigned k = 0; k < pars->buf.size(); k++)
+	{
+		if (first == NULL)
+			first = pars->buf[k]->err;
+		else if (pars->buf[k]->err != NULL)
+			delete pars->buf[k]->err;
+		pars->buf[k]->err = NULL;
+	}
+	if (first == NULL) return;
+	// Discard anything that was routed before the error
+	for (unsigned k = 0; k < pars->buf.size(); k++)
+	{
+		pars->buf[k]->out.clear();
+		pars->buf[k]->in.clear();
+	}
+	exception err(*first);
+	delete first;
+	throw err;
+}
+
+template <class X, class T, class S>
+void Simulator<X,T,S>::setParallel(bool flag)
+{
+	if (flag && pars == NULL && lps == NULL)
+		pars = new par_support();
+	else if (!flag && pars != NULL)
+	{
+		delete pars;
+		pars = NULL;
+	}
+}
+
+template <class X, class T, class S>
+Simulator<X,T,S>::~Simulator()
 {
 	// Clean up the models with stale IO
 	typename Bag<Atomic<X,T>*>::iterator iter;
@@ -640,11 +1233,18 @@ Simulator<X,T>::~Simulator()
 	{
 		clean_up(*iter);
 	}
+	clear_routes();
+	if (pars != NULL)
+		delete pars;
 }
 
-template <class X, class T>
-Simulator<X,T>::Simulator(LogicalProcess<X,T>* lp):
-	AbstractSimulator<X,T>()
+template <class X, class T, class S>
+Simulator<X,T,S>::Simulator(AbstractLogicalProcess<X,T>* lp):
+	AbstractSimulator<X,T>(),
+	route_gen(0),
+	coupling_gen(Network<X,T>::getCouplingGeneration()),
+	pars(NULL),
+	transitions(lp)
 {
 	lps = new lp_support;
 	lps->lp = lp;
@@ -653,8 +1253,8 @@ Simulator<X,T>::Simulator(LogicalProcess<X,T>* lp):
 	lps->out_flag = OUTPUT_OK;
 }
 
-template <class X, class T>
-void Simulator<X,T>::beginLookahead()
+template <class X, class T, class S>
+void Simulator<X,T,S>::beginLookahead()
 {
 	if (lps == NULL)
 	{
@@ -666,20 +1266,22 @@ void Simulator<X,T>::beginLookahead()
 		lps->out_flag = OUTPUT_NOT_OK; 
 }
 
-template <class X, class T>
-void Simulator<X,T>::lookNextEvent()
+template <class X, class T, class S>
+void Simulator<X,T,S>::lookNextEvent()
 {
 	execNextEvent();
 }
 
-template <class X, class T>
-void Simulator<X,T>::endLookahead()
+template <class X, class T, class S>
+void Simulator<X,T,S>::endLookahead()
 {
 	if (lps == NULL) return;
 	typename Bag<Atomic<X,T>*>::iterator iter = lps->to_restore.begin();
 	for (; iter != lps->to_restore.end(); iter++)
 	{
-		(*iter)->endLookahead();
+		// Only a model that saved its state can restore it
+		if (!(*iter)->no_lookahead && (*iter)->supportsLookahead())
+			(*iter)->endLookahead();
 		schedule(*iter,(*iter)->tL_cp);
 		(*iter)->tL_cp = adevs_sentinel<T>();
 		assert((*iter)->x == NULL);
@@ -697,21 +1299,29 @@ void Simulator<X,T>::endLookahead()
 	lps->stop_forced = false;
 }
 
-template <class X, class T>
-bool Simulator<X,T>::manage_lookahead_data(Atomic<X,T>* model)
+template <class X, class T, class S>
+bool Simulator<X,T,S>::manage_lookahead_data(Atomic<X,T>* model)
 {
 	if (lps == NULL) return true;
 	if (lps->look_ahead && model->tL_cp < adevs_zero<T>())
 	{
 		lps->to_restore.insert(model);
 		model->tL_cp = model->tL;
-		try
-		{
-			model->beginLookahead();
-		}
-		catch(method_not_supported_exception err)
-		{
+		// Ask first so that only a model which does not say
+		// can throw, and then only once
+		if (model->no_lookahead || !model->supportsLookahead())
 			lps->stop_forced = true;
+		else
+		{
+			try
+			{
+				model->beginLookahead();
+			}
+			catch(method_not_supported_exception&)
+			{
+				model->no_lookahead = true;
+				lps->stop_forced = true;
+			}
 		}
 	}
 	return !(lps->stop_forced);
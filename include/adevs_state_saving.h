@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_state_saving_h_
+#define __adevs_state_saving_h_
+#include "adevs_exception.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+namespace adevs
+{
+
+/**
+ * <P>StateSaver implements beginLookahead and endLookahead for an atomic
+ * model that keeps its state in a trivially copyable type, such as a struct
+ * of numbers and arrays of numbers. The whole state is copied when the
+ * lookahead begins and copied back when it ends, so that no memory is
+ * allocated and nothing needs to be written by hand.</P>
+ * <P>The template arguments are the class of the model (as for the curiously
+ * recurring template pattern), the type of its state, and the class that
+ * the model would otherwise derive from, like Atomic<X> or a class derived
+ * from it. The model gives access to its state with the method
+ * <pre>
+ * State& getLookaheadState();
+ * </pre>
+ * which is called directly and need not be virtual. For example,
+ * <pre>
+ * struct counter_state { int count; double sigma; };
+ * class counter: public StateSaver<counter,counter_state,Atomic<int> >
+ * {
+ *     public:
+ *         counter_state& getLookaheadState() { return s; }
+ *         ...
+ *     private:
+ *         counter_state s;
+ * };
+ * </pre>
+ * Members that are not part of the state are not restored, and so
+ * the model must not change them in its transition functions. For large
+ * states that change only in part at each event, see IncrementalStateSaver.
+ * </P>
+ */
+template <class Model, class State, class Base> class StateSaver:
+	public Base
+{
+	public:
+		StateSaver():Base(){}
+		template <class A1> StateSaver(const A1& a1):Base(a1){}
+		template <class A1, class A2> StateSaver(const A1& a1, const A2& a2):
+			Base(a1,a2){}
+		template <class A1, class A2, class A3>
+			StateSaver(const A1& a1, const A2& a2, const A3& a3):
+			Base(a1,a2,a3){}
+		/// Copy the state
+		void beginLookahead()
+		{
+			memcpy(&saved,&(state()),sizeof(State));
+		}
+		/// Copy back the state that was saved by beginLookahead
+		void endLookahead()
+		{
+			memcpy(&(state()),&saved,sizeof(State));
+		}
+		bool supportsLookahead() { return true; }
+	private:
+#if __cplusplus >= 201103L
+		static_assert(std::is_trivially_copyable<State>::value,
+			"The state of a StateSaver must be trivially copyable");
+#endif
+		State saved;
+		State& state() { return static_cast<Model*>(this)->getLookaheadState(); }
+};
+
+/**
+ * <P>IncrementalStateSaver is a StateSaver for large states that change
+ * only in part at each event. The state is divided into pages of
+ * PageSize bytes and a page is copied the first time it is changed during
+ * a lookahead. The end of the lookahead copies back only those pages.
+ * The cost of a lookahead is therefore proportional to the part of the
+ * state that it changes rather than to the size of the state.</P>
+ * <P>The model must announce each change to its state by calling modify
+ * before it writes, as in
+ * <pre>
+ * modify(s.cells[i]) = x;
+ * </pre>
+ * or touch for a range of bytes (e.g., before a memset or an update of a
+ * whole array). A change that is not announced is not undone at the end of
+ * the lookahead. Outside of a lookahead these methods do nothing more than
+ * test a flag. Inside of one, touch throws an adevs::exception if the
+ * bytes are not all in the state. The pages are kept in a buffer that belongs to the model
+ * and is reused by every lookahead, and so a model that has warmed up does
+ * not touch the heap. The template arguments and constructors are the same
+ * as for the StateSaver.</P>
+ */
+template <class Model, class State, class Base, size_t PageSize = 256>
+class IncrementalStateSaver:
+	public Base
+{
+	public:
+		IncrementalStateSaver():Base(),active(false){}
+		template <class A1> IncrementalStateSaver(const A1& a1):
+			Base(a1),active(false){}
+		template <class A1, class A2>
+			IncrementalStateSaver(const A1& a1, const A2& a2):
+			Base(a1,a2),active(false){}
+		template <class A1, class A2, class A3>
+			IncrementalStateSaver(const A1& a1, const A2& a2, const A3& a3):
+			Base(a1,a2,a3),active(false){}
+		/// Start recording the pages that are changed
+		void beginLookahead()
+		{
+			if (dirty.empty()) dirty.resize(pages,false);
+			active = true;
+		}
+		/// Copy back the pages that were changed since beginLookahead
+		void endLookahead()
+		{
+			char* base = reinterpret_cast<char*>(&(state()));
+			for (unsigned i = 0; i < saved.size(); i++)
+			{
+				size_t page = saved[i];
+				memcpy(base+page*PageSize,&(buffer[i*PageSize]),length(page));
+				dirty[page] = false;
+			}
+			saved.clear();
+			active = false;
+		}
+		bool supportsLookahead() { return true; }
+		/// Number of pages that have been saved by the current lookahead
+		unsigned getSavedPageCount() const { return saved.size(); }
+	protected:
+		/// Announce a change to a part of the state and return it for writing
+		template <class F> F& modify(F& field)
+		{
+			if (active) touch(&field,sizeof(F));
+			return field;
+		}
+		/// Announce a change to the size bytes that begin at ptr
+		void touch(const void* ptr, size_t size)
+		{
+			if (!active || size == 0) return;
+			const char* base = reinterpret_cast<const char*>(&(state()));
+			const char* bytes = static_cast<const char*>(ptr);
+			if (bytes < base || size > sizeof(State) ||
+				bytes > base+sizeof(State)-size)
+			{
+				exception err("IncrementalStateSaver::touch is outside of the state",this);
+				throw err;
+			}
+			size_t first = (bytes-base)/PageSize;
+			size_t last = (bytes+size-1-base)/PageSize;
+			for (size_t page = first; page <= last; page++)
+			{
+				if (dirty[page]) continue;
+				dirty[page] = true;
+				size_t at = saved.size()*PageSize;
+				if (buffer.size() < at+PageSize) buffer.resize(at+PageSize);
+				memcpy(&(buffer[at]),base+page*PageSize,length(page));
+				saved.push_back(page);
+			}
+		}
+	private:
+#if __cplusplus >= 201103L
+		static_assert(std::is_trivially_copyable<State>::value,
+			"The state of an IncrementalStateSaver must be trivially copyable");
+#endif
+		static const size_t pages = (sizeof(State)+PageSize-1)/PageSize;
+		bool active;
+		// Pages that have been saved since beginLookahead
+		std::vector<bool> dirty;
+		// The numbers of the saved pages and their contents, in the same order
+		std::vector<size_t> saved;
+		std::vector<char> buffer;
+		State& state() { return static_cast<Model*>(this)->getLookaheadState(); }
+		// The last page may be shorter than the others
+		static size_t length(size_t page)
+		{
+			size_t end = (page+1)*PageSize;
+			return (end > sizeof(State)) ? sizeof(State)-page*PageSize : PageSize;
+		}
+};
+
+} // end of namespace
+
+#endif
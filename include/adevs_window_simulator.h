@@ -0,0 +1,486 @@
+/**
+ * Copyright (c) 2013, James Nutaro
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+ *
+ * Bugs, comments, and questions can be sent to nutaro@gmail.com
+ */
+#ifndef __adevs_window_simulator_h_
+#define __adevs_window_simulator_h_
+#include "adevs_abstract_simulator.h"
+#include "adevs_msg_manager.h"
+#include "adevs_message_q.h"
+#include "adevs_simulator.h"
+#include "adevs_lp_graph.h"
+#include "adevs_partitioner.h"
+#include "adevs_time.h"
+#include <omp.h>
+#include <cassert>
+#include <vector>
+#include <queue>
+#include <limits>
+#include <algorithm>
+
+namespace adevs
+{
+
+/**
+ * A logical process for the WindowSimulator. In each window, it first
+ * projects the output of its models as far as their lookahead allows and
+ * then advances their states to the end of the window that every process
+ * agreed to. This class is used by the WindowSimulator.
+ */
+template <class X, class T = double, class S = Schedule<X,T> > class WindowProcess:
+	public EventListener<X,T>,
+	public AbstractLogicalProcess<X,T>
+{
+	public:
+		/// Constructor builds a process without any models assigned to it
+		WindowProcess(int ID, const std::vector<int>& E,
+			WindowProcess<X,T,S>** all_lps, int lp_count,
+			AbstractSimulator<X,T>* psim, MessageManager<X>* msg_manager);
+		/// Assign a model to this process
+		void addModel(Devs<X,T>* model);
+		/// Get the time of the next event or input
+		Time<T> nextTime();
+		/**
+		 * Compute the output of the models from gvt up to the end of the
+		 * window that they allow, but not past t_stop. The output that
+		 * goes to other processes is put into their boxes.
+		 */
+		void project(Time<T> gvt, Time<T> t_stop);
+		/// Get the end of the window found by project
+		Time<T> getWindowEnd() const { return wend; }
+		/// Does this process send input to any other?
+		bool hasInfluencees() const { return !E.empty(); }
+		/// Take the input from the other processes and compute the events before w
+		void advance(Time<T> w);
+		/// Get the number of messages sent to other processes
+		unsigned long int getOutputCount() const { return outputs; }
+		int getID() const { return ID; }
+		void notifyInput(Atomic<X,T>* model, X& value);
+		void outputEvent(Event<X,T> x, T t)
+		{
+			if (!projecting) psim->notify_output_listeners(x.model,x.value,t);
+		}
+		void stateChange(Atomic<X,T>* model, T t)
+		{
+			if (!projecting) psim->notify_state_listeners(model,t);
+		}
+		/// Destructor leaves the models intact
+		~WindowProcess();
+	private:
+		const int ID;
+		const std::vector<int> E;
+		WindowProcess<X,T,S>** all_lps;
+		AbstractSimulator<X,T>* psim;
+		MessageManager<X>* msg_manager;
+		// Output for each of the other processes from the last projection
+		std::vector<std::vector<Message<X,T> > > box;
+		// Input that has not been used yet
+		std::priority_queue<Message<X,T> > xq;
+		Bag<Event<X,T> > xb;
+		// Last event, current event, last output, and end of the window
+		Time<T> tL, tNow, tOut, wend;
+		T lookahead;
+		bool projecting;
+		unsigned long int outputs;
+		Simulator<X,T,S> sim;
+		Time<T> tNextEvent(Time<T> tlast);
+		void addToSimulator(Devs<X,T>* model);
+		class add_visitor:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				add_visitor(WindowProcess<X,T,S>* lp):lp(lp){}
+				void visit(Devs<X,T>* model) { lp->addToSimulator(model); }
+			private:
+				WindowProcess<X,T,S>* lp;
+		};
+};
+
+template <class X, class T, class S>
+WindowProcess<X,T,S>::WindowProcess(int ID, const std::vector<int>& E,
+	WindowProcess<X,T,S>** all_lps, int lp_count,
+	AbstractSimulator<X,T>* psim, MessageManager<X>* msg_manager):
+	ID(ID),E(E),all_lps(all_lps),psim(psim),msg_manager(msg_manager),
+	box(lp_count),lookahead(adevs_inf<T>()),projecting(false),outputs(0),
+	sim(this)
+{
+	tL = tNow = tOut = wend = Time<T>(0,0);
+	all_lps[ID] = this;
+	sim.addEventListener(this);
+}
+
+template <class X, class T, class S>
+void WindowProcess<X,T,S>::addModel(Devs<X,T>* model)
+{
+	lookahead = std::min(model->lookahead(),lookahead);
+	addToSimulator(model);
+}
+
+template <class X, class T, class S>
+void WindowProcess<X,T,S>::addToSimulator(Devs<X,T>* model)
+{
+	model->setProc(ID);
+	Atomic<X,T>* a = model->typeIsAtomic();
+	if (a != NULL) sim.addModel(a);
+	else
+	{
+		add_visitor visitor(this);
+		model->typeIsNetwork()->visitComponents(&visitor);
+	}
+}
+
+template <class X, class T, class S>
+Time<T> WindowProcess<X,T,S>::tNextEvent(Time<T> tlast)
+{
+	if (tlast.t < sim.nextEventTime())
+	{
+		tlast.t = sim.nextEventTime();
+		tlast.c = 0;
+	}
+	else tlast.c++;
+	return tlast;
+}
+
+template <class X, class T, class S>
+Time<T> WindowProcess<X,T,S>::nextTime()
+{
+	Time<T> tN(tNextEvent(tL));
+	if (tN.t == adevs_inf<T>()) tN = Time<T>::Inf();
+	if (!xq.empty() && xq.top().t < tN) tN = xq.top().t;
+	return tN;
+}
+
+template <class X, class T, class S>
+void WindowProcess<X,T,S>::project(Time<T> gvt, Time<T> t_stop)
+{
+	// Input that arrives at or after gvt can not change the output
+	// before gvt plus the lookahead, nor the output at gvt itself
+	wend = Time<T>(gvt.t,gvt.c+1);
+	if (adevs_zero<T>() < lookahead)
+	{
+		Time<T> bound(gvt.t+lookahead,0);
+		if (lookahead == adevs_inf<T>()) bound = Time<T>::Inf();
+		if (wend < bound) wend = bound;
+	}
+	if (t_stop < wend) wend = t_stop;
+	if (E.empty()) return;
+	tNow = tNextEvent(tL);
+	if (!(tNow < wend) || tNow.t == adevs_inf<T>()) return;
+	projecting = true;
+	sim.beginLookahead();
+	while (tNow.t < adevs_inf<T>() && tNow < wend)
+	{
+		// This computes the next output and might compute the next
+		// state. If it can not, the output at tNow is still known.
+		bool ok = sim.tryLookNextEvent();
+		if (tOut < tNow) tOut = tNow;
+		if (!ok)
+		{
+			wend = Time<T>(tNow.t,tNow.c+1);
+			break;
+		}
+		tNow = tNextEvent(tNow);
+	}
+	sim.endLookahead();
+	projecting = false;
+}
+
+template <class X, class T, class S>
+void WindowProcess<X,T,S>::notifyInput(Atomic<X,T>* model, X& value)
+{
+	// Output is sent only when it is projected and only once
+	if (!projecting || tNow <= tOut) return;
+	assert(model->getProc() != ID);
+	Message<X,T> msg(msg_manager->clone(value));
+	msg.t = tNow;
+	msg.src = ID;
+	msg.target = model;
+	msg.type = Message<X,T>::OUTPUT;
+	box[model->getProc()].push_back(msg);
+	outputs++;
+}
+
+template <class X, class T, class S>
+void WindowProcess<X,T,S>::advance(Time<T> w)
+{
+	// Take the output that the other processes projected for us. They
+	// do not touch these boxes until the next projection.
+	for (int i = 0; i < (int)box.size(); i++)
+	{
+		std::vector<Message<X,T> >& in = all_lps[i]->box[ID];
+		for (unsigned k = 0; k < in.size(); k++)
+			xq.push(in[k]);
+		in.clear();
+	}
+	// Compute the events in the window
+	while (true)
+	{
+		Time<T> tSelf(tNextEvent(tL));
+		if (!xq.empty() && xq.top().t < tSelf) tNow = xq.top().t;
+		else tNow = tSelf;
+		if (tNow.t == adevs_inf<T>() || !(tNow < w)) return;
+		if (tNow == tSelf) sim.computeNextOutput();
+		while (!xq.empty() && xq.top().t <= tNow)
+		{
+			Message<X,T> msg(xq.top());
+			xq.pop();
+			assert(msg.target->getProc() == ID);
+			xb.insert(Event<X,T>(msg.target,msg.value));
+		}
+		sim.computeNextState(xb,tNow.t);
+		typename Bag<Event<X,T> >::iterator iter = xb.begin();
+		for (; iter != xb.end(); iter++)
+			msg_manager->destroy((*iter).value);
+		xb.clear();
+		tL = tNow;
+	}
+}
+
+template <class X, class T, class S>
+WindowProcess<X,T,S>::~WindowProcess()
+{
+	while (!xq.empty())
+	{
+		Message<X,T> msg(xq.top());
+		xq.pop();
+		msg_manager->destroy(msg.value);
+	}
+	for (unsigned i = 0; i < box.size(); i++)
+	{
+		for (unsigned k = 0; k < box[i].size(); k++)
+			msg_manager->destroy(box[i][k].value);
+	}
+}
+
+/**
+ * <P>This is a synchronous conservative simulator that uses the bounded
+ * lag, or YAWNS, protocol. The logical processes agree on the time GVT
+ * of the next event in the whole model and on a window that begins there.
+ * Each computes, in parallel with the others, the output that its models
+ * will produce in the window. The output is exchanged, each process
+ * computes the events in the window, and the threads meet at a barrier to
+ * find the next window. The window is as long as the smallest lookahead of
+ * the models whose processes send input to other processes, and so there
+ * are no null messages. For models with a uniform lookahead, like cell
+ * spaces with a fixed propagation delay, this costs much less than the
+ * ParSimulator's null messages.</P>
+ * <P>As for the ParSimulator, the output in a window is projected with
+ * the beginLookahead and endLookahead methods of the atomic models. If a
+ * model can not do this, then the window ends just after the last output
+ * that could be projected. A model with no lookahead makes the window one
+ * instant long. Models are assigned to processes with setProc, by a
+ * Partitioner, or at random, as they are by the ParSimulator, and the
+ * LpGraph tells the simulator which processes send input to which others.
+ * This simulator does not support dynamic structure models.</P>
+ */
+template <class X, class T = double, class S = Schedule<X,T> > class WindowSimulator:
+	public AbstractSimulator<X,T>
+{
+	public:
+		/**
+		 * Create a simulator for the model with one logical process
+		 * for each thread. The models without a processor are assigned
+		 * by a Partitioner. The message manager is used as by the
+		 * ParSimulator.
+		 */
+		WindowSimulator(Devs<X,T>* model, MessageManager<X>* msg_manager = NULL);
+		/**
+		 * Create a simulator for the model with a logical process for
+		 * each node of the graph. The processes are shared by the
+		 * omp_get_max_threads() threads in each window.
+		 */
+		WindowSimulator(Devs<X,T>* model, LpGraph& g,
+			MessageManager<X>* msg_manager = NULL);
+		/// Get the model's next event time
+		T nextEventTime();
+		/**
+		 * Execute the simulator until the next event time is greater
+		 * than the specified value.
+		 */
+		void execUntil(T stop_time);
+		/// Get the number of windows that have been simulated
+		unsigned long int getWindowCount() const { return windows; }
+		/// Get the number of messages sent by a logical process
+		unsigned long int getOutputCount(int lp_id) const
+		{
+			return lp[lp_id]->getOutputCount();
+		}
+		/**
+		 * Deletes the simulator, but leaves the model intact. The model
+		 * must exist when the simulator is deleted.
+		 */
+		~WindowSimulator();
+	private:
+		WindowProcess<X,T,S>** lp;
+		int lp_count;
+		MessageManager<X>* msg_manager;
+		unsigned long int windows;
+		// The start and end of the current window
+		Time<T> gvt, wend;
+		bool done;
+		void init_sim(Devs<X,T>* model, LpGraph& g);
+		void init(Devs<X,T>* model);
+		class init_visitor:
+			public Network<X,T>::ComponentVisitor
+		{
+			public:
+				init_visitor(WindowSimulator<X,T,S>* sim):sim(sim){}
+				void visit(Devs<X,T>* model) { sim->init(model); }
+			private:
+				WindowSimulator<X,T,S>* sim;
+		};
+};
+
+template <class X, class T, class S>
+WindowSimulator<X,T,S>::WindowSimulator(Devs<X,T>* model,
+	MessageManager<X>* msg_manager):
+	AbstractSimulator<X,T>(),msg_manager(msg_manager)
+{
+	Partitioner<X,T> partitioner(model);
+	LpGraph g;
+	partitioner.partition(omp_get_max_threads(),g);
+	init_sim(model,g);
+}
+
+template <class X, class T, class S>
+WindowSimulator<X,T,S>::WindowSimulator(Devs<X,T>* model, LpGraph& g,
+	MessageManager<X>* msg_manager):
+	AbstractSimulator<X,T>(),msg_manager(msg_manager)
+{
+	init_sim(model,g);
+}
+
+template <class X, class T, class S>
+void WindowSimulator<X,T,S>::init_sim(Devs<X,T>* model, LpGraph& g)
+{
+	if (msg_manager == NULL) msg_manager = new NullMessageManager<X>();
+	lp_count = g.getLPCount();
+	windows = 0;
+	lp = new WindowProcess<X,T,S>*[lp_count];
+	for (int i = 0; i < lp_count; i++)
+	{
+		// Input to itself is not a message
+		std::vector<int> E;
+		for (unsigned k = 0; k < g.getE(i).size(); k++)
+			if (g.getE(i)[k] != i) E.push_back(g.getE(i)[k]);
+		lp[i] = new WindowProcess<X,T,S>(i,E,lp,lp_count,this,msg_manager);
+	}
+	init(model);
+}
+
+template <class X, class T, class S>
+void WindowSimulator<X,T,S>::init(Devs<X,T>* model)
+{
+	if (model->getProc() >= 0 && model->getProc() < lp_count)
+	{
+		lp[model->getProc()]->addModel(model);
+		return;
+	}
+	Atomic<X,T>* a = model->typeIsAtomic();
+	if (a != NULL)
+	{
+		int lp_assign = a->getProc();
+		if (lp_assign < 0 || lp_assign >= lp_count)
+			lp_assign =
+				((unsigned long int)(a)^(unsigned long int)(this))%lp_count;
+		lp[lp_assign]->addModel(a);
+	}
+	else
+	{
+		init_visitor visitor(this);
+		model->typeIsNetwork()->visitComponents(&visitor);
+	}
+}
+
+template <class X, class T, class S>
+T WindowSimulator<X,T,S>::nextEventTime()
+{
+	Time<T> tN = Time<T>::Inf();
+	for (int i = 0; i < lp_count; i++)
+	{
+		if (lp[i]->nextTime() < tN)
+			tN = lp[i]->nextTime();
+	}
+	return tN.t;
+}
+
+template <class X, class T, class S>
+void WindowSimulator<X,T,S>::execUntil(T tstop)
+{
+	Time<T> t_stop(tstop,std::numeric_limits<unsigned int>::max());
+	#pragma omp parallel
+	{
+		while (true)
+		{
+			#pragma omp single
+			{
+				gvt = Time<T>::Inf();
+				for (int i = 0; i < lp_count; i++)
+				{
+					if (lp[i]->nextTime() < gvt)
+						gvt = lp[i]->nextTime();
+				}
+				done = (gvt.t == adevs_inf<T>() || tstop < gvt.t);
+				if (!done) windows++;
+			}
+			if (done) break;
+			// Project the output in the window
+			#pragma omp for schedule(dynamic)
+			for (int i = 0; i < lp_count; i++)
+				lp[i]->project(gvt,t_stop);
+			// Agree on the end of the window
+			#pragma omp single
+			{
+				wend = t_stop;
+				for (int i = 0; i < lp_count; i++)
+				{
+					if (lp[i]->hasInfluencees() && lp[i]->getWindowEnd() < wend)
+						wend = lp[i]->getWindowEnd();
+				}
+			}
+			// Compute the events in the window
+			#pragma omp for schedule(dynamic)
+			for (int i = 0; i < lp_count; i++)
+				lp[i]->advance(wend);
+		}
+	}
+}
+
+template <class X, class T, class S>
+WindowSimulator<X,T,S>::~WindowSimulator()
+{
+	for (int i = 0; i < lp_count; i++)
+		delete lp[i];
+	delete [] lp;
+	delete msg_manager;
+}
+
+} // end of namespace
+
+#endif
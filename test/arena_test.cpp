@@ -0,0 +1,149 @@
+/**
+ * Tests for the Arena and its use by the Simulator for output values.
+ */
+#include "adevs.h"
+#include <iostream>
+#include <vector>
+#include <cassert>
+using namespace adevs;
+
+/**
+ * A packet that counts how many of it exist and records the
+ * order in which packets are destroyed.
+ */
+struct packet
+{
+	packet():id(-1){ live++; }
+	packet(int id):id(id){ live++; }
+	packet(int id, int):id(id){ live++; }
+	~packet() { live--; order.push_back(id); }
+	int id;
+	char data[100];
+	static int live;
+	static std::vector<int> order;
+};
+
+int packet::live = 0;
+std::vector<int> packet::order;
+
+void test1()
+{
+	Arena arena(1024);
+	assert(arena.empty());
+	// Allocations are aligned
+	char* p1 = static_cast<char*>(arena.allocate(1));
+	char* p2 = static_cast<char*>(arena.allocate(1));
+	assert(p2-p1 == 16);
+	assert(((size_t)p1) % 16 == 0);
+	// Objects are destroyed in reverse order
+	packet* a = arena.create<packet>();
+	packet* b = arena.create<packet>(1);
+	packet* c = arena.create<packet>(2,0);
+	assert(a->id == -1 && b->id == 1 && c->id == 2);
+	// An allocation larger than a block
+	char* big = static_cast<char*>(arena.allocate(5000));
+	big[4999] = 0;
+	for (int i = 0; i < 100; i++)
+		assert(arena.create<packet>(i+3)->id == i+3);
+	assert(packet::live == 103);
+	assert(!arena.empty());
+	packet::order.clear();
+	arena.reset();
+	assert(arena.empty());
+	assert(packet::live == 0);
+	assert(packet::order.size() == 103);
+	for (int i = 0; i < 102; i++)
+		assert(packet::order[i] == 102-i);
+	assert(packet::order[102] == -1);
+	// Memory is reused after the reset
+	assert(arena.allocate(1) == p1);
+	arena.reset();
+}
+
+/**
+ * Sends packets created in the output arena.
+ */
+class source: public Atomic<packet*>
+{
+	public:
+		source(int id):Atomic<packet*>(),id(id),count(0)
+		{
+			setGcOutput(false);
+		}
+		void delta_int() { count++; }
+		void delta_ext(double, const Bag<packet*>&){}
+		void delta_conf(const Bag<packet*>&){}
+		void output_func(Bag<packet*>& yb)
+		{
+			yb.insert(getOutputArena().create<packet>(id+count));
+			yb.insert(getOutputArena().create<packet>(1));
+		}
+		void gc_output(Bag<packet*>&) { assert(false); }
+		double ta() { return (count < 20) ? 1.0 : DBL_MAX; }
+	private:
+		int id, count;
+};
+
+class sink: public Atomic<packet*>
+{
+	public:
+		sink():Atomic<packet*>(),sum(0){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<packet*>& xb)
+		{
+			for (Bag<packet*>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				sum += (*iter)->id;
+		}
+		void delta_conf(const Bag<packet*>&){}
+		void output_func(Bag<packet*>&){}
+		void gc_output(Bag<packet*>&){}
+		double ta() { return DBL_MAX; }
+		int sum;
+};
+
+/**
+ * The packets are gone at the end of every simulation cycle.
+ */
+int run(bool parallel)
+{
+	SimpleDigraph<packet*>* model = new SimpleDigraph<packet*>();
+	sink* dst = new sink();
+	model->add(dst);
+	for (int i = 0; i < 50; i++)
+	{
+		source* src = new source(i);
+		model->add(src);
+		model->couple(src,dst);
+	}
+	Simulator<packet*>* sim = new Simulator<packet*>(model);
+	sim->setParallel(parallel);
+	while (sim->nextEventTime() < DBL_MAX)
+	{
+		sim->execNextEvent();
+		assert(packet::live == 0);
+	}
+	int sum = dst->sum;
+	delete sim;
+	delete model;
+	return sum;
+}
+
+int main()
+{
+#ifdef _OPENMP
+	omp_set_num_threads(4);
+#endif
+	test1();
+	int a = run(false);
+	int b = run(true);
+	// Each source sends (id+count)+1 for count = 0..19
+	int expect = 0;
+	for (int i = 0; i < 50; i++)
+		for (int k = 0; k < 20; k++)
+			expect += i+k+1;
+	assert(a == expect);
+	assert(a == b);
+	std::cout << "Test passed" << std::endl;
+	return 0;
+}
@@ -1,7 +1,25 @@
 #include "adevs.h"
 #include <cassert>
+#include <string>
 using namespace adevs;
 
+/**
+ * Counts the live instances of itself.
+ */
+class counted
+{
+	public:
+		counted(int v = 0):v(v) { live++; }
+		counted(const counted& src):v(src.v) { live++; }
+		~counted() { live--; }
+		const counted& operator=(const counted& src) { v = src.v; return *this; }
+		bool operator==(const counted& other) const { return v == other.v; }
+		int v;
+		static int live;
+};
+
+int counted::live = 0;
+
 template <class X> class template_test
 {
 	public:
@@ -52,9 +70,118 @@ void test2()
 	}
 }
 
+/**
+ * Elements are constructed when inserted and destroyed when
+ * erased or cleared, and the bag holds many elements correctly.
+ */
+void test3()
+{
+	{
+		Bag<counted> b;
+		assert(counted::live == 0);
+		for (int i = 0; i < 1000; i++)
+			b.insert(counted(i));
+		assert(counted::live == 1000);
+		assert(b.size() == 1000);
+		for (int i = 0; i < 1000; i += 2)
+			b.erase(counted(i));
+		assert(b.size() == 500);
+		assert(counted::live == 500);
+		for (int i = 0; i < 1000; i++)
+			assert(b.count(counted(i)) == (unsigned)(i%2));
+		// Erase through an iterator to the last element
+		Bag<counted>::iterator last = b.end();
+		last--;
+		b.erase(last);
+		assert(counted::live == 499);
+		b.clear();
+		assert(b.empty());
+		assert(counted::live == 0);
+		b.insert(counted(1));
+	}
+	assert(counted::live == 0);
+}
+
+/**
+ * Copy, assign, and swap bags that are stored inline and on the heap.
+ */
+void test4()
+{
+	for (int n = 0; n < 6; n++)
+	{
+		for (int m = 0; m < 6; m++)
+		{
+			Bag<std::string> a, b;
+			for (int i = 0; i < n; i++)
+				a.insert(std::string(20,'a'+i));
+			for (int i = 0; i < m; i++)
+				b.insert(std::string(20,'A'+i));
+			Bag<std::string> c(a);
+			assert(c.size() == a.size());
+			c = c;
+			assert(c.size() == a.size());
+			a.swap(b);
+			assert(a.size() == (unsigned)m && b.size() == (unsigned)n);
+			for (int i = 0; i < m; i++)
+				assert(a.count(std::string(20,'A'+i)) == 1);
+			for (int i = 0; i < n; i++)
+				assert(b.count(std::string(20,'a'+i)) == 1);
+			c = a;
+			assert(c.size() == (unsigned)m);
+			for (int i = 0; i < m; i++)
+				assert(c.count(std::string(20,'A'+i)) == 1);
+		}
+	}
+	Bag<int> r(100);
+	assert(r.empty());
+	r.reserve(1000);
+	r.insert(1);
+	assert(*(r.begin()) == 1);
+}
+
+#if __cplusplus >= 201103L
+/**
+ * Move and emplace.
+ */
+void test5()
+{
+	{
+		Bag<counted> a;
+		for (int i = 0; i < 10; i++)
+			a.emplace(i);
+		assert(counted::live == 10);
+		Bag<counted> b(std::move(a));
+		assert(a.empty());
+		assert(b.size() == 10);
+		assert(counted::live == 10);
+		Bag<counted> c;
+		c.emplace(1);
+		c = std::move(b);
+		assert(b.empty());
+		assert(c.size() == 10);
+		assert(counted::live == 10);
+		Bag<counted> d;
+		d.emplace(5);
+		Bag<counted> e(std::move(d));
+		assert(d.empty() && e.size() == 1 && (*(e.begin())).v == 5);
+		assert(counted::live == 11);
+	}
+	assert(counted::live == 0);
+	Bag<std::string> s;
+	std::string str(100,'x');
+	s.insert(std::move(str));
+	assert((*(s.begin())).size() == 100);
+}
+#endif
+
 int main()
 {
 	test1();
 	test2();
+	test3();
+	test4();
+#if __cplusplus >= 201103L
+	test5();
+#endif
 	return 0;
 }
@@ -0,0 +1,226 @@
+#include "adevs.h"
+#include <iostream>
+#include <cassert>
+using namespace adevs;
+
+class bogus_atomic: public Atomic<char>
+{
+	public:
+		bogus_atomic():
+		Atomic<char>(){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<char>&){}
+		void delta_conf(const Bag<char>&){}
+		void output_func(Bag<char>&){}
+		void gc_output(Bag<char>&){}
+		double ta() { return 0.0; }
+};
+
+class imminent_collector:
+	public CalendarSchedule<char>::ImminentVisitor
+{
+	public:
+		imminent_collector(Bag<Atomic<char>*>& imm):imm(imm){}
+		void visit(Atomic<char>* model)
+		{
+			imm.insert(model);
+		}
+	private:
+		Bag<Atomic<char>*>& imm;
+};
+
+void test1()
+{
+	int i;
+	bogus_atomic m[10];
+	CalendarSchedule<char> q;
+	for (i = 0; i < 10; i++)
+	{
+		q.schedule(&(m[i]),(double)i);
+		assert(q.minPriority() == 0.0);
+		assert(q.getMinimum() == &(m[0]));
+	}
+	for (i = 0; i < 10; i++)
+	{
+		assert(q.minPriority() == (double)i);
+		assert(q.getMinimum() == &(m[i]));
+		q.removeMinimum();
+	}
+	assert(q.empty());
+	assert(q.getMinimum() == NULL);
+	assert(q.minPriority() == DBL_MAX);
+}
+
+void test2()
+{
+	bogus_atomic m[3];
+	CalendarSchedule<char> q;
+	q.schedule(&(m[0]),5.0);
+	q.schedule(&(m[1]),10.0);
+	q.schedule(&(m[2]),1.0);
+	q.schedule(&(m[0]),DBL_MAX);
+	assert(q.minPriority() == 1.0);
+	q.schedule(&(m[2]),DBL_MAX);
+	assert(q.minPriority() == 10.0);
+	q.schedule(&(m[1]),1000.0);
+	assert(q.minPriority() == 1000.0);
+	q.schedule(&(m[2]),3.0);
+	assert(q.getMinimum() == &(m[2]));
+	assert(q.getSize() == 2);
+}
+
+/**
+ * Compare the calendar against the binary heap using a mix of
+ * inserts, reschedules, cancellations, and removals with clustered
+ * and widely spread event times.
+ */
+void test3()
+{
+	const int N = 5000;
+	bogus_atomic* m1 = new bogus_atomic[N];
+	bogus_atomic* m2 = new bogus_atomic[N];
+	Schedule<char> heap;
+	CalendarSchedule<char> cal;
+	double tNow = 0.0;
+	srand(1);
+	for (int k = 0; k < 200000; k++)
+	{
+		int i = rand()%N;
+		double t;
+		int choice = rand()%10;
+		if (choice == 0) t = DBL_MAX;
+		else if (choice < 5) t = tNow+(double)(rand()%4);
+		else if (choice < 9) t = tNow+(double)rand()/(double)RAND_MAX;
+		else t = tNow+(double)(rand()%100000);
+		heap.schedule(&(m1[i]),t);
+		cal.schedule(&(m2[i]),t);
+		assert(heap.getSize() == cal.getSize());
+		assert(heap.minPriority() == cal.minPriority());
+		if (rand()%3 == 0 && !heap.empty())
+		{
+			tNow = heap.minPriority();
+			// Remove the same imminent model from both queues
+			Bag<Atomic<char>*> imm;
+			imminent_collector v(imm);
+			cal.visitImminent(&v);
+			assert(!imm.empty());
+			bogus_atomic* a = static_cast<bogus_atomic*>(*(imm.begin()));
+			heap.schedule(&(m1[a-m2]),DBL_MAX);
+			cal.schedule(a,DBL_MAX);
+			assert(heap.minPriority() == cal.minPriority());
+		}
+	}
+	// Drain the queues
+	while (!heap.empty())
+	{
+		assert(heap.minPriority() == cal.minPriority());
+		Bag<Atomic<char>*> imm;
+		imminent_collector v(imm);
+		cal.visitImminent(&v);
+		for (Bag<Atomic<char>*>::iterator iter = imm.begin();
+			iter != imm.end(); iter++)
+		{
+			bogus_atomic* a = static_cast<bogus_atomic*>(*iter);
+			assert(a->ta() == 0.0);
+			heap.schedule(&(m1[a-m2]),DBL_MAX);
+			cal.schedule(a,DBL_MAX);
+		}
+	}
+	assert(cal.empty());
+	delete [] m1;
+	delete [] m2;
+}
+
+void test4()
+{
+	int i;
+	bogus_atomic m[20];
+	CalendarSchedule<char> q;
+	Bag<Atomic<char>*> imm;
+	imminent_collector v(imm);
+	q.visitImminent(&v);
+	assert(imm.empty());
+	for (i = 0; i < 10; i++)
+	{
+		q.schedule(&(m[i]),1.0);
+	}
+	for (i = 10; i < 20; i++)
+	{
+		q.schedule(&(m[i]),2.0);
+	}
+	q.visitImminent(&v);
+	assert(imm.size() == 10);
+	for (i = 0; i < 10; i++)
+	{
+		assert(imm.find(&m[i]) != imm.end());
+	}
+	imm.clear();
+	q.getImminent(imm);
+	assert(imm.size() == 10);
+	for (i = 0; i < 10; i++)
+	{
+		assert(imm.find(&m[i]) != imm.end());
+	}
+}
+
+/**
+ * A ring of models that pass a token with a fixed delay. Used to check
+ * that a Simulator with a calendar queue gives the same answer as the
+ * Simulator with the default schedule.
+ */
+class relay: public Atomic<int>
+{
+	public:
+		relay(double delay, bool active):
+		Atomic<int>(),delay(delay),active(active),count(0){}
+		void delta_int() { count++; active = false; }
+		void delta_ext(double, const Bag<int>&) { active = true; }
+		void delta_conf(const Bag<int>&) { count++; active = true; }
+		void output_func(Bag<int>& yb) { yb.insert(count); }
+		void gc_output(Bag<int>&){}
+		double ta() { return (active) ? delay : DBL_MAX; }
+		int getCount() const { return count; }
+	private:
+		double delay;
+		bool active;
+		int count;
+};
+
+template <class S> int run_ring(int size)
+{
+	SimpleDigraph<int>* ring = new SimpleDigraph<int>();
+	std::vector<relay*> nodes;
+	for (int i = 0; i < size; i++)
+	{
+		nodes.push_back(new relay(1.0+(double)(i%3),i%4==0));
+		ring->add(nodes.back());
+	}
+	for (int i = 0; i < size; i++)
+		ring->couple(nodes[i],nodes[(i+1)%size]);
+	Simulator<int,double,S>* sim = new Simulator<int,double,S>(ring);
+	sim->execUntil(500.0);
+	int total = 0;
+	for (int i = 0; i < size; i++)
+		total += nodes[i]->getCount();
+	delete sim;
+	delete ring;
+	return total;
+}
+
+void test5()
+{
+	int a = run_ring<Schedule<int> >(1000);
+	int b = run_ring<CalendarSchedule<int> >(1000);
+	assert(a > 0);
+	assert(a == b);
+}
+
+int main ()
+{
+	test1();
+	test2();
+	test3();
+	test4();
+	test5();
+	return 0;
+}
@@ -0,0 +1,146 @@
+/**
+ * Compares the routes of the CsrDigraph with those of the Digraph.
+ */
+#include "adevs.h"
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cstdlib>
+using namespace adevs;
+
+typedef PortValue<int,int> IO;
+
+class node: public Atomic<IO>
+{
+	public:
+		node(int id):
+		Atomic<IO>(),id(id),sum(0),count(0){}
+		void delta_int() { count++; }
+		void delta_ext(double, const Bag<IO>& xb) { add(xb); }
+		void delta_conf(const Bag<IO>& xb) { count++; add(xb); }
+		void output_func(Bag<IO>& yb) { yb.insert(IO((id+count)%4,count)); }
+		void gc_output(Bag<IO>&){}
+		double ta() { return 1.0+(double)(id%3); }
+		int getSum() const { return sum; }
+	private:
+		int id, sum, count;
+		void add(const Bag<IO>& xb)
+		{
+			for (Bag<IO>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				sum += (*iter).value*((*iter).port+1)+id;
+		}
+};
+
+/**
+ * Check that the two networks route to the same targets in
+ * the same order.
+ */
+template <class A, class B> void compare(A* a, typename A::Component* ma,
+	B* b, typename B::Component* mb, std::vector<typename A::Component*>& na,
+	std::vector<typename B::Component*>& nb, int port)
+{
+	Bag<Event<IO> > ra, rb;
+	a->route(IO(port,port*7),ma,ra);
+	b->route(IO(port,port*7),mb,rb);
+	assert(ra.size() == rb.size());
+	Bag<Event<IO> >::iterator ia = ra.begin(), ib = rb.begin();
+	for (; ia != ra.end(); ia++, ib++)
+	{
+		unsigned k = 0;
+		while (k < na.size() && na[k] != (*ia).model) k++;
+		assert(k == na.size() || nb[k] == (*ib).model);
+		assert((*ia).value.port == (*ib).value.port);
+		assert((*ia).value.value == (*ib).value.value);
+	}
+}
+
+void test1()
+{
+	const int N = 200;
+	Digraph<int,int>* a = new Digraph<int,int>();
+	CsrDigraph<int>* b = new CsrDigraph<int>();
+	std::vector<Devs<IO>*> na, nb;
+	for (int i = 0; i < N; i++)
+	{
+		na.push_back(new node(i));
+		nb.push_back(new node(i));
+		a->add(na.back());
+		b->add(nb.back());
+	}
+	na.push_back(a);
+	nb.push_back(b);
+	srand(1);
+	for (int k = 0; k < 2000; k++)
+	{
+		int src = rand()%(N+1), dst = rand()%(N+1);
+		int src_port = rand()%6, dst_port = rand()%6;
+		if (src == dst) continue;
+		a->couple(na[src],src_port,na[dst],dst_port);
+		b->couple(nb[src],src_port,nb[dst],dst_port);
+		// Route between couplings to force rebuilding the arrays
+		if (k % 100 == 0)
+			compare(a,na[src],b,nb[src],na,nb,src_port);
+	}
+	for (int i = 0; i <= N; i++)
+		for (int port = 0; port < 8; port++)
+			compare(a,na[i],b,nb[i],na,nb,port);
+	// A model that is not coupled to anything
+	node* m = new node(N);
+	Bag<Event<IO> > r;
+	b->route(IO(0,0),m,r);
+	assert(r.empty());
+	delete m;
+	// Negative ports are not allowed
+	bool caught = false;
+	try
+	{
+		b->couple(nb[0],-1,nb[1],0);
+	}
+	catch(adevs::exception& err)
+	{
+		caught = true;
+	}
+	assert(caught);
+	delete a;
+	delete b;
+}
+
+/**
+ * Simulate the same network built with each type of digraph.
+ */
+template <class G> int run()
+{
+	const int N = 300;
+	G* g = new G();
+	std::vector<node*> nodes;
+	for (int i = 0; i < N; i++)
+	{
+		nodes.push_back(new node(i));
+		g->add(nodes.back());
+	}
+	for (int i = 0; i < N; i++)
+	{
+		for (int port = 0; port < 4; port++)
+			g->couple(nodes[i],port,nodes[(i*7+port*13+1)%N],port);
+	}
+	Simulator<IO>* sim = new Simulator<IO>(g);
+	sim->execUntil(100.0);
+	int total = 0;
+	for (int i = 0; i < N; i++)
+		total += nodes[i]->getSum();
+	delete sim;
+	delete g;
+	return total;
+}
+
+int main()
+{
+	test1();
+	int a = run<Digraph<int,int> >();
+	int b = run<CsrDigraph<int> >();
+	assert(a == b);
+	assert(a != 0);
+	std::cout << "Test passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,228 @@
+#include "adevs.h"
+#include <iostream>
+#include <cassert>
+using namespace adevs;
+
+class bogus_atomic: public Atomic<char>
+{
+	public:
+		bogus_atomic():
+		Atomic<char>(){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<char>&){}
+		void delta_conf(const Bag<char>&){}
+		void output_func(Bag<char>&){}
+		void gc_output(Bag<char>&){}
+		double ta() { return 0.0; }
+};
+
+class imminent_collector:
+	public Schedule<char>::ImminentVisitor
+{
+	public:
+		imminent_collector(Bag<Atomic<char>*>& imm):imm(imm){}
+		void visit(Atomic<char>* model)
+		{
+			imm.insert(model);
+		}
+	private:
+		Bag<Atomic<char>*>& imm;
+};
+
+template <class Q> void test1()
+{
+	int i;
+	bogus_atomic m[100];
+	Q q(4);
+	for (i = 0; i < 100; i++)
+	{
+		q.schedule(&(m[i]),(double)i);
+		assert(q.minPriority() == 0.0);
+		assert(q.getMinimum() == &(m[0]));
+	}
+	for (i = 0; i < 100; i++)
+	{
+		assert(q.minPriority() == (double)i);
+		assert(q.getMinimum() == &(m[i]));
+		q.removeMinimum();
+	}
+	assert(q.empty());
+	assert(q.getMinimum() == NULL);
+	assert(q.minPriority() == DBL_MAX);
+}
+
+template <class Q> void test2()
+{
+	bogus_atomic m[5];
+	Q q;
+	q.schedule(&(m[0]),5.0);
+	q.schedule(&(m[1]),10.0);
+	q.schedule(&(m[2]),1.0);
+	q.schedule(&(m[0]),DBL_MAX);
+	assert(q.minPriority() == 1.0);
+	q.schedule(&(m[2]),DBL_MAX);
+	assert(q.minPriority() == 10.0);
+	q.schedule(&(m[3]),3.0);
+	q.schedule(&(m[4]),4.0);
+	q.schedule(&(m[3]),4.0);
+	q.schedule(&(m[3]),4.0);
+	assert(q.minPriority() == 4.0);
+	q.schedule(&(m[1]),1.0);
+	assert(q.getMinimum() == &(m[1]));
+	assert(q.getSize() == 3);
+}
+
+/**
+ * Compare against the binary heap using random inserts, reschedules,
+ * and cancellations.
+ */
+template <class Q> void test3()
+{
+	const int N = 2000;
+	bogus_atomic* m1 = new bogus_atomic[N];
+	bogus_atomic* m2 = new bogus_atomic[N];
+	Schedule<char> heap;
+	Q q;
+	srand(2);
+	for (int k = 0; k < 100000; k++)
+	{
+		int i = rand()%N;
+		double t = (rand()%8 == 0) ? DBL_MAX : (double)(rand()%500);
+		heap.schedule(&(m1[i]),t);
+		q.schedule(&(m2[i]),t);
+		assert(heap.getSize() == q.getSize());
+		assert(heap.minPriority() == q.minPriority());
+		// Compare the imminent sets
+		if (k % 100 == 0)
+		{
+			Bag<Atomic<char>*> imm1, imm2;
+			imminent_collector v1(imm1), v2(imm2);
+			heap.visitImminent(&v1);
+			q.visitImminent(&v2);
+			assert(imm1.size() == imm2.size());
+			Bag<Atomic<char>*> imm3;
+			q.getImminent(imm3);
+			assert(imm3.size() == imm2.size());
+			for (Bag<Atomic<char>*>::iterator iter = imm2.begin();
+				iter != imm2.end(); iter++)
+			{
+				bogus_atomic* a = static_cast<bogus_atomic*>(*iter);
+				assert(imm1.find(&(m1[a-m2])) != imm1.end());
+			}
+		}
+	}
+	double tL = q.minPriority();
+	while (!q.empty())
+	{
+		assert(tL <= q.minPriority());
+		tL = q.minPriority();
+		q.removeMinimum();
+	}
+	delete [] m1;
+	delete [] m2;
+}
+
+/**
+ * Build the queue with scheduleAll and compare it against the binary heap
+ * built one model at a time. The lists include infinite times and models
+ * that appear more than once.
+ */
+template <class Q> void test4()
+{
+	const int N = 3000;
+	bogus_atomic* m1 = new bogus_atomic[N];
+	bogus_atomic* m2 = new bogus_atomic[N];
+	Schedule<char> heap;
+	Q q;
+	srand(3);
+	// First a large list into the empty queue, then a small list into
+	// the full queue, and last a list with models already scheduled
+	int len[3] = { N, N/10, N/2 };
+	int base[3] = { 0, N/2, 0 };
+	for (int r = 0; r < 3; r++)
+	{
+		std::vector<Atomic<char>*> models;
+		std::vector<double> prio;
+		for (int k = 0; k < len[r]; k++)
+		{
+			int i = (r == 1) ? base[r]+rand()%(N/2) : rand()%N;
+			double t = (rand()%8 == 0) ? DBL_MAX : (double)(rand()%1000);
+			heap.schedule(&(m1[i]),t);
+			models.push_back(&(m2[i]));
+			prio.push_back(t);
+		}
+		q.scheduleAll(models,prio);
+		assert(heap.getSize() == q.getSize());
+		assert(heap.minPriority() == q.minPriority());
+	}
+	while (!q.empty())
+	{
+		assert(heap.minPriority() == q.minPriority());
+		heap.removeMinimum();
+		q.removeMinimum();
+	}
+	assert(heap.empty());
+	delete [] m1;
+	delete [] m2;
+}
+
+class relay: public Atomic<int>
+{
+	public:
+		relay(double delay, bool active):
+		Atomic<int>(),delay(delay),active(active),count(0){}
+		void delta_int() { count++; active = false; }
+		void delta_ext(double, const Bag<int>&) { active = true; }
+		void delta_conf(const Bag<int>&) { count++; active = true; }
+		void output_func(Bag<int>& yb) { yb.insert(count); }
+		void gc_output(Bag<int>&){}
+		double ta() { return (active) ? delay : DBL_MAX; }
+		int getCount() const { return count; }
+	private:
+		double delay;
+		bool active;
+		int count;
+};
+
+template <class S> int run_ring(int size)
+{
+	SimpleDigraph<int>* ring = new SimpleDigraph<int>();
+	std::vector<relay*> nodes;
+	for (int i = 0; i < size; i++)
+	{
+		nodes.push_back(new relay(1.0+(double)(i%3),i%4==0));
+		ring->add(nodes.back());
+	}
+	for (int i = 0; i < size; i++)
+		ring->couple(nodes[i],nodes[(i+1)%size]);
+	Simulator<int,double,S>* sim = new Simulator<int,double,S>(ring);
+	sim->execUntil(500.0);
+	int total = 0;
+	for (int i = 0; i < size; i++)
+		total += nodes[i]->getCount();
+	delete sim;
+	delete ring;
+	return total;
+}
+
+int main ()
+{
+	test1<DaryHeapSchedule<char> >();
+	test1<DaryHeapSchedule<char,double,2> >();
+	test1<DaryHeapSchedule<char,double,8> >();
+	test2<DaryHeapSchedule<char> >();
+	test2<DaryHeapSchedule<char,double,8> >();
+	test3<DaryHeapSchedule<char> >();
+	test3<DaryHeapSchedule<char,double,8> >();
+	test4<Schedule<char> >();
+	test4<DaryHeapSchedule<char> >();
+	test4<DaryHeapSchedule<char,double,2> >();
+	test4<DaryHeapSchedule<char,double,8> >();
+	test4<CalendarSchedule<char> >();
+	int a = run_ring<Schedule<int> >(1000);
+	assert(a > 0);
+	assert(a == run_ring<DaryHeapSchedule<int> >(1000));
+	int b = run_ring<DaryHeapSchedule<int,double,8> >(1000);
+	assert(a == b);
+	return 0;
+}
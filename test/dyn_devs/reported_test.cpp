@@ -0,0 +1,137 @@
+#include <list>
+#include <vector>
+#include <iostream>
+#include "adevs.h"
+#include "SimpleAtomic.h"
+using namespace adevs;
+using namespace std;
+
+/**
+ * A network that adds and removes atomic models and networks at random.
+ * If report is true, then it reports these changes to the simulator
+ * instead of letting the simulator compare its component sets.
+ */
+class ReportingNetwork: public Network<SimpleIO>
+{
+	public:
+		ReportingNetwork(bool report, unsigned seed, int depth = 0):
+		Network<SimpleIO>(),
+		report(report),
+		depth(depth),
+		seed(seed)
+		{
+			int initial_count = random()%3+1;
+			for (int i = 0; i < initial_count; i++)
+			{
+				models.push_back(make_model());
+			}
+		}
+		void getComponents(Set<Devs<SimpleIO>*>& c)
+		{
+			c.insert(models.begin(),models.end());
+		}
+		void visitComponents(Network<SimpleIO>::ComponentVisitor* visitor)
+		{
+			list<Devs<SimpleIO>*>::iterator iter;
+			for (iter = models.begin(); iter != models.end(); iter++)
+			{
+				visitor->visit(*iter);
+			}
+		}
+		bool reportsStructureChanges() const { return report; }
+		void route(const SimpleIO&, Devs<SimpleIO>*, Bag<Event<SimpleIO> >&){}
+		bool model_transition()
+		{
+			int choice = random()%3;
+			if (choice == 0)
+			{
+				models.push_front(make_model());
+				if (report) addedComponent(models.front());
+				return true;
+			}
+			else if (choice == 2 && models.size() > 1)
+			{
+				if (report) removedComponent(models.back());
+				models.pop_back();
+				return true;
+			}
+			return false;
+		}
+		~ReportingNetwork()
+		{
+			list<Devs<SimpleIO>*>::iterator iter;
+			for (iter = models.begin(); iter != models.end(); iter++)
+			{
+				delete *iter;
+			}
+		}
+		/// Count the atomic models inside of this network
+		int count()
+		{
+			int n = 0;
+			list<Devs<SimpleIO>*>::iterator iter;
+			for (iter = models.begin(); iter != models.end(); iter++)
+			{
+				ReportingNetwork* net = dynamic_cast<ReportingNetwork*>(*iter);
+				if (net != NULL) n += net->count();
+				else n++;
+			}
+			return n;
+		}
+	private:
+		list<Devs<SimpleIO>*> models;
+		bool report;
+		int depth;
+		// Each network has its own random numbers so that the results
+		// do not depend on the order of the model transitions
+		unsigned seed;
+
+		int random()
+		{
+			seed = seed*1103515245+12345;
+			return (seed>>16)&0x7fff;
+		}
+
+		Devs<SimpleIO>* make_model()
+		{
+			Devs<SimpleIO>* model = NULL;
+			if (random()%2 == 0 || depth == 4)
+				model = new SimpleAtomic();
+			else
+				model = new ReportingNetwork(report,random(),depth+1);
+			model->setParent(this);
+			return model;
+		}
+};
+
+/// Run the model and return the number of atomic models after each step
+vector<int> run(bool report)
+{
+	vector<int> result;
+	ReportingNetwork* model = new ReportingNetwork(report,7);
+	Simulator<SimpleIO>* sim = new Simulator<SimpleIO>(model);
+	for (int i = 0; i < 200 && sim->nextEventTime() < DBL_MAX; i++)
+	{
+		int before = SimpleAtomic::atomic_number;
+		SimpleAtomic::internal_execs = 0;
+		sim->execNextEvent();
+		// Every model in the network had an event
+		assert(SimpleAtomic::internal_execs == before);
+		// The removed models were deleted
+		assert(model->count() == SimpleAtomic::atomic_number);
+		result.push_back(SimpleAtomic::atomic_number);
+	}
+	delete sim;
+	delete model;
+	assert(SimpleAtomic::atomic_number == 0);
+	return result;
+}
+
+int main()
+{
+	vector<int> a = run(false);
+	vector<int> b = run(true);
+	assert(a.size() == 200);
+	assert(a == b);
+	return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * Checks that the time of last event is set before the simulator asks for
+ * the time advance, whether or not the model functions are evaluated in
+ * parallel, and for models that are added by a structure change.
+ */
+#include "adevs.h"
+#include <vector>
+#include <cassert>
+using namespace adevs;
+
+/**
+ * Waits 0.5 before its first event and 2 after each of the others. If
+ * spawn is true, then it asks for a structure change at its second event.
+ */
+class pacer: public Atomic<int>
+{
+	public:
+		pacer(bool spawn = false):Atomic<int>(),spawn(spawn){}
+		void delta_int() { times.push_back(getLastEventTime()+ta_last); }
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>&){}
+		void gc_output(Bag<int>&){}
+		double ta()
+		{
+			ta_last = (getLastEventTime() == 0.0) ? 0.5 : 2.0;
+			return ta_last;
+		}
+		bool model_transition() { return spawn && times.size() == 2; }
+		std::vector<double> times;
+	private:
+		bool spawn;
+		double ta_last;
+};
+
+/// Adds two pacers when it is asked to change
+class nursery: public Network<int>
+{
+	public:
+		nursery():Network<int>()
+		{
+			for (int i = 0; i < 4; i++) add(new pacer(i == 0));
+		}
+		void getComponents(Set<Devs<int>*>& s)
+		{
+			s.insert(p.begin(),p.end());
+		}
+		void route(const int&, Devs<int>*, Bag<Event<int> >&){}
+		bool model_transition()
+		{
+			add(new pacer());
+			add(new pacer());
+			return false;
+		}
+		~nursery()
+		{
+			for (unsigned i = 0; i < p.size(); i++) delete p[i];
+		}
+		std::vector<pacer*> p;
+	private:
+		void add(pacer* model)
+		{
+			model->setParent(this);
+			p.push_back(model);
+		}
+};
+
+void test(bool parallel)
+{
+	nursery* model = new nursery();
+	Simulator<int>* sim = new Simulator<int>(model,parallel);
+	sim->execUntil(7.0);
+	assert(model->p.size() == 6);
+	for (unsigned i = 0; i < 4; i++)
+	{
+		assert(model->p[i]->times.size() == 4);
+		for (unsigned k = 0; k < 4; k++)
+			assert(model->p[i]->times[k] == 0.5+2.0*k);
+	}
+	// These were added at 2.5
+	for (unsigned i = 4; i < 6; i++)
+	{
+		assert(model->p[i]->times.size() == 2);
+		assert(model->p[i]->times[0] == 4.5);
+		assert(model->p[i]->times[1] == 6.5);
+	}
+	delete sim;
+	delete model;
+}
+
+int main()
+{
+	test(false);
+	test(true);
+	return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * Checks that a lookahead stops without an exception for models that can
+ * not save their state, and that beginLookahead is called at most once
+ * for a model that does not say so.
+ */
+#include "adevs.h"
+#include <cassert>
+using namespace adevs;
+
+/// A logical process that has no others to talk to
+class lone_lp: public AbstractLogicalProcess<int>
+{
+	public:
+		int getID() const { return 0; }
+		void notifyInput(Atomic<int>*, int&){}
+};
+
+/// Counts its internal events and can save that count
+class saver: public Atomic<int>
+{
+	public:
+		saver(double period):Atomic<int>(),period(period),count(0),saved(0){}
+		void delta_int() { count++; }
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>&){}
+		void gc_output(Bag<int>&){}
+		double ta() { return period; }
+		void beginLookahead() { saved = count; }
+		void endLookahead() { count = saved; }
+		int getCount() const { return count; }
+	private:
+		double period;
+		int count, saved;
+};
+
+/**
+ * Can not save its state. If refuse is true, then it says so with
+ * supportsLookahead. Otherwise it only throws from beginLookahead.
+ * Having saved nothing, it must not be asked to restore anything.
+ */
+class no_saver: public saver
+{
+	public:
+		no_saver(double period, bool refuse):
+			saver(period),refuse(refuse),begins(0),ends(0){}
+		void beginLookahead()
+		{
+			begins++;
+			Atomic<int>::beginLookahead();
+		}
+		void endLookahead() { ends++; }
+		bool supportsLookahead() { return !refuse; }
+		int getBegins() const { return begins; }
+		int getEnds() const { return ends; }
+	private:
+		bool refuse;
+		int begins, ends;
+};
+
+/// The state saving models can be looked ahead as far as needed
+void test_saver()
+{
+	lone_lp lp;
+	Simulator<int> sim(&lp);
+	saver* a = new saver(1.0);
+	sim.addModel(a);
+	sim.beginLookahead();
+	for (int i = 0; i < 3; i++)
+		assert(sim.tryLookNextEvent());
+	assert(a->getCount() == 3);
+	sim.endLookahead();
+	assert(a->getCount() == 0);
+	assert(sim.nextEventTime() == 1.0);
+	delete a;
+}
+
+/// A lookahead stops at the first event of a model that can not save
+void test_no_saver(bool refuse)
+{
+	lone_lp lp;
+	Simulator<int> sim(&lp);
+	saver* a = new saver(1.0);
+	no_saver* b = new no_saver(2.0,refuse);
+	sim.addModel(a);
+	sim.addModel(b);
+	for (int round = 0; round < 3; round++)
+	{
+		sim.beginLookahead();
+		assert(sim.tryLookNextEvent());
+		assert(!sim.tryLookNextEvent());
+		sim.endLookahead();
+		assert(a->getCount() == 0 && b->getCount() == 0);
+		assert(sim.nextEventTime() == 1.0);
+	}
+	// The exception is still thrown by lookNextEvent
+	bool thrown = false;
+	sim.beginLookahead();
+	sim.lookNextEvent();
+	try
+	{
+		sim.lookNextEvent();
+	}
+	catch(lookahead_impossible_exception&)
+	{
+		thrown = true;
+	}
+	sim.endLookahead();
+	assert(thrown);
+	// Only the model that does not say is asked, and only once
+	assert(b->getBegins() == (refuse ? 0 : 1));
+	assert(b->getEnds() == 0);
+	// The models simulate as usual
+	sim.execUntil(10.0);
+	assert(a->getCount() == 10 && b->getCount() == 5);
+	delete a;
+	delete b;
+}
+
+int main()
+{
+	test_saver();
+	test_no_saver(true);
+	test_no_saver(false);
+	return 0;
+}
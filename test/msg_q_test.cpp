@@ -0,0 +1,95 @@
+/**
+ * Tests for the MessageQ that carries messages between logical processes.
+ */
+#include "adevs.h"
+#include "adevs_message_q.h"
+#include <vector>
+#include <cassert>
+#include <omp.h>
+using namespace adevs;
+
+/// Messages from one sender come out in order and blocks are recycled
+void test1()
+{
+	MessageQ<int> q(3);
+	assert(q.empty());
+	for (int k = 0; k < 1000; k++)
+	{
+		for (int src = 0; src < 3; src++)
+		{
+			Message<int> msg(k);
+			msg.src = src;
+			msg.seq = k;
+			msg.type = Message<int>::OUTPUT;
+			q.insert(msg);
+		}
+	}
+	std::vector<int> last(3,-1);
+	int count = 0;
+	while (!q.empty())
+	{
+		Message<int> msg(q.remove());
+		assert(msg.value == (int)msg.seq);
+		assert(last[msg.src]+1 == msg.value);
+		last[msg.src] = msg.value;
+		count++;
+	}
+	assert(count == 3000);
+	assert(q.getStats().received == 3000);
+	assert(q.getStats().batches == 1);
+	assert(q.getStats().max_depth == 3000);
+	// The queue can be used again after it is drained
+	Message<int> msg(7);
+	msg.src = 1;
+	q.insert(msg);
+	assert(!q.empty());
+	assert(q.remove().value == 7);
+	assert(q.empty());
+	assert(q.getStats().batches == 2);
+}
+
+/// Many threads send to one receiver while it drains the queue
+void test2()
+{
+	const int senders = 4, per_sender = 100000;
+	MessageQ<int> q(senders+1);
+	std::vector<int> last(senders,-1);
+	int count = 0;
+	#pragma omp parallel num_threads(senders+1)
+	{
+		int id = omp_get_thread_num();
+		if (id < senders)
+		{
+			for (int k = 0; k < per_sender; k++)
+			{
+				Message<int> msg(k);
+				msg.src = id;
+				q.insert(msg);
+			}
+		}
+		else
+		{
+			while (count < senders*per_sender)
+			{
+				while (!q.empty())
+				{
+					Message<int> msg(q.remove());
+					assert(last[msg.src]+1 == msg.value);
+					last[msg.src] = msg.value;
+					count++;
+				}
+			}
+		}
+	}
+	assert(q.empty());
+	for (int i = 0; i < senders; i++)
+		assert(last[i] == per_sender-1);
+	assert(q.getStats().received == (unsigned)(senders*per_sender));
+}
+
+int main()
+{
+	test1();
+	test2();
+	return 0;
+}
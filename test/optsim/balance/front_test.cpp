@@ -0,0 +1,107 @@
+/**
+ * Runs a fire front along a line of cells with the ParSimulator, moving the
+ * burning cells between threads as the front moves, and checks that the
+ * results are those of the sequential simulator.
+ */
+#include "adevs.h"
+#include <omp.h>
+#include <vector>
+#include <cassert>
+#include <iostream>
+using namespace adevs;
+using namespace std;
+
+const double TICK = 0.05;
+const int BURN_TICKS = 80;
+const int SPARK_TICK = 5;
+
+/**
+ * A cell that is lit burns for BURN_TICKS ticks, and after SPARK_TICK
+ * ticks it lights the next cell.
+ */
+class cell: public Atomic<int>
+{
+	public:
+		cell(int id):Atomic<int>(),id(id),ticks(0),t(0.0),lit(-1.0)
+		{
+			if (id == 0) light();
+		}
+		void delta_int()
+		{
+			t += TICK;
+			ticks--;
+		}
+		void delta_ext(double e, const Bag<int>&)
+		{
+			t += e;
+			if (lit < 0.0) light();
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb)
+		{
+			if (ticks == BURN_TICKS-SPARK_TICK+1) yb.insert(id);
+		}
+		void gc_output(Bag<int>&){}
+		double ta() { return (ticks > 0) ? TICK : DBL_MAX; }
+		double lookahead() { return TICK; }
+		double getLit() const { return lit; }
+	private:
+		int id, ticks;
+		double t, lit;
+		void light()
+		{
+			lit = t;
+			ticks = BURN_TICKS;
+		}
+};
+
+const int CELLS = 200;
+
+vector<double> run(bool parallel)
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	vector<cell*> c;
+	for (int i = 0; i < CELLS; i++)
+	{
+		c.push_back(new cell(i));
+		model->add(c.back());
+		if (i > 0) model->couple(c[i-1],c[i]);
+	}
+	if (parallel)
+	{
+		ParSimulator<int> sim(model);
+		sim.setLoadBalancing(2.0);
+		sim.execUntil(25.0);
+		sim.execUntil(100.0);
+		unsigned long arrivals = 0;
+		for (int i = 0; i < omp_get_max_threads(); i++)
+			arrivals += sim.getLpStats(i).arrivals;
+		cout << "rebalanced " << sim.getRebalanceCount() << " times, moved "
+			<< arrivals << " models" << endl;
+		if (omp_get_max_threads() > 1)
+			assert(sim.getRebalanceCount() > 0 && arrivals > 0);
+	}
+	else
+	{
+		Simulator<int> sim(model);
+		sim.execUntil(100.0);
+	}
+	vector<double> result;
+	for (int i = 0; i < CELLS; i++)
+		result.push_back(c[i]->getLit());
+	delete model;
+	return result;
+}
+
+int main()
+{
+	vector<double> seq = run(false);
+	for (int i = 0; i < CELLS; i++)
+		assert(seq[i] >= 0.0);
+	assert(seq == run(true));
+	return 0;
+}
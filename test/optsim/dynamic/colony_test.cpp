@@ -0,0 +1,301 @@
+/**
+ * Runs colonies of agents that are born and die with the ParSimulator. Each
+ * colony belongs to a thread and changes its structure as it runs. The
+ * colonies send input to each other through the network that holds them,
+ * which adds and removes colonies when the threads stop. The results must
+ * be those of the sequential simulator.
+ */
+#include "adevs.h"
+#include <omp.h>
+#include <vector>
+#include <cassert>
+#include <iostream>
+using namespace adevs;
+using namespace std;
+
+const double TICK = 0.25;
+const unsigned MAX_AGENTS = 8;
+
+/**
+ * An agent says its id at every tick and adds up its input, weighted
+ * by its age. It dies when it reaches the end of its life, and until
+ * then it asks for a child every fourth tick.
+ */
+class agent: public Atomic<int>
+{
+	public:
+		agent(int id, int life):Atomic<int>(),id(id),life(life),age(0),sum(0)
+		{
+			live++;
+		}
+		void delta_int() { age++; }
+		void delta_ext(double, const Bag<int>& xb)
+		{
+			for (Bag<int>::const_iterator iter = xb.begin(); iter != xb.end(); iter++)
+				sum += (*iter)*(age+1);
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb) { yb.insert(id); }
+		void gc_output(Bag<int>&){}
+		double ta() { return TICK; }
+		double lookahead() { return TICK; }
+		bool model_transition() { return dead() || spawning(); }
+		bool dead() const { return age >= life; }
+		bool spawning() const { return age > 0 && age%4 == 0 && !dead(); }
+		long getSum() const { return sum; }
+		~agent() { live--; }
+		static int live;
+	private:
+		int id, life, age;
+		long sum;
+};
+
+int agent::live = 0;
+
+/// A colony sends its input to all of its agents
+class colony: public Network<int>
+{
+	public:
+		colony(int id):Network<int>(),id(id),seed(id*7+1),born(0),total(0)
+		{
+			for (int i = 0; i < 3; i++) agents.push_back(spawn());
+		}
+		void getComponents(Set<Devs<int>*>& c)
+		{
+			c.insert(agents.begin(),agents.end());
+		}
+		void route(const int& x, Devs<int>* model, Bag<Event<int> >& r)
+		{
+			if (model == this)
+			{
+				for (unsigned i = 0; i < agents.size(); i++)
+					r.insert(Event<int>(agents[i],x));
+			}
+			else r.insert(Event<int>(this,x));
+		}
+		bool model_transition()
+		{
+			// The simulator deletes the agents that are taken out
+			vector<agent*> keep;
+			int children = 0;
+			for (unsigned i = 0; i < agents.size(); i++)
+			{
+				if (agents[i]->dead()) total += agents[i]->getSum();
+				else
+				{
+					keep.push_back(agents[i]);
+					if (agents[i]->spawning()) children++;
+				}
+			}
+			for (; children > 0 && keep.size() < MAX_AGENTS; children--)
+				keep.push_back(spawn());
+			agents.swap(keep);
+			return false;
+		}
+		double lookahead() { return TICK; }
+		/// The input added up by the agents that lived here
+		long getTotal() const
+		{
+			long t = total;
+			for (unsigned i = 0; i < agents.size(); i++)
+				t += agents[i]->getSum();
+			return t;
+		}
+		unsigned getSize() const { return agents.size(); }
+		int getID() const { return id; }
+		~colony()
+		{
+			for (unsigned i = 0; i < agents.size(); i++)
+				delete agents[i];
+		}
+	private:
+		int id;
+		unsigned seed;
+		int born;
+		long total;
+		vector<agent*> agents;
+		agent* spawn()
+		{
+			seed = seed*1103515245+12345;
+			agent* a = new agent(id*1000+(born++),6+((seed>>16)&0x7fff)%20);
+			a->setParent(this);
+			return a;
+		}
+};
+
+/// Asks for a change to the world at every stop
+class ticker: public Atomic<int>
+{
+	public:
+		ticker():Atomic<int>(){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>&){}
+		void gc_output(Bag<int>&){}
+		double ta() { return 5.0; }
+		double lookahead() { return TICK; }
+		bool model_transition() { return true; }
+};
+
+/**
+ * Does nothing. The world adds one without a thread with each colony
+ * and says that the colony is coupled to it.
+ */
+class watcher: public Atomic<int>
+{
+	public:
+		watcher(int home):Atomic<int>(),home(home){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>&){}
+		void gc_output(Bag<int>&){}
+		double ta() { return adevs_inf<double>(); }
+		double lookahead() { return TICK; }
+		int getHome() const { return home; }
+	private:
+		int home;
+};
+
+/**
+ * The world sends the output of each colony to the next one. It adds
+ * a colony at two of every three of its changes and removes the oldest
+ * at the third. Each colony is given to a thread, and the watchers are
+ * left for the simulator to place. A watcher that is added at a stop
+ * must be put with its colony.
+ */
+class world: public Network<int>
+{
+	public:
+		world(int threads):Network<int>(),threads(threads),made(0),changes(0),
+			retired(0)
+		{
+			c = new ticker();
+			c->setParent(this);
+			for (int i = 0; i < 4; i++) add_colony();
+		}
+		void getComponents(Set<Devs<int>*>& s)
+		{
+			s.insert(c);
+			s.insert(colonies.begin(),colonies.end());
+			s.insert(watchers.begin(),watchers.end());
+		}
+		void route(const int& x, Devs<int>* model, Bag<Event<int> >& r)
+		{
+			for (unsigned k = 0; k < colonies.size(); k++)
+			{
+				if (colonies[k] == model)
+				{
+					r.insert(Event<int>(colonies[(k+1)%colonies.size()],x));
+					return;
+				}
+			}
+		}
+		bool visitCouplings(CouplingVisitor* v)
+		{
+			for (unsigned k = 0; k < colonies.size(); k++)
+			{
+				v->visit(colonies[k],colonies[(k+1)%colonies.size()]);
+				for (unsigned j = 0; j < watchers.size(); j++)
+				{
+					if (watchers[j]->getHome() == colonies[k]->getID())
+						v->visit(colonies[k],watchers[j]);
+				}
+			}
+			return true;
+		}
+		bool model_transition()
+		{
+			if (++changes%3 == 0)
+			{
+				retired += colonies.front()->getTotal();
+				colonies.erase(colonies.begin());
+			}
+			else add_colony();
+			return false;
+		}
+		vector<long> result() const
+		{
+			vector<long> r(1,retired);
+			for (unsigned k = 0; k < colonies.size(); k++)
+			{
+				r.push_back(colonies[k]->getID());
+				r.push_back(colonies[k]->getSize());
+				r.push_back(colonies[k]->getTotal());
+			}
+			return r;
+		}
+		int getChanges() const { return changes; }
+		/// True if the watchers added at the stops are with their colonies
+		bool placed() const
+		{
+			// The first four were placed with the model
+			for (unsigned k = 4; k < watchers.size(); k++)
+			{
+				if (watchers[k]->getProc() != watchers[k]->getHome()%threads)
+					return false;
+			}
+			return true;
+		}
+		~world()
+		{
+			delete c;
+			for (unsigned k = 0; k < colonies.size(); k++)
+				delete colonies[k];
+			for (unsigned k = 0; k < watchers.size(); k++)
+				delete watchers[k];
+		}
+	private:
+		int threads, made, changes;
+		long retired;
+		ticker* c;
+		vector<colony*> colonies;
+		vector<watcher*> watchers;
+		void add_colony()
+		{
+			watcher* w = new watcher(made);
+			w->setParent(this);
+			watchers.push_back(w);
+			colony* n = new colony(made);
+			n->setProc(made%threads);
+			n->setParent(this);
+			colonies.push_back(n);
+			made++;
+		}
+};
+
+vector<long> run(bool parallel)
+{
+	world* model = new world(omp_get_max_threads());
+	AbstractSimulator<int>* sim;
+	if (parallel) sim = new ParSimulator<int>(model);
+	else sim = new Simulator<int>(model);
+	for (int k = 1; k <= 6; k++)
+	{
+		if (parallel) dynamic_cast<ParSimulator<int>*>(sim)->execUntil(5.0*k);
+		else dynamic_cast<Simulator<int>*>(sim)->execUntil(5.0*k);
+	}
+	assert(model->getChanges() == 6);
+	assert(!parallel || model->placed());
+	vector<long> result(model->result());
+	result.push_back(agent::live);
+	delete sim;
+	delete model;
+	assert(agent::live == 0);
+	return result;
+}
+
+int main()
+{
+	vector<long> seq = run(false);
+	vector<long> par = run(true);
+	cout << "colonies " << (seq.size()-2)/3 << ", agents " << seq.back() << endl;
+	assert(seq.back() > 0);
+	assert(seq == par);
+	return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * Runs a line of servers, whose lookahead grows while they are busy, with
+ * the ParSimulator and checks that the results are those of the sequential
+ * simulator with and without the state dependent lookahead.
+ */
+#include "adevs.h"
+#include <omp.h>
+#include <list>
+#include <vector>
+#include <cassert>
+#include <iostream>
+using namespace adevs;
+using namespace std;
+
+const double MIN_SERVICE = 0.1;
+
+/// Produces a job every unit of time
+class genr: public Atomic<int>
+{
+	public:
+		genr(int count):Atomic<int>(),count(count),n(0){}
+		void delta_int() { n++; }
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>& yb) { yb.insert(n); }
+		void gc_output(Bag<int>&){}
+		double ta() { return (n < count) ? 1.0 : DBL_MAX; }
+		double lookahead() { return 1.0; }
+	private:
+		int count, n;
+};
+
+/**
+ * Serves its jobs one at a time. The service time of a job depends on
+ * the job and is at least MIN_SERVICE.
+ */
+class server: public Atomic<int>
+{
+	public:
+		server(int id):Atomic<int>(),id(id),sigma(DBL_MAX){}
+		void delta_int()
+		{
+			q.pop_front();
+			sigma = (q.empty()) ? DBL_MAX : service(q.front());
+		}
+		void delta_ext(double e, const Bag<int>& xb)
+		{
+			if (!q.empty()) sigma -= e;
+			for (Bag<int>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				q.push_back(*iter);
+			if (sigma == DBL_MAX) sigma = service(q.front());
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb) { yb.insert(q.front()); }
+		void gc_output(Bag<int>&){}
+		double ta() { return sigma; }
+		double lookahead() { return MIN_SERVICE; }
+		/**
+		 * A new job waits for the jobs that are already here, and so
+		 * the first output that it can cause follows all of their
+		 * service times.
+		 */
+		double currentLookahead()
+		{
+			if (!dynamic) return 0.0;
+			if (q.empty()) return lookahead();
+			double work = sigma;
+			list<int>::iterator iter = q.begin();
+			for (iter++; iter != q.end(); iter++)
+				work += service(*iter);
+			return work+MIN_SERVICE;
+		}
+		static bool dynamic;
+	private:
+		int id;
+		list<int> q;
+		double sigma;
+		double service(int job) const
+		{
+			return MIN_SERVICE+(double)((job*7+id*3)%16)*0.125;
+		}
+};
+
+bool server::dynamic = false;
+
+/// Records the time and value of each job that it gets
+class sink: public Atomic<int>
+{
+	public:
+		sink():Atomic<int>(),t(0.0){}
+		void delta_int(){}
+		void delta_ext(double e, const Bag<int>& xb)
+		{
+			t += e;
+			for (Bag<int>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				got.push_back(pair<double,int>(t,*iter));
+		}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>&){}
+		void gc_output(Bag<int>&){}
+		double ta() { return DBL_MAX; }
+		double lookahead() { return 1.0; }
+		vector<pair<double,int> > got;
+	private:
+		double t;
+};
+
+const int SERVERS = 24;
+const int JOBS = 200;
+
+SimpleDigraph<int>* make_line(sink*& s)
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	Devs<int>* prev = new genr(JOBS);
+	model->add(prev);
+	for (int i = 0; i < SERVERS; i++)
+	{
+		server* next = new server(i);
+		model->add(next);
+		model->couple(prev,next);
+		prev = next;
+	}
+	s = new sink();
+	model->add(s);
+	model->couple(prev,s);
+	return model;
+}
+
+vector<pair<double,int> > run(bool parallel, unsigned long& nulls)
+{
+	sink* s;
+	SimpleDigraph<int>* model = make_line(s);
+	nulls = 0;
+	if (parallel)
+	{
+		ParSimulator<int> sim(model);
+		sim.execUntil(1000.0);
+		for (int i = 0; i < omp_get_max_threads(); i++)
+			nulls += sim.getLpStats(i).nulls;
+	}
+	else
+	{
+		Simulator<int> sim(model);
+		sim.execUntil(1000.0);
+	}
+	vector<pair<double,int> > result(s->got);
+	delete model;
+	return result;
+}
+
+int main()
+{
+	unsigned long static_nulls, dynamic_nulls;
+	vector<pair<double,int> > seq = run(false,static_nulls);
+	assert(seq.size() == JOBS);
+	assert(seq == run(true,static_nulls));
+	server::dynamic = true;
+	assert(seq == run(true,dynamic_nulls));
+	cout << "null messages: static " << static_nulls << ", dynamic "
+		<< dynamic_nulls << endl;
+	return 0;
+}
@@ -0,0 +1,122 @@
+#ifndef __pipeline_h_
+#define __pipeline_h_
+/**
+ * A generator followed by a line of stages and a sink. Each stage
+ * changes the numbers that it gets and passes them on after a delay.
+ */
+#include "adevs.h"
+#include <list>
+#include <vector>
+using namespace adevs;
+using namespace std;
+
+/// Produces a number every unit of time
+class genr: public Atomic<int>
+{
+	public:
+		genr(int count):Atomic<int>(),count(count),n(0){}
+		void delta_int() { n++; }
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>& yb) { yb.insert(n); }
+		void gc_output(Bag<int>&){}
+		double ta() { return (n < count) ? 1.0 : DBL_MAX; }
+		double lookahead() { return 1.0; }
+	private:
+		int count, n;
+};
+
+/// Changes each number and passes it on after a delay
+class stage: public Atomic<int>
+{
+	public:
+		stage():Atomic<int>(),sigma(DBL_MAX){}
+		void delta_int()
+		{
+			q.pop_front();
+			elapse(sigma);
+		}
+		void delta_ext(double e, const Bag<int>& xb)
+		{
+			elapse(e);
+			for (Bag<int>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				q.push_back(pair<double,int>(0.5,(*iter)*3+1));
+			sigma = q.front().first;
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb) { yb.insert(q.front().second); }
+		void gc_output(Bag<int>&){}
+		double ta() { return sigma; }
+		double lookahead() { return 0.5; }
+	private:
+		list<pair<double,int> > q;
+		double sigma;
+		void elapse(double e)
+		{
+			for (list<pair<double,int> >::iterator iter = q.begin();
+				iter != q.end(); iter++)
+				(*iter).first -= e;
+			sigma = (q.empty()) ? DBL_MAX : q.front().first;
+		}
+};
+
+/// Records the time and value of each number that it gets
+class sink: public Atomic<int>
+{
+	public:
+		sink():Atomic<int>(),t(0.0){}
+		void delta_int(){}
+		void delta_ext(double e, const Bag<int>& xb)
+		{
+			t += e;
+			for (Bag<int>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				got.push_back(pair<double,int>(t,*iter));
+		}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>&){}
+		void gc_output(Bag<int>&){}
+		double ta() { return DBL_MAX; }
+		double lookahead() { return 1.0; }
+		vector<pair<double,int> > got;
+	private:
+		double t;
+};
+
+SimpleDigraph<int>* make_pipeline(sink*& s, int stages = 40)
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	Devs<int>* prev = new genr(50);
+	model->add(prev);
+	for (int i = 0; i < stages; i++)
+	{
+		stage* next = new stage();
+		model->add(next);
+		model->couple(prev,next);
+		prev = next;
+	}
+	s = new sink();
+	model->add(s);
+	model->couple(prev,s);
+	return model;
+}
+
+vector<pair<double,int> > run_seq(int stages = 40)
+{
+	sink* s;
+	SimpleDigraph<int>* model = make_pipeline(s,stages);
+	Simulator<int> sim(model);
+	sim.execUntil(100.0);
+	vector<pair<double,int> > result(s->got);
+	delete model;
+	return result;
+}
+
+/// Run in parallel and return the number of messages that were received
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * Runs a pipeline with the ParSimulator using the processor graph that
+ * is derived from the couplings, and checks that the results are those
+ * of the sequential simulator and that fewer null messages are sent than
+ * with an all to all graph.
+ */
+#include "pipeline.h"
+#include <omp.h>
+#include <cassert>
+#include <iostream>
+
+unsigned long run_par(vector<pair<double,int> >& result, bool all_to_all)
+{
+	sink* s;
+	SimpleDigraph<int>* model = make_pipeline(s);
+	ParSimulator<int>* sim;
+	int lp_count = omp_get_max_threads();
+	if (all_to_all)
+	{
+		// Assign the models as the default constructor does
+		Partitioner<int> partitioner(model);
+		LpGraph g;
+		partitioner.partition(lp_count,g);
+		g = LpGraph(lp_count);
+		for (int i = 0; i < lp_count; i++)
+		{
+			for (int j = 0; j < lp_count; j++)
+			{
+				if (i != j) g.addEdge(i,j);
+			}
+		}
+		sim = new ParSimulator<int>(model,g);
+	}
+	else sim = new ParSimulator<int>(model);
+	sim->execUntil(100.0);
+	unsigned long received = 0, sent = 0;
+	for (int i = 0; i < lp_count; i++)
+	{
+		const LpStats& stats = sim->getLpStats(i);
+		received += sim->getQueueStats(i).received;
+		sent += stats.outputs+stats.nulls;
+	}
+	// Requests for null messages are not sent through the queues
+	assert(sent == received);
+	result = s->got;
+	delete sim;
+	delete model;
+	return received;
+}
+
+int main()
+{
+	vector<pair<double,int> > seq = run_seq(), par, all;
+	assert(seq.size() == 50);
+	unsigned long derived = run_par(par,false);
+	unsigned long all_msgs = run_par(all,true);
+	assert(seq == par);
+	assert(seq == all);
+	cout << "derived " << derived << ", all to all " << all_msgs << endl;
+	if (omp_get_max_threads() > 2) assert(derived < all_msgs);
+	// A single thread has one logical process and no messages
+	int threads = omp_get_max_threads();
+	omp_set_num_threads(1);
+	assert(run_par(par,false) == 0);
+	assert(seq == par);
+	omp_set_num_threads(threads);
+	return 0;
+}
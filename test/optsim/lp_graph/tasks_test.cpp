@@ -0,0 +1,42 @@
+/**
+ * Runs a pipeline with the ParSimulator using more logical processes than
+ * threads and checks that the results are those of the sequential
+ * simulator.
+ */
+#include "pipeline.h"
+#include <omp.h>
+#include <cassert>
+#include <iostream>
+
+const int STAGES = 100;
+
+vector<pair<double,int> > run_tasks(int lp_count)
+{
+	sink* s;
+	SimpleDigraph<int>* model = make_pipeline(s,STAGES);
+	Partitioner<int> partitioner(model);
+	LpGraph g;
+	partitioner.partition(lp_count,g);
+	ParSimulator<int>* sim = new ParSimulator<int>(model,g);
+	// Stop and start again
+	sim->execUntil(20.0);
+	sim->execUntil(100.0);
+	vector<pair<double,int> > result(s->got);
+	delete sim;
+	delete model;
+	return result;
+}
+
+int main()
+{
+	vector<pair<double,int> > seq = run_seq(STAGES);
+	assert(seq.size() == 50);
+	int lp_count[] = { 2, 5, 16, 64 };
+	for (int i = 0; i < 4; i++)
+	{
+		assert(run_tasks(lp_count[i]) == seq);
+		cout << lp_count[i] << " processes on " << omp_get_max_threads()
+			<< " threads" << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,31 @@
+/**
+ * The generator, delay, and counter of the gcd tests on their own
+ * processors and simulated by the Time Warp simulator.
+ */
+#include <iostream>
+#include "adevs.h"
+#include "../gcd/state_saving_models.h"
+#include "../gcd/Listener.h"
+using namespace std;
+
+int main() 
+{
+	cout << "Test 1" << endl;
+	adevs::Digraph<object*>* model = new adevs::Digraph<object*>();
+	genr* g = new genrWithStateSaving(10.0,1,true);
+	delay* d = new delayWithStateSaving(2.0);
+	counter* c = new counterWithStateSaving();
+	model->add(g);
+	model->add(d);
+	model->add(c);
+	model->couple(g,g->signal,d,d->in);
+	model->couple(d,d->out,c,c->in);
+	adevs::OptSimulator<PortValue>* sim =
+		new adevs::OptSimulator<PortValue>(model);
+	sim->addEventListener(new Listener());
+	sim->execUntil(100.0);
+	cout << "Test done" << endl;
+	delete sim;
+	delete model;
+	return 0;
+}
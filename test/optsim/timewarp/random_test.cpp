@@ -0,0 +1,202 @@
+/**
+ * Nodes on different processors send messages to each other at random.
+ * The committed state trajectories from the Time Warp simulator must
+ * match those from the sequential simulator.
+ */
+#include "adevs.h"
+#include <vector>
+#include <cassert>
+#include <omp.h>
+using namespace adevs;
+using namespace std;
+
+typedef PortValue<int> IO;
+
+class node: public Atomic<IO>
+{
+	public:
+		/// Sample of the state that is given to the listener
+		struct sample_t
+		{
+			double t;
+			int count;
+			long sum;
+			bool operator==(const sample_t& other) const
+			{
+				return t == other.t && count == other.count && sum == other.sum;
+			}
+		};
+		node(int id, int n):
+			Atomic<IO>(),id(id),n(n),chkpt(NULL)
+		{
+			s.seed = id*7+1;
+			s.count = 0;
+			s.sum = 0;
+			s.t = 0.0;
+			draw();
+		}
+		void delta_int()
+		{
+			s.t += s.sigma;
+			draw();
+		}
+		void delta_ext(double e, const Bag<IO>& xb)
+		{
+			s.t += e;
+			s.sigma -= e;
+			for (Bag<IO>::const_iterator iter = xb.begin(); iter != xb.end(); iter++)
+			{
+				if ((*iter).value/n != id) continue;
+				s.count++;
+				s.sum += (*iter).value%n+1;
+			}
+			// Sometimes reply quickly to the input
+			if (random()%2 == 0)
+				s.sigma = 0.01+(double)(random())/32768.0;
+		}
+		void delta_conf(const Bag<IO>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<IO>& yb)
+		{
+			yb.insert(IO(0,s.dest*n+id));
+		}
+		double ta() { return s.sigma; }
+		void gc_output(Bag<IO>&){}
+		void beginLookahead()
+		{
+			assert(chkpt == NULL);
+			chkpt = new state_t(s);
+		}
+		void endLookahead()
+		{
+			s = *chkpt;
+			delete chkpt;
+			chkpt = NULL;
+		}
+		sample_t sample() const
+		{
+			sample_t x;
+			x.t = s.t;
+			x.count = s.count;
+			x.sum = s.sum;
+			return x;
+		}
+		vector<sample_t> trace;
+	private:
+		struct state_t
+		{
+			unsigned seed;
+			double sigma;
+			int dest;
+			int count;
+			long sum;
+			double t;
+		};
+		const int id, n;
+		state_t s;
+		state_t* chkpt;
+		int random()
+		{
+			s.seed = s.seed*1103515245+12345;
+			return (s.seed>>16)&0x7fff;
+		}
+		void draw()
+		{
+			s.dest = (id+1+random()%(n-1))%n;
+			s.sigma = 0.1+2.0*(double)(random())/32768.0;
+		}
+};
+
+/// A model that can not save its state
+class forgetful: public Atomic<IO>
+{
+	public:
+		forgetful():Atomic<IO>(){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<IO>&){}
+		void delta_conf(const Bag<IO>&){}
+		void output_func(Bag<IO>&){}
+		double ta() { return 1.0; }
+		void gc_output(Bag<IO>&){}
+};
+
+/// Records the committed states of the nodes
+class recorder: public EventListener<IO>
+{
+	public:
+		void outputEvent(Event<IO>, double){}
+		void stateChange(Atomic<IO>* model, double t)
+		{
+			node* a = dynamic_cast<node*>(model);
+			a->trace.push_back(a->sample());
+		}
+};
+
+const int N = 12;
+
+Digraph<int>* make_model(vector<node*>& nodes, int lp_count)
+{
+	Digraph<int>* model = new Digraph<int>();
+	for (int i = 0; i < N; i++)
+	{
+		nodes.push_back(new node(i,N));
+		nodes.back()->setProc(i%lp_count);
+		model->add(nodes.back());
+	}
+	for (int i = 0; i < N; i++)
+		for (int j = 0; j < N; j++)
+			if (i != j) model->couple(nodes[i],0,nodes[j],0);
+	return model;
+}
+
+int main()
+{
+	int lp_count = omp_get_max_threads();
+	recorder* r = new recorder();
+	// Sequential simulation
+	vector<node*> seq_nodes;
+	Digraph<int>* seq_model = make_model(seq_nodes,lp_count);
+	Simulator<IO>* seq_sim = new Simulator<IO>(seq_model);
+	seq_sim->addEventListener(r);
+	seq_sim->execUntil(100.0);
+	// Time Warp simulation that stops on the way
+	vector<node*> opt_nodes;
+	Digraph<int>* opt_model = make_model(opt_nodes,lp_count);
+	OptSimulator<IO>* opt_sim = new OptSimulator<IO>(opt_model);
+	opt_sim->addEventListener(r);
+	opt_sim->execUntil(50.0);
+	assert(opt_sim->nextEventTime() > 50.0);
+	opt_sim->setBatchSize(16);
+	opt_sim->execUntil(100.0);
+	assert(opt_sim->nextEventTime() == seq_sim->nextEventTime());
+	for (int i = 0; i < N; i++)
+	{
+		assert(seq_nodes[i]->trace.size() > 10);
+		assert(seq_nodes[i]->trace == opt_nodes[i]->trace);
+	}
+	delete seq_sim;
+	delete seq_model;
+	delete opt_sim;
+	delete opt_model;
+	// Models must be able to save their state
+	Digraph<int>* bad_model = new Digraph<int>();
+	bad_model->add(new forgetful());
+	OptSimulator<IO>* bad_sim = new OptSimulator<IO>(bad_model);
+	bool caught = false;
+	try
+	{
+		bad_sim->execUntil(10.0);
+	}
+	catch(adevs::exception&)
+	{
+		caught = true;
+	}
+	assert(caught);
+	delete bad_sim;
+	delete bad_model;
+	delete r;
+	return 0;
+}
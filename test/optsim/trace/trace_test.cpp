@@ -0,0 +1,162 @@
+/**
+ * Runs a ring of relays with a ChromeTracer and checks the counts that the
+ * logical processes report, the timeline that the tracer writes, and that
+ * the results are those of a run without the tracer.
+ */
+#include "adevs.h"
+#include <omp.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cassert>
+#include <iostream>
+using namespace adevs;
+using namespace std;
+
+struct relay_state
+{
+	int count;
+	long sum;
+	double sigma;
+};
+
+/**
+ * Sends its count every unit of time and adds up its input. A relay
+ * that can not save its state stops the lookahead.
+ */
+class relay: public StateSaver<relay,relay_state,Atomic<int> >
+{
+	public:
+		relay(int id, bool saves):
+			StateSaver<relay,relay_state,Atomic<int> >(),id(id),saves(saves)
+		{
+			s.count = s.sum = 0;
+			s.sigma = 1.0+0.01*id;
+		}
+		relay_state& getLookaheadState() { return s; }
+		bool supportsLookahead() { return saves; }
+		void beginLookahead()
+		{
+			assert(saves);
+			StateSaver<relay,relay_state,Atomic<int> >::beginLookahead();
+		}
+		void delta_int() { s.count++; s.sigma = 1.0; }
+		void delta_ext(double e, const Bag<int>& xb)
+		{
+			s.sigma -= e;
+			for (Bag<int>::const_iterator iter = xb.begin(); iter != xb.end(); iter++)
+				s.sum += (*iter)*(id+1);
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb) { yb.insert(s.count); }
+		void gc_output(Bag<int>&){}
+		double ta() { return s.sigma; }
+		double lookahead() { return 0.5; }
+		long getSum() const { return s.sum; }
+	private:
+		int id;
+		bool saves;
+		relay_state s;
+};
+
+/// Counts the spans in the JSON and checks that its brackets match
+unsigned check_json(const string& json)
+{
+	assert(json.find("{\"traceEvents\":[") == 0);
+	int depth = 0;
+	bool in_string = false;
+	for (unsigned i = 0; i < json.size(); i++)
+	{
+		if (json[i] == '"') in_string = !in_string;
+		else if (in_string) continue;
+		else if (json[i] == '{' || json[i] == '[') depth++;
+		else if (json[i] == '}' || json[i] == ']') assert(--depth >= 0);
+	}
+	assert(depth == 0 && !in_string);
+	unsigned spans = 0;
+	for (size_t k = json.find("\"ph\":\"X\""); k != string::npos;
+			k = json.find("\"ph\":\"X\"",k+1))
+		spans++;
+	return spans;
+}
+
+/**
+ * Run a ring of relays in stages with lp_count processes and return the
+ * sums of the relays. Each process has four relays and one of them can
+ * not save its state.
+ */
+vector<long> run(int lp_count, bool trace)
+{
+	const int N = 4*lp_count, STAGES = 4;
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	vector<relay*> r;
+	for (int i = 0; i < N; i++)
+	{
+		r.push_back(new relay(i,i/lp_count != 1));
+		r.back()->setProc(i%lp_count);
+		model->add(r.back());
+	}
+	LpGraph g;
+	for (int i = 0; i < N; i++)
+	{
+		model->couple(r[i],r[(i+1)%N]);
+		if (i%lp_count != (i+1)%lp_count)
+			g.addEdge(i%lp_count,(i+1)%lp_count);
+	}
+	ParSimulator<int>* sim = new ParSimulator<int>(model,g);
+	assert(sim->getLPCount() == lp_count);
+	ChromeTracer<> tracer;
+	if (trace) sim->setTracer(&tracer);
+	for (int k = 1; k <= STAGES; k++)
+		sim->execUntil(10.0*k);
+	if (trace)
+	{
+		unsigned long int spans = 0;
+		for (int i = 0; i < lp_count; i++)
+		{
+			const LpStats& stats = sim->getLpStats(i);
+			// Each relay has about ten events in a stage
+			assert(stats.events >= (unsigned)(STAGES*10*4));
+			assert(stats.lookaheads > 0);
+			assert(stats.lookahead_failures > 0);
+			assert(stats.lookahead_failures <= stats.lookaheads);
+			assert(stats.inputs > 0);
+			assert(tracer.getCount(i,LP_RUN) == STAGES);
+			assert(tracer.getCount(i,LP_LOOKAHEAD) == stats.lookaheads);
+			assert(tracer.getTime(i,LP_BLOCKED) >= 0.0);
+			assert(tracer.getTime(i,LP_EVENTS) <= tracer.getTime(i,LP_RUN));
+			spans += tracer.getCount(i,LP_RUN)+tracer.getCount(i,LP_EVENTS)+
+				tracer.getCount(i,LP_LOOKAHEAD)+tracer.getCount(i,LP_BLOCKED);
+		}
+		ostringstream json;
+		tracer.write(json);
+		assert(check_json(json.str()) == spans);
+		cout << lp_count << " processes, " << spans << " spans" << endl;
+		// The tracer can be turned off
+		sim->setTracer(NULL);
+		tracer.clear();
+		sim->execUntil(10.0*(STAGES+1));
+		assert(tracer.getCount(0,LP_RUN) == 0);
+	}
+	else sim->execUntil(10.0*(STAGES+1));
+	vector<long> result;
+	for (int i = 0; i < N; i++)
+		result.push_back(r[i]->getSum());
+	delete sim;
+	delete model;
+	return result;
+}
+
+int main()
+{
+	// A single process has nothing to look ahead of
+	int threads = max(2,omp_get_max_threads());
+	assert(run(threads,true) == run(threads,false));
+	// More processes than threads
+	assert(run(2*threads+1,true) == run(2*threads+1,false));
+	return 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * Runs tokens around a ring of relays, which can project their output,
+ * and a fire front along a line of cells, which can not, with the
+ * WindowSimulator and checks that the results are those of the
+ * sequential simulator.
+ */
+#include "adevs.h"
+#include <omp.h>
+#include <list>
+#include <vector>
+#include <cassert>
+#include <iostream>
+using namespace adevs;
+using namespace std;
+
+const double DELAY = 0.5;
+
+/**
+ * A relay sends each token that it receives to the next relay after a
+ * delay of at least DELAY. The delay depends on the token.
+ */
+class relay: public Atomic<int>
+{
+	public:
+		relay():Atomic<int>(),t(0.0),sum(0),count(0){}
+		void add(int token) { schedule(token); }
+		void delta_int()
+		{
+			t = q.front().first;
+			q.pop_front();
+		}
+		void delta_ext(double e, const Bag<int>& xb)
+		{
+			t += e;
+			for (Bag<int>::const_iterator iter = xb.begin(); iter != xb.end(); iter++)
+			{
+				sum += (*iter)*(++count);
+				schedule(*iter);
+			}
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb) { yb.insert(q.front().second); }
+		void gc_output(Bag<int>&){}
+		double ta() { return q.empty() ? DBL_MAX : q.front().first-t; }
+		double lookahead() { return DELAY; }
+		void beginLookahead()
+		{
+			saved_q = q;
+			saved_t = t;
+			saved_sum = sum;
+			saved_count = count;
+		}
+		void endLookahead()
+		{
+			q = saved_q;
+			t = saved_t;
+			sum = saved_sum;
+			count = saved_count;
+		}
+		long getSum() const { return sum; }
+	private:
+		double t, saved_t;
+		long sum, saved_sum;
+		int count, saved_count;
+		// Tokens and the times at which they leave, in order of time
+		list<pair<double,int> > q, saved_q;
+		void schedule(int token)
+		{
+			pair<double,int> p(t+DELAY+0.125*(token%4),token);
+			list<pair<double,int> >::iterator iter = q.begin();
+			while (iter != q.end() && !(p < *iter)) iter++;
+			q.insert(iter,p);
+		}
+};
+
+const int RELAYS = 48;
+const int LPS = 6;
+
+vector<long> run_ring(int mode)
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	vector<relay*> r;
+	for (int i = 0; i < RELAYS; i++)
+	{
+		r.push_back(new relay());
+		model->add(r.back());
+		if (i > 0) model->couple(r[i-1],r[i]);
+	}
+	model->couple(r.back(),r.front());
+	for (int k = 0; k < 12; k++)
+		r[(k*5)%RELAYS]->add(k);
+	AbstractSimulator<int>* sim;
+	if (mode == 0) sim = new Simulator<int>(model);
+	else if (mode == 1) sim = new WindowSimulator<int>(model);
+	else
+	{
+		// More processes than threads, each with a part of the ring
+		LpGraph g(LPS);
+		for (int i = 0; i < LPS; i++)
+			g.addEdge(i,(i+1)%LPS);
+		for (int i = 0; i < RELAYS; i++)
+			r[i]->setProc((i*LPS)/RELAYS);
+		sim = new WindowSimulator<int>(model,g);
+	}
+	sim->execUntil(40.0);
+	sim->execUntil(100.0);
+	if (mode != 0)
+	{
+		WindowSimulator<int>* wsim = dynamic_cast<WindowSimulator<int>*>(sim);
+		cout << "ring: " << wsim->getWindowCount() << " windows" << endl;
+		// A window holds many events
+		assert(wsim->getWindowCount() < 400);
+	}
+	vector<long> result;
+	for (int i = 0; i < RELAYS; i++)
+		result.push_back(r[i]->getSum());
+	delete sim;
+	delete model;
+	return result;
+}
+
+const double TICK = 0.05;
+const int BURN_TICKS = 20;
+const int SPARK_TICK = 5;
+
+/// A cell that is lit lights the next cell after SPARK_TICK ticks
+class cell: public Atomic<int>
+{
+	public:
+		cell(int id):Atomic<int>(),id(id),ticks(0),t(0.0),lit(-1.0)
+		{
+			if (id == 0) light();
+		}
+		void delta_int()
+		{
+			t += TICK;
+			ticks--;
+		}
+		void delta_ext(double e, const Bag<int>&)
+		{
+			t += e;
+			if (lit < 0.0) light();
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb)
+		{
+			if (ticks == BURN_TICKS-SPARK_TICK+1) yb.insert(id);
+		}
+		void gc_output(Bag<int>&){}
+		double ta() { return (ticks > 0) ? TICK : DBL_MAX; }
+		double lookahead() { return TICK; }
+		double getLit() const { return lit; }
+	private:
+		int id, ticks;
+		double t, lit;
+		void light()
+		{
+			lit = t;
+			ticks = BURN_TICKS;
+		}
+};
+
+const int CELLS = 40;
+
+vector<double> run_line(bool window)
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	vector<cell*> c;
+	for (int i = 0; i < CELLS; i++)
+	{
+		c.push_back(new cell(i));
+		model->add(c.back());
+		if (i > 0) model->couple(c[i-1],c[i]);
+	}
+	if (window)
+	{
+		WindowSimulator<int> sim(model);
+		sim.execUntil(100.0);
+	}
+	else
+	{
+		Simulator<int> sim(model);
+		sim.execUntil(100.0);
+	}
+	vector<double> result;
+	for (int i = 0; i < CELLS; i++)
+		result.push_back(c[i]->getLit());
+	delete model;
+	return result;
+}
+
+int main()
+{
+	vector<long> ring = run_ring(0);
+	assert(ring == run_ring(1));
+	assert(ring == run_ring(2));
+	vector<double> line = run_line(false);
+	assert(line.back() > 0.0);
+	assert(line == run_line(true));
+	return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * Checks that the Simulator gives the same answer, and notifies its
+ * listeners in the same order, whether or not the model functions are
+ * evaluated in parallel.
+ */
+#include "adevs.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+using namespace adevs;
+
+/**
+ * A cell that sums its inputs and sends the sum to its neighbours.
+ */
+class cell: public Atomic<int>
+{
+	public:
+		cell(int id):
+		Atomic<int>(),id(id),sum(id),phase(id%5){}
+		void delta_int() { phase = (phase+1)%5; sum++; }
+		void delta_ext(double, const Bag<int>& xb)
+		{
+			for (Bag<int>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				sum = (sum+*iter)%1000;
+		}
+		void delta_conf(const Bag<int>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<int>& yb)
+		{
+			if (sum < 0) throw adevs::exception("Bad sum",this);
+			yb.insert(sum);
+			if (phase == 0) yb.insert(id);
+		}
+		void gc_output(Bag<int>&){}
+		double ta() { return 1.0+(double)phase; }
+		/**
+		 * Cells are allocated in order from a fixed block of memory
+		 * so that the order of their addresses is the order in which
+		 * they were created.
+		 */
+		static void* operator new(size_t size)
+		{
+			static char* block = (char*)malloc(2000*sizeof(cell));
+			static size_t used = 0;
+			assert(used+size <= 2000*sizeof(cell));
+			used += size;
+			return block+used-size;
+		}
+		static void operator delete(void*){}
+		int getID() const { return id; }
+		int getSum() const { return sum; }
+		void setSum(int s) { sum = s; }
+	private:
+		int id, sum, phase;
+};
+
+/**
+ * Records everything that it is told.
+ */
+class recorder: public EventListener<int>
+{
+	public:
+		void outputEvent(Event<int> x, double t)
+		{
+			log << "y " << t << " " << static_cast<cell*>(x.model)->getID()
+				<< " " << x.value << "\n";
+		}
+		void stateChange(Atomic<int>* model, double t)
+		{
+			cell* c = static_cast<cell*>(model);
+			log << "s " << t << " " << c->getID() << " " << c->getSum() << "\n";
+		}
+		std::ostringstream log;
+};
+
+/**
+ * Build a ring of cells where each cell is coupled to the next
+ * three cells. The components are ordered by their addresses, and so
+ * the cells of the two rings are allocated together to give both
+ * rings the same order (see cell::operator new).
+ */
+void build(int size, SimpleDigraph<int>* model[2], std::vector<cell*> cells[2])
+{
+	for (int i = 0; i < size; i++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			cells[k].push_back(new cell(i));
+			model[k]->add(cells[k].back());
+		}
+	}
+	for (int k = 0; k < 2; k++)
+		for (int i = 0; i < size; i++)
+			for (int j = 1; j <= 3; j++)
+				model[k]->couple(cells[k][i],cells[k][(i+j)%size]);
+}
+
+/**
+ * Run a model and return the log of the run.
+ */
+std::string run(SimpleDigraph<int>* model, std::vector<cell*>& cells,
+	bool parallel)
+{
+	Simulator<int>* sim = new Simulator<int>(model);
+	sim->setParallel(parallel);
+	recorder* r = new recorder();
+	sim->addEventListener(r);
+	sim->execUntil(50.0);
+	std::ostringstream result;
+	result << r->log.str();
+	for (unsigned i = 0; i < cells.size(); i++)
+		result << cells[i]->getSum() << " ";
+	delete sim;
+	delete r;
+	delete model;
+	return result.str();
+}
+
+/**
+ * An exception raised by one thread must reach the caller.
+ */
+void test_exception()
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	std::vector<cell*> cells;
+	for (int i = 0; i < 100; i++)
+	{
+		cells.push_back(new cell(0));
+		model->add(cells.back());
+	}
+	cells[57]->setSum(-1);
+	Simulator<int>* sim = new Simulator<int>(model);
+	sim->setParallel(true);
+	bool caught = false;
+	try
+	{
+		sim->execNextEvent();
+	}
+	catch(adevs::exception& err)
+	{
+		caught = true;
+		assert(err.who() == cells[57]);
+	}
+	assert(caught);
+	delete sim;
+	delete model;
+}
+
+int main()
+{
+#ifdef _OPENMP
+	omp_set_num_threads(4);
+#endif
+	SimpleDigraph<int>* model[2];
+	std::vector<cell*> cells[2];
+	model[0] = new SimpleDigraph<int>();
+	model[1] = new SimpleDigraph<int>();
+	build(500,model,cells);
+	std::string seq = run(model[0],cells[0],false);
+	std::string par = run(model[1],cells[1],true);
+	assert(seq == par);
+	test_exception();
+	std::cout << "Test passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * Checks the assignment of models to processors by the Partitioner.
+ */
+#include "adevs.h"
+#include <vector>
+#include <cassert>
+#include <algorithm>
+using namespace adevs;
+
+typedef PortValue<int,int> IO;
+
+/// An atomic model that changes state once every period
+class node: public Atomic<int>
+{
+	public:
+		node(double period = 1.0):Atomic<int>(),period(period){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>& yb) { yb.insert(0); }
+		void gc_output(Bag<int>&){}
+		double ta() { return period; }
+	private:
+		double period;
+};
+
+/// The same with ports for the Digraph
+class port_node: public Atomic<IO>
+{
+	public:
+		port_node():Atomic<IO>(){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<IO>&){}
+		void delta_conf(const Bag<IO>&){}
+		void output_func(Bag<IO>&){}
+		void gc_output(Bag<IO>&){}
+		double ta() { return DBL_MAX; }
+};
+
+/// A network that can not list its couplings
+class legacy: public Network<int>
+{
+	public:
+		legacy(int n):Network<int>()
+		{
+			for (int i = 0; i < n; i++)
+			{
+				c.push_back(new node());
+				c.back()->setParent(this);
+			}
+		}
+		void getComponents(Set<Devs<int>*>& s)
+		{
+			s.insert(c.begin(),c.end());
+		}
+		void route(const int&, Devs<int>*, Bag<Event<int> >&){}
+		~legacy()
+		{
+			for (unsigned i = 0; i < c.size(); i++) delete c[i];
+		}
+		std::vector<Devs<int>*> c;
+};
+
+bool has_edge(LpGraph& g, int a, int b)
+{
+	const std::vector<int>& e = g.getE(a);
+	return std::find(e.begin(),e.end(),b) != e.end();
+}
+
+/// Two rings that are joined by one coupling are split at that coupling
+void test_rings()
+{
+	const int N = 30;
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	std::vector<node*> a, b;
+	for (int i = 0; i < N; i++)
+	{
+		a.push_back(new node());
+		b.push_back(new node());
+		model->add(a.back());
+		model->add(b.back());
+	}
+	for (int i = 0; i < N; i++)
+	{
+		model->couple(a[i],a[(i+1)%N]);
+		model->couple(b[i],b[(i+1)%N]);
+	}
+	model->couple(a[5],b[17]);
+	Partitioner<int> p(model);
+	LpGraph g;
+	p.partition(2,g);
+	assert(p.getCutWeight() == 1);
+	assert(p.getLoad(0) == N && p.getLoad(1) == N);
+	for (int i = 0; i < N; i++)
+	{
+		assert(a[i]->getProc() == a[0]->getProc());
+		assert(b[i]->getProc() == b[0]->getProc());
+	}
+	assert(a[0]->getProc() != b[0]->getProc());
+	assert(g.getLPCount() == 2);
+	assert(has_edge(g,a[0]->getProc(),b[0]->getProc()));
+	assert(g.getE(b[0]->getProc()).empty());
+	delete model;
+}
+
+/// A long chain is balanced and cut in only a few places
+void test_chain()
+{
+	const int N = 1000, P = 4;
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	std::vector<node*> c;
+	for (int i = 0; i < N; i++)
+	{
+		c.push_back(new node());
+		model->add(c.back());
+		if (i > 0) model->couple(c[i-1],c[i]);
+	}
+	Partitioner<int> p(model);
+	LpGraph g;
+	p.partition(P,g);
+	for (int k = 0; k < P; k++)
+		assert(p.getLoad(k) <= (105*N)/(100*P)+1);
+	assert(p.getCutWeight() <= 2*P);
+	for (int i = 0; i < N; i++)
+		assert(c[i]->getProc() >= 0 && c[i]->getProc() < P);
+	delete model;
+}
+
+/**
+ * Models that are assigned through their network stay there, and the
+ * couplings through the ports of the networks are followed.
+ */
+void test_fixed()
+{
+	Digraph<int>* model = new Digraph<int>();
+	Digraph<int>* left = new Digraph<int>();
+	Digraph<int>* right = new Digraph<int>();
+	std::vector<port_node*> l, r;
+	for (int i = 0; i < 10; i++)
+	{
+		l.push_back(new port_node());
+		r.push_back(new port_node());
+		left->add(l.back());
+		right->add(r.back());
+		if (i > 0)
+		{
+			left->couple(l[i-1],0,l[i],0);
+			right->couple(r[i-1],0,r[i],0);
+		}
+	}
+	left->couple(l.back(),0,left,1);
+	right->couple(right,2,r.front(),0);
+	model->add(left);
+	model->add(right);
+	model->couple(left,1,right,2);
+	// Put the left side on processor 1 and leave the right free
+	left->setProc(1);
+	Partitioner<IO> p(model);
+	LpGraph g;
+	p.partition(2,g);
+	for (int i = 0; i < 10; i++)
+	{
+		assert(l[i]->getProc() == -1);
+		assert(r[i]->getProc() == 0);
+	}
+	assert(p.getCutWeight() == 1);
+	assert(has_edge(g,1,0));
+	assert(g.getE(0).empty());
+	delete model;
+}
+
+/// A network without couplings connects all of its components
+void test_hub()
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	legacy* inner = new legacy(40);
+	node* src = new node();
+	model->add(inner);
+	model->add(src);
+	model->couple(src,inner);
+	Partitioner<int> p(model);
+	LpGraph g;
+	p.partition(4,g);
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			if (i != j)
+				assert(has_edge(g,i,j));
+		}
+	}
+	delete model;
+}
+
+/// A busy model gets a processor to itself
+void test_profile()
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	std::vector<node*> c;
+	c.push_back(new node(0.01));
+	for (int i = 0; i < 5; i++)
+		c.push_back(new node(1.0));
+	for (unsigned i = 0; i < c.size(); i++)
+		model->add(c[i]);
+	Partitioner<int> p(model);
+	Simulator<int>* sim = new Simulator<int>(model);
+	sim->addEventListener(&p);
+	sim->execUntil(10.0);
+	delete sim;
+	LpGraph g;
+	p.partition(2,g);
+	for (unsigned i = 1; i < c.size(); i++)
+		assert(c[i]->getProc() != c[0]->getProc());
+	assert(p.getCutWeight() == 0);
+	delete model;
+}
+
+/// Everything goes to the only processor
+void test_one()
+{
+	SimpleDigraph<int>* model = new SimpleDigraph<int>();
+	node* a = new node();
+	node* b = new node();
+	model->add(a);
+	model->add(b);
+	model->couple(a,b);
+	Partitioner<int> p(model);
+	LpGraph g;
+	p.partition(1,g);
+	assert(a->getProc() == 0 && b->getProc() == 0);
+	assert(g.getLPCount() == 1);
+	assert(g.getE(0).empty() && g.getI(0).empty());
+	delete model;
+}
+
+int main()
+{
+	test_rings();
+	test_chain();
+	test_fixed();
+	test_hub();
+	test_profile();
+	test_one();
+	return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * Checks that precompiled routes give the same result as routing
+ * through the network hierarchy, and that the routes are recompiled
+ * when the structure of the model or its couplings change.
+ */
+#include "adevs.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+using namespace adevs;
+
+typedef PortValue<int,int> IO;
+
+/**
+ * A node sends its count on port 0 or 1 and adds its input to
+ * a sum that depends on the input port. 
+ */
+class node: public Atomic<IO>
+{
+	public:
+		node(int id):
+		Atomic<IO>(),id(id),count(0),sum(0),events(0){}
+		void delta_int() { count++; events++; }
+		void delta_ext(double, const Bag<IO>& xb) { add(xb); events++; }
+		void delta_conf(const Bag<IO>& xb) { count++; add(xb); events++; }
+		void output_func(Bag<IO>& yb)
+		{
+			yb.insert(IO(count%2,count));
+			if (id % 3 == 0) yb.insert(IO(2,id));
+		}
+		void gc_output(Bag<IO>&){}
+		double ta() { return 1.0+(double)(id%2); }
+		bool model_transition() { return (id == 1 && events == 5); }
+		int getID() const { return id; }
+		int getSum() const { return sum; }
+	private:
+		int id, count, sum, events;
+		void add(const Bag<IO>& xb)
+		{
+			for (Bag<IO>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				sum += (*iter).value*((*iter).port+1);
+		}
+};
+
+/**
+ * A Digraph whose routes may be declared static or not. Its
+ * model transition couples its first component to its last.
+ */
+class net: public Digraph<int,int>
+{
+	public:
+		net(bool static_routes):
+		Digraph<int,int>(),static_routes(static_routes),changed(false){}
+		bool routesAreStatic() const { return static_routes; }
+		void add(Component* model)
+		{
+			Digraph<int,int>::add(model);
+			order.push_back(model);
+		}
+		bool model_transition()
+		{
+			if (!changed)
+			{
+				couple(order.front(),0,order.back(),1);
+				changed = true;
+			}
+			return false;
+		}
+	private:
+		bool static_routes, changed;
+		std::vector<Component*> order;
+};
+
+class recorder: public EventListener<IO>
+{
+	public:
+		recorder(std::vector<Devs<IO>*>& ids):ids(ids){}
+		void outputEvent(Event<IO> x, double t)
+		{
+			int id = std::find(ids.begin(),ids.end(),x.model)-ids.begin();
+			std::ostringstream s;
+			s << t << " " << id << " " << x.value.port << " " << x.value.value;
+			log.push_back(s.str());
+		}
+		void stateChange(Atomic<IO>*, double){}
+		std::vector<std::string> log;
+	private:
+		std::vector<Devs<IO>*>& ids;
+};
+
+/**
+ * Build a three level model. Each of the two middle level networks holds
+ * a network of nodes, and the nodes pass values in and out of the
+ * network hierarchy.
+ */
+std::string run(bool static_routes)
+{
+	std::vector<Devs<IO>*> ids;
+	std::vector<node*> nodes;
+	net* top = new net(static_routes);
+	ids.push_back(top);
+	for (int i = 0; i < 2; i++)
+	{
+		net* mid = new net(static_routes);
+		net* bottom = new net(static_routes);
+		ids.push_back(mid);
+		ids.push_back(bottom);
+		top->add(mid);
+		mid->add(bottom);
+		for (int j = 0; j < 3; j++)
+		{
+			node* n = new node(nodes.size());
+			ids.push_back(n);
+			nodes.push_back(n);
+			bottom->add(n);
+			// Inside the bottom network
+			if (j > 0)
+				bottom->couple(n,j%2,nodes[nodes.size()-2],(j+1)%2);
+			// Out of the bottom and middle networks
+			bottom->couple(n,2,bottom,j);
+			mid->couple(bottom,j,mid,j);
+		}
+		// A node at the middle level
+		node* n = new node(nodes.size());
+		ids.push_back(n);
+		nodes.push_back(n);
+		mid->add(n);
+		mid->couple(n,0,bottom,1);
+		mid->couple(bottom,0,n,1);
+		bottom->couple(bottom,1,nodes[nodes.size()-2],0);
+		// Into the middle network
+		mid->couple(mid,1,n,0);
+	}
+	// Across the top
+	top->couple(ids[1],0,ids[7],1);
+	top->couple(ids[7],2,ids[1],1);
+	top->couple(ids[1],2,top,0);
+	Simulator<IO>* sim = new Simulator<IO>(top);
+	recorder* r = new recorder(ids);
+	sim->addEventListener(r);
+	sim->execUntil(30.0);
+	std::sort(r->log.begin(),r->log.end());
+	std::ostringstream result;
+	for (unsigned i = 0; i < r->log.size(); i++)
+		result << r->log[i] << "\n";
+	for (unsigned i = 0; i < nodes.size(); i++)
+		result << nodes[i]->getSum() << " ";
+	delete sim;
+	delete r;
+	delete top;
+	return result.str();
+}
+
+/// Sends a one on port 0 at every unit of time
+class generator: public Atomic<IO>
+{
+	public:
+		generator():Atomic<IO>(){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<IO>&){}
+		void delta_conf(const Bag<IO>&){}
+		void output_func(Bag<IO>& yb) { yb.insert(IO(0,1)); }
+		void gc_output(Bag<IO>&){}
+		double ta() { return 1.0; }
+};
+
+/**
+ * Couple the generator to a second target between two events and
+ * check that the second output goes to both targets.
+ */
+void couple_between_steps()
+{
+	Digraph<int,int>* top = new Digraph<int,int>();
+	generator* g = new generator();
+	node* a = new node(2);
+	node* b = new node(4);
+	top->add(b);
+	top->couple(g,0,a,0);
+	Simulator<IO>* sim = new Simulator<IO>(top);
+	sim->execNextEvent();
+	assert(a->getSum() == 1);
+	assert(b->getSum() == 0);
+	top->couple(g,0,b,0);
+	sim->execNextEvent();
+	assert(a->getSum() == 2);
+	assert(b->getSum() == 1);
+	delete sim;
+	delete top;
+}
+
+int main()
+{
+	std::string a = run(true);
+	std::string b = run(false);
+	assert(a == b);
+	couple_between_steps();
+	std::cout << "Test passed" << std::endl;
+	return 0;
+}
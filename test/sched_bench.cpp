@@ -0,0 +1,161 @@
+/**
+ * Benchmark for the event schedules. This is the access pattern of
+ * sched_test.cpp scaled up to a large number of models. The number of
+ * models may be given on the command line; the default is one million.
+ * It also times building each schedule with scheduleAll and the start
+ * up of a Simulator for a flat network with that many models.
+ * Run with make sched_bench.
+ */
+#include "adevs.h"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+using namespace std;
+using namespace adevs;
+
+class bogus_atomic: public Atomic<char>
+{
+	public:
+		bogus_atomic():
+		Atomic<char>(){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<char>&){}
+		void delta_conf(const Bag<char>&){}
+		void output_func(Bag<char>&){}
+		void gc_output(Bag<char>&){}
+		double ta() { return 0.0; }
+};
+
+class count_visitor:
+	public Schedule<char>::ImminentVisitor
+{
+	public:
+		count_visitor():count(0){}
+		void visit(Atomic<char>*) { count++; }
+		unsigned int count;
+};
+
+static double seconds(clock_t start)
+{
+	return (double)(clock()-start)/(double)CLOCKS_PER_SEC;
+}
+
+template <class Q> void bench(const char* name, unsigned int n)
+{
+	bogus_atomic* m = new bogus_atomic[n];
+	Q* q = new Q();
+	clock_t start;
+	double t_fill, t_hold, t_cluster, t_drain;
+	srand(1);
+	// Insert with random times
+	start = clock();
+	for (unsigned int i = 0; i < n; i++)
+		q->schedule(&(m[i]),(double)rand()/(double)RAND_MAX);
+	t_fill = seconds(start);
+	// Hold: reschedule the minimum into the future
+	start = clock();
+	for (unsigned int k = 0; k < 4*n; k++)
+		q->schedule(q->getMinimum(),
+			q->minPriority()+(double)rand()/(double)RAND_MAX);
+	t_hold = seconds(start);
+	// Clustered: reschedule random models onto a few integer times
+	// and visit the imminent set
+	start = clock();
+	count_visitor v;
+	for (unsigned int k = 0; k < 4*n; k++)
+	{
+		q->schedule(&(m[rand()%n]),q->minPriority()+(double)(rand()%16));
+		if (k % 65536 == 0) q->visitImminent(&v);
+	}
+	t_cluster = seconds(start);
+	// Remove everything
+	start = clock();
+	while (!q->empty()) q->removeMinimum();
+	t_drain = seconds(start);
+	cout << name << " fill " << t_fill << " hold " << t_hold
+		<< " cluster " << t_cluster << " drain " << t_drain
+		<< " total " << (t_fill+t_hold+t_cluster+t_drain) << endl;
+	delete q;
+	delete [] m;
+}
+
+template <class Q> void bench_build(const char* name, unsigned int n)
+{
+	bogus_atomic* m = new bogus_atomic[n];
+	std::vector<Atomic<char>*> models(n);
+	std::vector<double> prio(n);
+	Q* q = new Q();
+	clock_t start;
+	double t_one, t_bulk;
+	srand(1);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		models[i] = &(m[i]);
+		prio[i] = (double)rand()/(double)RAND_MAX;
+	}
+	// One at a time
+	start = clock();
+	for (unsigned int i = 0; i < n; i++)
+		q->schedule(models[i],prio[i]);
+	t_one = seconds(start);
+	delete q;
+	delete [] m;
+	m = new bogus_atomic[n];
+	for (unsigned int i = 0; i < n; i++)
+		models[i] = &(m[i]);
+	q = new Q();
+	// All at once
+	start = clock();
+	q->scheduleAll(models,prio);
+	t_bulk = seconds(start);
+	cout << name << " build one " << t_one << " all " << t_bulk << endl;
+	delete q;
+	delete [] m;
+}
+
+class cell: public Atomic<char>
+{
+	public:
+		cell(double h):Atomic<char>(),h(h){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<char>&){}
+		void delta_conf(const Bag<char>&){}
+		void output_func(Bag<char>&){}
+		void gc_output(Bag<char>&){}
+		double ta() { return h; }
+	private:
+		double h;
+};
+
+void bench_startup(unsigned int n, bool parallel)
+{
+	SimpleDigraph<char>* model = new SimpleDigraph<char>();
+	srand(1);
+	for (unsigned int i = 0; i < n; i++)
+		model->add(new cell((double)rand()/(double)RAND_MAX));
+	clock_t start = clock();
+	Simulator<char>* sim = new Simulator<char>(model,parallel);
+	double t_start = seconds(start);
+	cout << "simulator start up " << (parallel ? "parallel " : "")
+		<< t_start << " next event " << sim->nextEventTime() << endl;
+	delete sim;
+	delete model;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int n = 1000000;
+	if (argc > 1) n = atoi(argv[1]);
+	cout << "models " << n << endl;
+	bench<Schedule<char> >("binary heap   ",n);
+	bench<DaryHeapSchedule<char,double,4> >("4-ary heap    ",n);
+	bench<DaryHeapSchedule<char,double,8> >("8-ary heap    ",n);
+	bench<CalendarSchedule<char> >("calendar queue",n);
+	bench_build<Schedule<char> >("binary heap   ",n);
+	bench_build<DaryHeapSchedule<char,double,4> >("4-ary heap    ",n);
+	bench_build<DaryHeapSchedule<char,double,8> >("8-ary heap    ",n);
+	bench_build<CalendarSchedule<char> >("calendar queue",n);
+	bench_startup(n,false);
+	bench_startup(n,true);
+	return 0;
+}
@@ -227,6 +227,40 @@ void test10()
 	}
 }
 
+void test11()
+{
+	int i;
+	bogus_atomic m[1000];
+	Schedule<char> q;
+	Bag<Atomic<char>*> imm, visited;
+	q.getImminent(imm);
+	assert(imm.empty());
+	// Half of the models are imminent
+	for (i = 0; i < 1000; i++)
+	{
+		q.schedule(&(m[i]),(double)(i%2));
+	}
+	q.getImminent(imm);
+	assert(imm.size() == 500);
+	for (i = 0; i < 1000; i += 2)
+	{
+		assert(imm.find(&m[i]) != imm.end());
+	}
+	// Same models in the same order as the visitor
+	test10visitor* visitor = new test10visitor(visited);
+	q.visitImminent(visitor);
+	delete visitor;
+	assert(visited.size() == imm.size());
+	Bag<Atomic<char>*>::iterator iter1 = imm.begin(), iter2 = visited.begin();
+	for (; iter1 != imm.end(); iter1++, iter2++)
+	{
+		assert(*iter1 == *iter2);
+	}
+	// The bag is appended to
+	q.getImminent(imm);
+	assert(imm.size() == 1000);
+}
+
 int main () 
 {
 	testa();
@@ -240,5 +274,6 @@ int main ()
 	test8();
 	test9();
 	test10();
+	test11();
 	return 0;
 }
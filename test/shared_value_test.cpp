@@ -0,0 +1,152 @@
+/**
+ * Tests for the shared_value.
+ */
+#include "adevs.h"
+#include <iostream>
+#include <vector>
+#include <cassert>
+using namespace adevs;
+
+/**
+ * A large payload that counts its copies and how many of it exist.
+ */
+class payload
+{
+	public:
+		payload(int v):data(1000,v){ live++; }
+		payload(const payload& src):data(src.data){ live++; copies++; }
+		~payload() { live--; }
+		int value() const { return data[0]; }
+		static int live, copies;
+	private:
+		std::vector<int> data;
+};
+
+int payload::live = 0;
+int payload::copies = 0;
+
+typedef PortValue<shared_value<payload> > IO;
+
+void test1()
+{
+	shared_value<payload> a;
+	assert(a.isNull());
+	assert(a.useCount() == 0);
+	{
+		shared_value<payload> b(payload(3));
+		assert(b.useCount() == 1);
+		assert(b->value() == 3);
+		a = b;
+		assert(a.useCount() == 2);
+		shared_value<payload> c(a);
+		assert(c.useCount() == 3);
+		c = c;
+		assert(c.useCount() == 3);
+		c.reset();
+		assert(c.isNull());
+		assert(a.useCount() == 2);
+	}
+	assert(a.useCount() == 1);
+	assert((*a).value() == 3);
+	assert(payload::live == 1);
+	a = shared_value<payload>();
+	assert(payload::live == 0);
+}
+
+/**
+ * Sends a payload on every internal event.
+ */
+class source: public Atomic<IO>
+{
+	public:
+		source():Atomic<IO>(),count(0){}
+		void delta_int() { count++; }
+		void delta_ext(double, const Bag<IO>&){}
+		void delta_conf(const Bag<IO>&){}
+		void output_func(Bag<IO>& yb)
+		{
+			yb.insert(IO(0,shared_value<payload>(payload(count))));
+		}
+		void gc_output(Bag<IO>&){}
+		double ta() { return (count < 10) ? 1.0 : DBL_MAX; }
+	private:
+		int count;
+};
+
+/**
+ * Adds up the payloads that it receives.
+ */
+class sink: public Atomic<IO>
+{
+	public:
+		sink():Atomic<IO>(),sum(0){}
+		void delta_int(){}
+		void delta_ext(double, const Bag<IO>& xb)
+		{
+			for (Bag<IO>::const_iterator iter = xb.begin();
+				iter != xb.end(); iter++)
+				sum += (*iter).value->value();
+		}
+		void delta_conf(const Bag<IO>&){}
+		void output_func(Bag<IO>&){}
+		void gc_output(Bag<IO>&){}
+		double ta() { return DBL_MAX; }
+		int sum;
+};
+
+/**
+ * A fan-out to many receivers copies each payload once, which
+ * is when it is put into the shared_value.
+ */
+void test2()
+{
+	payload::copies = 0;
+	Digraph<shared_value<payload> >* model = new Digraph<shared_value<payload> >();
+	source* src = new source();
+	model->add(src);
+	std::vector<sink*> sinks;
+	for (int i = 0; i < 100; i++)
+	{
+		sinks.push_back(new sink());
+		model->couple(src,0,sinks.back(),0);
+	}
+	Simulator<IO>* sim = new Simulator<IO>(model);
+	while (sim->nextEventTime() < DBL_MAX)
+		sim->execNextEvent();
+	for (unsigned i = 0; i < sinks.size(); i++)
+		assert(sinks[i]->sum == 45);
+	assert(payload::copies == 10);
+	delete sim;
+	delete model;
+	assert(payload::live == 0);
+}
+
+/**
+ * Copies may be made and destroyed by many threads at once.
+ */
+void test3()
+{
+	shared_value<payload> a(payload(1));
+	#pragma omp parallel for
+	for (int i = 0; i < 100000; i++)
+	{
+		shared_value<payload> b(a);
+		shared_value<payload> c;
+		c = b;
+		assert(c->value() == 1);
+	}
+	assert(a.useCount() == 1);
+}
+
+int main()
+{
+#ifdef _OPENMP
+	omp_set_num_threads(4);
+#endif
+	test1();
+	test2();
+	test3();
+	assert(payload::live == 0);
+	std::cout << "Test passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * Checks that the StateSaver and IncrementalStateSaver restore the state
+ * of a model at the end of a lookahead, and that a ring of these models
+ * gives the same results with the ParSimulator as with the Simulator.
+ */
+#include "adevs.h"
+#include <omp.h>
+#include <vector>
+#include <cassert>
+using namespace adevs;
+
+struct small_state
+{
+	int count;
+	double sigma;
+	int inputs[4];
+};
+
+/// Counts its events and the inputs that arrive at each of four phases
+class counter: public StateSaver<counter,small_state,Atomic<int> >
+{
+	public:
+		counter():StateSaver<counter,small_state,Atomic<int> >()
+		{
+			s.count = 0;
+			s.sigma = 1.0;
+			for (int i = 0; i < 4; i++) s.inputs[i] = 0;
+		}
+		small_state& getLookaheadState() { return s; }
+		void delta_int() { s.count++; }
+		void delta_ext(double e, const Bag<int>& xb)
+		{
+			s.sigma -= e;
+			s.inputs[s.count%4] += xb.size();
+		}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>&){}
+		void gc_output(Bag<int>&){}
+		double ta() { return s.sigma; }
+		small_state s;
+};
+
+const int CELLS = 1000;
+
+struct big_state
+{
+	int count;
+	double sigma;
+	double cells[CELLS];
+};
+
+/**
+ * Changes a few of its many cells at each event and sends a cell to the
+ * next model in a ring, which adds it to one of its own cells.
+ */
+class grid: public IncrementalStateSaver<grid,big_state,Atomic<double> >
+{
+	public:
+		grid(int id):IncrementalStateSaver<grid,big_state,Atomic<double> >()
+		{
+			memset(&s,0,sizeof(s));
+			s.sigma = 1.0+0.1*id;
+			for (int i = 0; i < CELLS; i++) s.cells[i] = id;
+		}
+		big_state& getLookaheadState() { return s; }
+		void delta_int()
+		{
+			modify(s.count)++;
+			modify(s.cells[(s.count*37)%CELLS]) += s.count;
+			modify(s.sigma) = 1.0;
+		}
+		void delta_ext(double e, const Bag<double>& xb)
+		{
+			modify(s.sigma) -= e;
+			for (Bag<double>::const_iterator iter = xb.begin(); iter != xb.end(); iter++)
+				modify(s.cells[((int)(*iter))%CELLS]) += 0.5*(*iter);
+		}
+		void delta_conf(const Bag<double>& xb)
+		{
+			delta_int();
+			delta_ext(0.0,xb);
+		}
+		void output_func(Bag<double>& yb) { yb.insert(s.cells[(s.count*13)%CELLS]); }
+		void gc_output(Bag<double>&){}
+		double ta() { return s.sigma; }
+		double lookahead() { return 0.5; }
+		/// Zero a range of cells with one announcement
+		void clear(int first, int n)
+		{
+			touch(&(s.cells[first]),n*sizeof(double));
+			memset(&(s.cells[first]),0,n*sizeof(double));
+		}
+		big_state s;
+};
+
+/// The whole state is copied back
+void test_whole()
+{
+	counter c;
+	Bag<int> xb;
+	xb.insert(1);
+	xb.insert(2);
+	c.delta_ext(0.25,xb);
+	small_state before = c.s;
+	c.beginLookahead();
+	c.delta_int();
+	c.delta_ext(0.5,xb);
+	assert(c.s.count == 1 && c.s.inputs[1] == 2);
+	c.endLookahead();
+	assert(memcmp(&before,&(c.s),sizeof(small_state)) == 0);
+	assert(c.supportsLookahead());
+}
+
+/// Only the changed pages are saved and all of them are copied back
+void test_incremental()
+{
+	grid* g = new grid(3);
+	big_state* before = new big_state(g->s);
+	g->delta_int();
+	g->beginLookahead();
+	Bag<double> xb;
+	xb.insert(5.0);
+	xb.insert(5.0);
+	g->delta_ext(0.5,xb);
+	// The pages of sigma and cells[5]
+	assert(g->getSavedPageCount() == 1);
+	g->delta_int();
+	g->clear(200,300);
+	assert(g->getSavedPageCount() > 2);
+	assert(g->getSavedPageCount() < sizeof(big_state)/256);
+	// The last partial page
+	g->clear(CELLS-1,1);
+	// Past the end of the state
+	unsigned saved = g->getSavedPageCount();
+	bool thrown = false;
+	try { g->clear(CELLS-1,2); }
+	catch(adevs::exception&) { thrown = true; }
+	assert(thrown);
+	assert(g->getSavedPageCount() == saved);
+	g->endLookahead();
+	assert(g->getSavedPageCount() == 0);
+	g->delta_int();
+	big_state* after = new big_state(g->s);
+	// Run the same again and compare
+	delete g;
+	g = new grid(3);
+	g->delta_int();
+	g->delta_int();
+	assert(memcmp(after,&(g->s),sizeof(big_state)) == 0);
+	// Changes outside of a lookahead are not saved
+	g->clear(0,CELLS);
+	assert(g->getSavedPageCount() == 0);
+	delete before;
+	delete after;
+	delete g;
+}
+
+/// A ring of grids with the sequential or the parallel simulator
+std::vector<double> run(bool parallel)
+{
+	const int N = 8;
+	SimpleDigraph<double>* model = new SimpleDigraph<double>();
+	std::vector<grid*> g;
+	for (int i = 0; i < N; i++)
+	{
+		g.push_back(new grid(i));
+		g.back()->setProc(i%omp_get_max_threads());
+		model->add(g.back());
+	}
+	for (int i = 0; i < N; i++)
+		model->couple(g[i],g[(i+1)%N]);
+	if (parallel)
+	{
+		ParSimulator<double>* sim = new ParSimulator<double>(model);
+		sim->execUntil(50.0);
+		delete sim;
+	}
+	else
+	{
+		Simulator<double>* sim = new Simulator<double>(model);
+		sim->execUntil(50.0);
+		delete sim;
+	}
+	std::vector<double> result;
+	for (int i = 0; i < N; i++)
+	{
+		result.push_back(g[i]->s.count);
+		result.insert(result.end(),g[i]->s.cells,g[i]->s.cells+CELLS);
+	}
+	delete model;
+	return result;
+}
+
+int main()
+{
+	test_whole();
+	test_incremental();
+	std::vector<double> seq = run(false);
+	std::vector<double> par = run(true);
+	assert(seq[0] > 0);
+	assert(seq == par);
+	return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * Checks that the simulator finds the components of a network with
+ * visitComponents, and that networks which only implement getComponents
+ * still work.
+ */
+#include "adevs.h"
+#include <vector>
+#include <cassert>
+using namespace adevs;
+
+/// Counts its internal events and asks for a structure change at the third
+class ticker: public Atomic<int>
+{
+	public:
+		ticker(int id):Atomic<int>(),id(id),count(0){ live++; }
+		void delta_int() { count++; }
+		void delta_ext(double, const Bag<int>&){}
+		void delta_conf(const Bag<int>&){}
+		void output_func(Bag<int>& yb) { yb.insert(id); }
+		void gc_output(Bag<int>&){}
+		double ta() { return 1.0; }
+		bool model_transition() { return (id == 0 && count == 3); }
+		int getCount() const { return count; }
+		~ticker() { live--; }
+		static int live;
+	private:
+		int id, count;
+};
+
+int ticker::live = 0;
+
+/// A network that implements only getComponents
+class legacy: public Network<int>
+{
+	public:
+		legacy():Network<int>()
+		{
+			for (int i = 10; i < 13; i++)
+			{
+				c.push_back(new ticker(i));
+				c.back()->setParent(this);
+			}
+		}
+		void getComponents(Set<Devs<int>*>& s)
+		{
+			s.insert(c.begin(),c.end());
+		}
+		void route(const int&, Devs<int>*, Bag<Event<int> >&){}
+		~legacy()
+		{
+			for (unsigned i = 0; i < c.size(); i++) delete c[i];
+		}
+		std::vector<Devs<int>*> c;
+};
+
+/**
+ * A network that must be visited. At its first structure change it
+ * replaces the ticker with id 0 by a new ticker with id 1.
+ */
+class pool: public Network<int>
+{
+	public:
+		pool():Network<int>(),changed(false)
+		{
+			add(new ticker(0));
+			add(new ticker(2));
+			add(new legacy());
+		}
+		void getComponents(Set<Devs<int>*>&)
+		{
+			// The simulator should not call this
+			assert(false);
+		}
+		void visitComponents(Network<int>::ComponentVisitor* visitor)
+		{
+			for (unsigned i = 0; i < c.size(); i++)
+				visitor->visit(c[i]);
+		}
+		void route(const int&, Devs<int>*, Bag<Event<int> >&){}
+		bool model_transition()
+		{
+			if (!changed)
+			{
+				// The simulator deletes the removed model
+				c.erase(c.begin());
+				add(new ticker(1));
+				changed = true;
+			}
+			return false;
+		}
+		~pool()
+		{
+			for (unsigned i = 0; i < c.size(); i++) delete c[i];
+		}
+		ticker* get(unsigned i) { return dynamic_cast<ticker*>(c[i]); }
+		legacy* getLegacy() { return dynamic_cast<legacy*>(c[1]); }
+	private:
+		std::vector<Devs<int>*> c;
+		bool changed;
+		void add(Devs<int>* model)
+		{
+			model->setParent(this);
+			c.push_back(model);
+		}
+};
+
+int main()
+{
+	pool* model = new pool();
+	assert(ticker::live == 5);
+	Simulator<int>* sim = new Simulator<int>(model);
+	sim->execUntil(10.0);
+	// The ticker with id 0 was removed after its third event at t=3
+	assert(ticker::live == 5);
+	assert(model->get(0)->getCount() == 10);
+	assert(model->get(2)->getCount() == 7);
+	legacy* l = model->getLegacy();
+	for (unsigned i = 0; i < l->c.size(); i++)
+		assert(dynamic_cast<ticker*>(l->c[i])->getCount() == 10);
+	delete sim;
+	delete model;
+	assert(ticker::live == 0);
+	return 0;
+}